@@ -0,0 +1,107 @@
+#include "cameracapture.h"
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QDateTime>
+
+CameraCapture::CameraCapture(QObject *parent)
+    : QThread(parent),
+    stopRequested(false),
+    framesCaptured(0),
+    framesDropped(0)
+{
+}
+
+CameraCapture::~CameraCapture() {
+    stop();
+}
+
+bool CameraCapture::open(const QString& source) {
+    if (isRunning()) return false;
+
+    bool isNumeric;
+    int camIndex = source.toInt(&isNumeric);
+    if (isNumeric) camera.open(camIndex, cv::CAP_ANY);
+    else camera.open(source.toStdString());
+    if (!camera.isOpened()) return false;
+
+    camera.set(cv::CAP_PROP_BUFFERSIZE, 1);
+
+    // Live devices and streams deliver frames at their own pace, local files
+    // would be decoded as fast as possible unless we throttle them.
+    paceToSourceFps = !isNumeric && QFileInfo::exists(source);
+    sourceFps = camera.get(cv::CAP_PROP_FPS);
+    if (sourceFps <= 0.0 || sourceFps > 240.0) sourceFps = 25.0;
+
+    stopRequested = false;
+    return true;
+}
+
+void CameraCapture::stop() {
+    stopRequested = true;
+    if (isRunning()) wait();
+    if (camera.isOpened()) camera.release();
+    history.clear();
+    QMutexLocker locker(&slotMutex);
+    latestFrame.reset();
+    hasNewFrame = false;
+}
+
+bool CameraCapture::takeLatestFrame(FrameRef& frame, qint64* capturedAtMs) {
+    QMutexLocker locker(&slotMutex);
+    if (!hasNewFrame) return false;
+    frame = std::move(latestFrame);
+    if (capturedAtMs) *capturedAtMs = latestFrameMs;
+    latestFrame.reset();
+    hasNewFrame = false;
+    return true;
+}
+
+void CameraCapture::run() {
+    const int maxConsecutiveFailures = 50;
+    const qint64 frameIntervalNs = static_cast<qint64>(1e9 / sourceFps);
+    int consecutiveFailures = 0;
+    QElapsedTimer pacer;
+    pacer.start();
+    qint64 nextFrameNs = 0;
+
+    while (!stopRequested) {
+        // Same-sized recycled buffers are decoded into without reallocating.
+        std::shared_ptr<cv::Mat> frame = framePool.acquire();
+        const qint64 readStartNs = pacer.nsecsElapsed();
+        const bool readOk = camera.read(*frame) && !frame->empty();
+        if (metrics && readOk) metrics->record(Metrics::Stage::Capture, metricsRoad, (pacer.nsecsElapsed() - readStartNs) / 1000);
+        if (!readOk) {
+            if (++consecutiveFailures >= maxConsecutiveFailures) {
+                emit captureFailed("Camera stream stopped delivering frames.");
+                break;
+            }
+            QThread::msleep(10);
+            continue;
+        }
+        consecutiveFailures = 0;
+        framesCaptured++;
+        const qint64 capturedAtMs = QDateTime::currentMSecsSinceEpoch();
+
+        FrameRef published = frame;
+        {
+            QMutexLocker locker(&slotMutex);
+            if (hasNewFrame) {
+                framesDropped++;
+                if (metrics) metrics->increment(Metrics::Counter::CaptureDropped, metricsRoad);
+            }
+            latestFrame = std::move(frame);
+            latestFrameMs = capturedAtMs;
+            hasNewFrame = true;
+        }
+        // Encoded after publishing so the history never delays the live frame.
+        history.offer(*published, capturedAtMs);
+        published.reset();
+
+        if (paceToSourceFps) {
+            nextFrameNs += frameIntervalNs;
+            qint64 aheadNs = nextFrameNs - pacer.nsecsElapsed();
+            if (aheadNs > 0) QThread::usleep(static_cast<unsigned long>(aheadNs / 1000));
+            else nextFrameNs = pacer.nsecsElapsed();
+        }
+    }
+}
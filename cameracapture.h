@@ -0,0 +1,64 @@
+#ifndef CAMERACAPTURE_H
+#define CAMERACAPTURE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QString>
+#include <opencv2/opencv.hpp>
+#include "framepool.h"
+#include "framehistory.h"
+#include "metrics.h"
+#include <atomic>
+
+// Decodes one camera source on its own thread and keeps only the newest frame.
+// A frame that is replaced before anyone takes it is counted as dropped.
+// Frames are decoded straight into recycled pool buffers and handed out by reference;
+// a compressed copy of the recent past is kept for violation evidence.
+class CameraCapture : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit CameraCapture(QObject *parent = nullptr);
+    ~CameraCapture();
+
+    bool open(const QString& source);
+    void stop();
+    // Read times and drops are recorded for roadIndex; set before start().
+    void setMetrics(Metrics* metrics, int roadIndex) { this->metrics = metrics; metricsRoad = roadIndex; }
+
+    // Non-blocking: returns false if no frame arrived since the last call.
+    // capturedAtMs receives the frame's wall-clock capture time.
+    bool takeLatestFrame(FrameRef& frame, qint64* capturedAtMs = nullptr);
+
+    FrameHistory& getHistory() { return history; }
+
+    quint64 getCapturedFrameCount() const { return framesCaptured; }
+    quint64 getDroppedFrameCount() const { return framesDropped; }
+
+signals:
+    void captureFailed(const QString& message);
+
+protected:
+    void run() override;
+
+private:
+    cv::VideoCapture camera;
+    bool paceToSourceFps = false;
+    double sourceFps = 0.0;
+
+    FramePool framePool;
+    FrameHistory history;
+    QMutex slotMutex;
+    FrameRef latestFrame;
+    qint64 latestFrameMs = 0;
+    bool hasNewFrame = false;
+    Metrics* metrics = nullptr;
+    int metricsRoad = -1;
+
+    std::atomic<bool> stopRequested;
+    std::atomic<quint64> framesCaptured;
+    std::atomic<quint64> framesDropped;
+};
+
+#endif // CAMERACAPTURE_H
@@ -0,0 +1,487 @@
+#include "evidencestore.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <algorithm>
+
+static const quint32 RECORD_MAGIC = 0x45564431; // "EVD1"
+static const qint64 DAY_MS = 24ll * 60 * 60 * 1000;
+// A segment straddling the retention cutoff is compacted once this share of its payload has expired.
+static const double COMPACT_EXPIRED_SHARE = 0.5;
+
+namespace {
+
+// Segment record: magic, header, payload size, payload.
+// Index entry: header, record offset, payload size.
+// Headers and entries are QDataStream byte arrays, so a torn one fails to read.
+QByteArray encodeHeader(const EvidenceRecord& record) {
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << record.timestampMs << record.eventMs << qint32(record.roadIndex)
+        << quint8(record.kind) << record.reason << record.name;
+    return header;
+}
+
+bool decodeHeader(const QByteArray& header, EvidenceRecord& record) {
+    QDataStream in(header);
+    in.setVersion(QDataStream::Qt_5_12);
+    qint32 road = 0;
+    quint8 kind = 0;
+    in >> record.timestampMs >> record.eventMs >> road >> kind >> record.reason >> record.name;
+    record.roadIndex = road;
+    record.kind = static_cast<EvidenceRecord::Kind>(kind);
+    return in.status() == QDataStream::Ok;
+}
+
+qint64 recordEnd(qint64 offset, int headerSize, quint32 length) {
+    return offset + 3 * sizeof(quint32) + headerSize + length;
+}
+
+// Reads the record starting at offset; returns where it ends, or -1 if it is torn or not a record.
+qint64 readRecordAt(QFile& file, qint64 offset, EvidenceRecord& record, QByteArray* payload) {
+    if (!file.seek(offset)) return -1;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic = 0, length = 0;
+    QByteArray header;
+    in >> magic;
+    if (in.status() != QDataStream::Ok || magic != RECORD_MAGIC) return -1;
+    in >> header >> length;
+    if (in.status() != QDataStream::Ok || !decodeHeader(header, record)) return -1;
+
+    const qint64 end = recordEnd(offset, header.size(), length);
+    if (end > file.size()) return -1;
+    if (payload) {
+        *payload = file.read(length);
+        if (payload->size() != static_cast<int>(length)) return -1;
+    }
+    record.offset = offset;
+    record.length = length;
+    return end;
+}
+
+QByteArray encodeIndexEntry(const EvidenceRecord& record, const QByteArray& header) {
+    QByteArray entry;
+    QDataStream out(&entry, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << header << record.offset << record.length;
+
+    QByteArray framed;
+    QDataStream frame(&framed, QIODevice::WriteOnly);
+    frame.setVersion(QDataStream::Qt_5_12);
+    frame << entry;
+    return framed;
+}
+
+QDate dayOf(qint64 ms) {
+    return QDateTime::fromMSecsSinceEpoch(ms).date();
+}
+
+} // namespace
+
+EvidenceStore::EvidenceStore(const QString& directory) : directory(directory) {
+}
+
+EvidenceStore::~EvidenceStore() {
+    closeSegmentFiles();
+}
+
+void EvidenceStore::setRetention(int days, qint64 maxTotal) {
+    QWriteLocker locker(&lock);
+    retentionDays = qMax(0, days);
+    maxTotalBytes = qMax<qint64>(0, maxTotal);
+}
+
+bool EvidenceStore::open() {
+    QWriteLocker locker(&lock);
+    closeSegmentFiles();
+    segments.clear();
+    records.clear();
+
+    QDir dir(directory);
+    if (!dir.mkpath(".")) return false;
+    recoverCompaction(dir);
+
+    nextSegmentId = 1;
+    const QStringList names = dir.entryList({"evidence_*.seg"}, QDir::Files, QDir::Name);
+    for (const QString& name : names) {
+        bool ok = false;
+        Segment segment;
+        segment.id = name.mid(9, 6).toInt(&ok);
+        if (!ok) continue;
+        nextSegmentId = qMax(nextSegmentId, segment.id + 1);
+        if (!loadSegment(segment)) continue;
+        if (segment.dataBytes == 0) {
+            // Started just before a crash; nothing to keep.
+            QFile::remove(dataPath(segment.id));
+            QFile::remove(indexPath(segment.id));
+            continue;
+        }
+        segments.push_back(segment);
+    }
+    // Compacted segments carry newer ids than the segments after them.
+    std::stable_sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+        return a.firstMs < b.firstMs;
+    });
+    std::stable_sort(records.begin(), records.end(), [](const EvidenceRecord& a, const EvidenceRecord& b) {
+        return a.timestampMs < b.timestampMs;
+    });
+    return true;
+}
+
+// A compaction writes the new segment as .tmp files and a marker naming the
+// segment it replaces, renames the data file into place, and only then deletes
+// the old segment. The rename is the commit point: with the new data file
+// present the old segment is finished off, without it the copy is discarded.
+void EvidenceStore::recoverCompaction(QDir& dir) {
+    for (const QString& name : dir.entryList({"evidence_*.rep"}, QDir::Files, QDir::Name)) {
+        bool ok = false;
+        const int newId = name.mid(9, 6).toInt(&ok);
+        QFile marker(dir.filePath(name));
+        if (ok && marker.open(QIODevice::ReadOnly)) {
+            const int oldId = marker.readAll().trimmed().toInt(&ok);
+            marker.close();
+            if (QFile::exists(dataPath(newId))) {
+                if (ok) {
+                    QFile::remove(dataPath(oldId));
+                    QFile::remove(indexPath(oldId));
+                }
+            } else {
+                QFile::remove(indexPath(newId));
+            }
+        }
+        QFile::remove(dir.filePath(name));
+    }
+    for (const QString& name : dir.entryList({"evidence_*.tmp"}, QDir::Files)) QFile::remove(dir.filePath(name));
+}
+
+bool EvidenceStore::loadSegment(Segment& segment) {
+    QFile data(dataPath(segment.id));
+    QFile index(indexPath(segment.id));
+    if (!data.open(QIODevice::ReadWrite) || !index.open(QIODevice::ReadWrite)) return false;
+    const qint64 dataSize = data.size();
+
+    std::vector<EvidenceRecord> loaded;
+    qint64 validIndexBytes = 0;
+    qint64 dataEnd = 0;
+
+    const QByteArray indexBytes = index.readAll();
+    QDataStream in(indexBytes);
+    in.setVersion(QDataStream::Qt_5_12);
+    while (!in.atEnd()) {
+        QByteArray entry, header;
+        in >> entry;
+        if (in.status() != QDataStream::Ok) break;
+
+        EvidenceRecord record;
+        QDataStream fields(entry);
+        fields.setVersion(QDataStream::Qt_5_12);
+        fields >> header >> record.offset >> record.length;
+        if (fields.status() != QDataStream::Ok || !decodeHeader(header, record)) break;
+        const qint64 end = recordEnd(record.offset, header.size(), record.length);
+        if (end > dataSize) break;
+
+        record.segmentId = segment.id;
+        loaded.push_back(record);
+        validIndexBytes += sizeof(quint32) + entry.size();
+        dataEnd = qMax(dataEnd, end);
+    }
+
+    // Records written after the last intact index entry are still self-describing.
+    QByteArray recoveredEntries;
+    while (dataEnd < dataSize) {
+        EvidenceRecord record;
+        const qint64 end = readRecordAt(data, dataEnd, record, nullptr);
+        if (end < 0) break;
+        record.segmentId = segment.id;
+        loaded.push_back(record);
+        recoveredEntries += encodeIndexEntry(record, encodeHeader(record));
+        dataEnd = end;
+    }
+
+    if (dataEnd < dataSize) data.resize(dataEnd); // torn tail
+    if (validIndexBytes < indexBytes.size() || !recoveredEntries.isEmpty()) {
+        index.resize(validIndexBytes);
+        index.seek(validIndexBytes);
+        index.write(recoveredEntries);
+    }
+
+    segment.dataBytes = dataEnd;
+    segment.indexBytes = validIndexBytes + recoveredEntries.size();
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        segment.firstMs = i == 0 ? loaded[i].timestampMs : qMin(segment.firstMs, loaded[i].timestampMs);
+        segment.lastMs = i == 0 ? loaded[i].timestampMs : qMax(segment.lastMs, loaded[i].timestampMs);
+    }
+    records.insert(records.end(), loaded.begin(), loaded.end());
+    return true;
+}
+
+bool EvidenceStore::append(EvidenceRecord& record, const uchar* data, size_t size) {
+    if (!data || size == 0 || size > 0xffffffffu) return false;
+
+    QWriteLocker locker(&lock);
+    // A new segment per day, or once the current one is full; clip frames from just before midnight stay put.
+    bool roll = segments.empty() || segments.back().dataBytes >= maxSegmentBytes;
+    if (!roll && segments.back().dataBytes > 0) roll = dayOf(record.timestampMs) > dayOf(segments.back().firstMs);
+
+    if (roll) {
+        if (!startSegment()) return false;
+    } else if (!dataFile.isOpen() && !openSegmentFiles(segments.back())) {
+        return false;
+    }
+
+    if (!writeRecord(segments.back(), dataFile, indexFile, record, reinterpret_cast<const char*>(data), static_cast<quint32>(size))) return false;
+    insertRecord(record);
+    return true;
+}
+
+bool EvidenceStore::writeRecord(Segment& segment, QFile& data, QFile& index, EvidenceRecord& record, const char* payload, quint32 size) {
+    const QByteArray header = encodeHeader(record);
+    QByteArray prefix;
+    QDataStream out(&prefix, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << RECORD_MAGIC << header << size;
+
+    const qint64 offset = segment.dataBytes;
+    if (data.write(prefix) != prefix.size() || data.write(payload, size) != size || !data.flush()) {
+        data.resize(offset);
+        return false;
+    }
+
+    record.segmentId = segment.id;
+    record.offset = offset;
+    record.length = size;
+    const QByteArray entry = encodeIndexEntry(record, header);
+    if (index.write(entry) != entry.size() || !index.flush()) {
+        index.resize(segment.indexBytes);
+        data.resize(offset);
+        return false;
+    }
+
+    if (segment.dataBytes == 0) {
+        segment.firstMs = segment.lastMs = record.timestampMs;
+    } else {
+        segment.firstMs = qMin(segment.firstMs, record.timestampMs);
+        segment.lastMs = qMax(segment.lastMs, record.timestampMs);
+    }
+    segment.dataBytes = recordEnd(offset, header.size(), size);
+    segment.indexBytes += entry.size();
+    return true;
+}
+
+bool EvidenceStore::startSegment() {
+    closeSegmentFiles();
+    Segment segment;
+    segment.id = nextSegmentId++;
+    if (!openSegmentFiles(segment)) return false;
+    segments.push_back(segment);
+    return true;
+}
+
+bool EvidenceStore::openSegmentFiles(const Segment& segment) {
+    dataFile.setFileName(dataPath(segment.id));
+    indexFile.setFileName(indexPath(segment.id));
+    if (dataFile.open(QIODevice::WriteOnly | QIODevice::Append) && indexFile.open(QIODevice::WriteOnly | QIODevice::Append)) return true;
+    closeSegmentFiles();
+    return false;
+}
+
+void EvidenceStore::closeSegmentFiles() {
+    if (dataFile.isOpen()) dataFile.close();
+    if (indexFile.isOpen()) indexFile.close();
+}
+
+void EvidenceStore::insertRecord(const EvidenceRecord& record) {
+    auto position = std::upper_bound(records.begin(), records.end(), record.timestampMs,
+                                     [](qint64 timestampMs, const EvidenceRecord& other) { return timestampMs < other.timestampMs; });
+    records.insert(position, record);
+}
+
+std::vector<EvidenceRecord> EvidenceStore::query(qint64 fromMs, qint64 toMs, int roadIndex, const QString& reasonFilter, int limit, bool imagesOnly) const {
+    std::vector<EvidenceRecord> result;
+    QReadLocker locker(&lock);
+    auto it = std::lower_bound(records.begin(), records.end(), fromMs,
+                               [](const EvidenceRecord& record, qint64 timestampMs) { return record.timestampMs < timestampMs; });
+    for (; it != records.end() && it->timestampMs <= toMs; ++it) {
+        if (limit >= 0 && static_cast<int>(result.size()) >= limit) break;
+        if (roadIndex >= 0 && it->roadIndex != roadIndex) continue;
+        if (imagesOnly && it->kind != EvidenceRecord::Kind::Image) continue;
+        if (!reasonFilter.isEmpty() && !it->reason.contains(reasonFilter, Qt::CaseInsensitive)) continue;
+        result.push_back(*it);
+    }
+    return result;
+}
+
+int EvidenceStore::count() const {
+    QReadLocker locker(&lock);
+    return static_cast<int>(records.size());
+}
+
+// Re-reads the record header, so a location made stale by compaction returns nothing rather than another image.
+QByteArray EvidenceStore::readPayload(const EvidenceRecord& record) const {
+    QReadLocker locker(&lock);
+    QFile file(dataPath(record.segmentId));
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    EvidenceRecord stored;
+    QByteArray payload;
+    if (readRecordAt(file, record.offset, stored, &payload) < 0) return QByteArray();
+    if (stored.timestampMs != record.timestampMs || stored.name != record.name) return QByteArray();
+    return payload;
+}
+
+bool EvidenceStore::exportRecord(const EvidenceRecord& record, const QString& path) const {
+    const QByteArray payload = readPayload(record);
+    if (payload.isEmpty()) return false;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    return file.write(payload) == payload.size();
+}
+
+void EvidenceStore::applyRetention(qint64 nowMs) {
+    std::vector<int> compactIds;
+    qint64 cutoffMs = 0;
+    {
+        QWriteLocker locker(&lock);
+        if (retentionDays > 0) {
+            cutoffMs = nowMs - retentionDays * DAY_MS;
+            for (size_t i = 0; i < segments.size();) {
+                if (segments[i].lastMs < cutoffMs) {
+                    dropSegment(i);
+                    continue;
+                }
+                // The segment being appended to holds a single day and never straddles the cutoff.
+                if (segments[i].firstMs < cutoffMs && i + 1 < segments.size()) {
+                    qint64 expired = 0, total = 0;
+                    for (const EvidenceRecord& record : records) {
+                        if (record.segmentId != segments[i].id) continue;
+                        total += record.length;
+                        if (record.timestampMs < cutoffMs) expired += record.length;
+                    }
+                    if (total > 0 && expired >= COMPACT_EXPIRED_SHARE * total) compactIds.push_back(segments[i].id);
+                }
+                ++i;
+            }
+        }
+
+        if (maxTotalBytes > 0) {
+            qint64 total = 0;
+            for (const Segment& segment : segments) total += segment.dataBytes + segment.indexBytes;
+            // The segment being appended to is never dropped for size alone.
+            while (total > maxTotalBytes && segments.size() > 1) {
+                total -= segments.front().dataBytes + segments.front().indexBytes;
+                dropSegment(0);
+            }
+        }
+    }
+
+    // Copied without the lock, so queries from the GUI keep running meanwhile.
+    for (int id : compactIds) compactSegment(id, cutoffMs);
+}
+
+int EvidenceStore::findSegment(int segmentId) const {
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (segments[i].id == segmentId) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void EvidenceStore::removeSegmentRecords(int segmentId) {
+    records.erase(std::remove_if(records.begin(), records.end(),
+                                 [segmentId](const EvidenceRecord& record) { return record.segmentId == segmentId; }),
+                  records.end());
+}
+
+void EvidenceStore::dropSegment(size_t position) {
+    const int id = segments[position].id;
+    if (position + 1 == segments.size()) closeSegmentFiles();
+    QFile::remove(dataPath(id));
+    QFile::remove(indexPath(id));
+    removeSegmentRecords(id);
+    segments.erase(segments.begin() + position);
+}
+
+// Copies the records of a closed segment at or after cutoffMs into a new
+// segment, then deletes the old one; see recoverCompaction() for the crash
+// protocol. Only retention drops or compacts closed segments, and it runs on
+// one thread, so the old files stay put while they are copied without the lock.
+bool EvidenceStore::compactSegment(int segmentId, qint64 cutoffMs) {
+    std::vector<EvidenceRecord> kept;
+    Segment compacted;
+    {
+        QWriteLocker locker(&lock);
+        if (findSegment(segmentId) < 0) return false;
+        for (const EvidenceRecord& record : records) {
+            if (record.segmentId == segmentId && record.timestampMs >= cutoffMs) kept.push_back(record);
+        }
+        compacted.id = nextSegmentId++;
+    }
+    std::sort(kept.begin(), kept.end(), [](const EvidenceRecord& a, const EvidenceRecord& b) { return a.offset < b.offset; });
+
+    QFile source(dataPath(segmentId));
+    QFile data(dataPath(compacted.id) + ".tmp");
+    QFile index(indexPath(compacted.id) + ".tmp");
+    bool ok = source.open(QIODevice::ReadOnly)
+              && data.open(QIODevice::WriteOnly | QIODevice::Truncate)
+              && index.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    for (size_t i = 0; ok && i < kept.size(); ++i) {
+        EvidenceRecord stored;
+        QByteArray payload;
+        ok = readRecordAt(source, kept[i].offset, stored, &payload) >= 0
+             && writeRecord(compacted, data, index, kept[i], payload.constData(), static_cast<quint32>(payload.size()));
+    }
+    source.close();
+    data.close();
+    index.close();
+
+    QFile marker(markerPath(compacted.id));
+    ok = ok && marker.open(QIODevice::WriteOnly | QIODevice::Truncate)
+         && marker.write(QByteArray::number(segmentId)) > 0 && marker.flush();
+    marker.close();
+    ok = ok && QFile::rename(index.fileName(), indexPath(compacted.id))
+         && QFile::rename(data.fileName(), dataPath(compacted.id));
+    if (!ok) {
+        QFile::remove(data.fileName());
+        QFile::remove(index.fileName());
+        QFile::remove(indexPath(compacted.id));
+        QFile::remove(marker.fileName());
+        return false;
+    }
+
+    QWriteLocker locker(&lock);
+    const int position = findSegment(segmentId);
+    if (position >= 0) {
+        QFile::remove(dataPath(segmentId));
+        QFile::remove(indexPath(segmentId));
+        removeSegmentRecords(segmentId);
+        for (const EvidenceRecord& record : kept) insertRecord(record);
+        segments[position] = compacted;
+    } else {
+        QFile::remove(dataPath(compacted.id));
+        QFile::remove(indexPath(compacted.id));
+    }
+    QFile::remove(marker.fileName());
+    return true;
+}
+
+qint64 EvidenceStore::getStoredBytes() const {
+    QReadLocker locker(&lock);
+    qint64 total = 0;
+    for (const Segment& segment : segments) total += segment.dataBytes + segment.indexBytes;
+    return total;
+}
+
+QString EvidenceStore::dataPath(int segmentId) const {
+    return QDir(directory).filePath(QString("evidence_%1.seg").arg(segmentId, 6, 10, QChar('0')));
+}
+
+QString EvidenceStore::indexPath(int segmentId) const {
+    return QDir(directory).filePath(QString("evidence_%1.idx").arg(segmentId, 6, 10, QChar('0')));
+}
+
+QString EvidenceStore::markerPath(int segmentId) const {
+    return QDir(directory).filePath(QString("evidence_%1.rep").arg(segmentId, 6, 10, QChar('0')));
+}
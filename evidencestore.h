@@ -0,0 +1,99 @@
+#ifndef EVIDENCESTORE_H
+#define EVIDENCESTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QReadWriteLock>
+#include <QtGlobal>
+#include <vector>
+
+// One image in the store. Clip frames share the eventMs of their violation.
+struct EvidenceRecord {
+    enum class Kind : quint8 { Image = 0, ClipFrame = 1 };
+
+    qint64 timestampMs = 0; // when the image was captured
+    qint64 eventMs = 0;     // when the violation was raised
+    int roadIndex = 0;
+    Kind kind = Kind::Image;
+    QString reason;
+    QString name;           // file name used when the image is exported
+
+    // Location, filled in by the store.
+    int segmentId = -1;
+    qint64 offset = 0;
+    quint32 length = 0;
+};
+
+// Append-only evidence container. Images are appended to segment files
+// (evidence_NNNNNN.seg) and described in a companion index file (.idx) that
+// is loaded into a time-sorted in-memory index at startup, so range and
+// per-road queries never touch the image data. A segment holds at most one
+// day or maxSegmentBytes; retention deletes whole expired segments and, once
+// most of a closed segment straddling the cutoff has expired, copies the rest
+// into a new segment and deletes the old one. A torn tail after a crash is
+// recovered by rescanning the segment's self-describing records.
+class EvidenceStore
+{
+public:
+    explicit EvidenceStore(const QString& directory);
+    ~EvidenceStore();
+
+    bool open();
+    void setMaxSegmentBytes(qint64 bytes) { maxSegmentBytes = qMax<qint64>(1024 * 1024, bytes); }
+    void setRetention(int days, qint64 maxTotalBytes);
+
+    // Thread-safe; fills in the record's location.
+    bool append(EvidenceRecord& record, const uchar* data, size_t size);
+
+    // Records with fromMs <= timestampMs <= toMs, oldest first; roadIndex < 0 means all roads.
+    // imagesOnly leaves out clip frames, i.e. returns one or a few records per violation.
+    std::vector<EvidenceRecord> query(qint64 fromMs, qint64 toMs, int roadIndex = -1,
+                                      const QString& reasonFilter = QString(), int limit = -1,
+                                      bool imagesOnly = false) const;
+    int count() const;
+    QByteArray readPayload(const EvidenceRecord& record) const;
+    bool exportRecord(const EvidenceRecord& record, const QString& path) const;
+
+    // Drops what is older than the retention period or beyond the size cap.
+    void applyRetention(qint64 nowMs);
+
+    qint64 getStoredBytes() const;
+    QString getDirectory() const { return directory; }
+
+private:
+    struct Segment {
+        int id = 0;
+        qint64 dataBytes = 0;
+        qint64 indexBytes = 0;
+        qint64 firstMs = 0;
+        qint64 lastMs = 0;
+    };
+
+    QString directory;
+    mutable QReadWriteLock lock;
+    std::vector<Segment> segments;           // oldest first, last one is appended to
+    int nextSegmentId = 1;
+    QFile dataFile, indexFile;               // the last segment, opened on first append
+    std::vector<EvidenceRecord> records;     // sorted by timestampMs
+    qint64 maxSegmentBytes = 256ll * 1024 * 1024;
+    int retentionDays = 30;
+    qint64 maxTotalBytes = 20ll * 1024 * 1024 * 1024;
+
+    QString dataPath(int segmentId) const;
+    QString indexPath(int segmentId) const;
+    QString markerPath(int segmentId) const;
+    int findSegment(int segmentId) const;
+    void recoverCompaction(QDir& dir);
+    bool loadSegment(Segment& segment);
+    bool startSegment();
+    bool openSegmentFiles(const Segment& segment);
+    void closeSegmentFiles();
+    bool writeRecord(Segment& segment, QFile& data, QFile& index, EvidenceRecord& record, const char* payload, quint32 size);
+    void insertRecord(const EvidenceRecord& record);
+    void removeSegmentRecords(int segmentId);
+    void dropSegment(size_t position);
+    bool compactSegment(int segmentId, qint64 cutoffMs);
+};
+
+#endif // EVIDENCESTORE_H
@@ -0,0 +1,173 @@
+#include "evidencewriter.h"
+#include <QMutexLocker>
+#include <QDateTime>
+
+static const qint64 RETENTION_INTERVAL_MS = 60ll * 60 * 1000;
+
+EvidenceWriter::EvidenceWriter(EvidenceStore* store, QObject *parent)
+    : QThread(parent),
+    jpegQuality(90),
+    store(store)
+{
+    clock.start();
+}
+
+EvidenceWriter::~EvidenceWriter() {
+    stop();
+}
+
+void EvidenceWriter::setMaxQueueDepth(int depth) {
+    QMutexLocker locker(&queueMutex);
+    maxQueueDepth = qMax(1, depth);
+}
+
+bool EvidenceWriter::enqueue(const FrameRef& frame, const EvidenceRecord& record, Priority priority) {
+    if (!frame || frame->empty()) return false;
+
+    Request request;
+    request.frame = frame;
+    request.record = record;
+    request.record.kind = EvidenceRecord::Kind::Image;
+    request.priority = priority;
+    return push(request);
+}
+
+bool EvidenceWriter::enqueueSequence(const std::vector<FrameHistory::Frame>& frames, const EvidenceRecord& event, Priority priority) {
+    if (frames.empty()) return false;
+
+    Request request;
+    request.sequence = frames;
+    request.record = event;
+    request.record.kind = EvidenceRecord::Kind::ClipFrame;
+    request.priority = priority;
+    return push(request);
+}
+
+bool EvidenceWriter::push(Request& request) {
+    const Priority priority = request.priority;
+    QString droppedName;
+    bool accepted = true;
+    {
+        QMutexLocker locker(&queueMutex);
+        if (static_cast<int>(queue.size()) >= maxQueueDepth) {
+            // Oldest entry of the lowest queued priority; the new image goes instead if it ranks lower still.
+            auto victim = queue.end();
+            for (auto it = queue.begin(); it != queue.end(); ++it) {
+                if (victim == queue.end() || it->priority < victim->priority) victim = it;
+            }
+            if (victim != queue.end() && victim->priority <= priority) {
+                droppedName = victim->record.name;
+                queue.erase(victim);
+            } else {
+                droppedName = request.record.name;
+                accepted = false;
+            }
+            stats.dropped++;
+        }
+        if (accepted) {
+            request.enqueuedNs = clock.nsecsElapsed();
+            queue.push_back(std::move(request));
+            stats.peakQueueDepth = qMax(stats.peakQueueDepth, static_cast<int>(queue.size()));
+            queueNotEmpty.wakeOne();
+        }
+    }
+
+    if (!droppedName.isEmpty()) emit evidenceDropped(droppedName);
+    return accepted;
+}
+
+void EvidenceWriter::stop() {
+    {
+        QMutexLocker locker(&queueMutex);
+        stopRequested = true;
+        queueNotEmpty.wakeAll();
+    }
+    if (isRunning()) wait();
+}
+
+EvidenceWriter::Stats EvidenceWriter::getStats() const {
+    QMutexLocker locker(&queueMutex);
+    Stats current = stats;
+    current.queueDepth = static_cast<int>(queue.size());
+    current.averageLatencyMs = windowWrites > 0 ? windowLatencyMs / windowWrites : 0.0;
+    return current;
+}
+
+EvidenceWriter::Stats EvidenceWriter::takeStats() {
+    Stats current = getStats();
+    QMutexLocker locker(&queueMutex);
+    windowLatencyMs = 0.0;
+    windowWrites = 0;
+    stats.maxLatencyMs = 0.0;
+    stats.peakQueueDepth = static_cast<int>(queue.size());
+    return current;
+}
+
+void EvidenceWriter::run() {
+    for (;;) {
+        Request request;
+        bool haveRequest = false;
+        {
+            QMutexLocker locker(&queueMutex);
+            // Wakes up now and then while idle so retention still runs on a quiet intersection.
+            if (queue.empty() && !stopRequested) queueNotEmpty.wait(&queueMutex, 60000);
+            if (!queue.empty()) {
+                request = std::move(queue.front());
+                queue.pop_front();
+                haveRequest = true;
+            } else if (stopRequested) {
+                break; // stop requested and everything written
+            }
+        }
+
+        if (lastRetentionMs < 0 || clock.elapsed() - lastRetentionMs >= RETENTION_INTERVAL_MS) {
+            store->applyRetention(QDateTime::currentMSecsSinceEpoch());
+            lastRetentionMs = clock.elapsed();
+        }
+        if (!haveRequest) continue;
+
+        bool ok = false;
+        if (!request.sequence.empty()) {
+            ok = writeSequence(request);
+            request.sequence.clear();
+        } else {
+            ok = writeImage(request);
+            request.frame.reset(); // hand the buffer back to its pool before the bookkeeping
+        }
+
+        const double latencyMs = (clock.nsecsElapsed() - request.enqueuedNs) / 1e6;
+        {
+            QMutexLocker locker(&queueMutex);
+            if (ok) stats.written++;
+            else stats.failed++;
+            windowLatencyMs += latencyMs;
+            windowWrites++;
+            stats.maxLatencyMs = qMax(stats.maxLatencyMs, latencyMs);
+        }
+        if (!ok) emit evidenceFailed(request.record.name);
+    }
+}
+
+bool EvidenceWriter::writeImage(Request& request) {
+    const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, jpegQuality.load()};
+    try {
+        if (!cv::imencode(".jpg", *request.frame, encodeBuffer, params)) return false;
+    } catch (const cv::Exception&) {
+        return false;
+    }
+    return store->append(request.record, encodeBuffer.data(), encodeBuffer.size());
+}
+
+bool EvidenceWriter::writeSequence(const Request& request) {
+    bool ok = true;
+    for (size_t i = 0; i < request.sequence.size(); ++i) {
+        const FrameHistory::Frame& frame = request.sequence[i];
+        const qint64 offsetMs = frame.timestampMs - request.record.eventMs;
+        EvidenceRecord record = request.record;
+        record.timestampMs = frame.timestampMs;
+        record.name = request.record.name + QString("_clip/frame_%1_%2%3ms.jpg").arg(i, 3, 10, QChar('0'))
+                          .arg(offsetMs < 0 ? "-" : "+").arg(qAbs(offsetMs), 5, 10, QChar('0'));
+        if (!store->append(record, frame.jpeg->data(), frame.jpeg->size())) ok = false;
+    }
+    return ok;
+}
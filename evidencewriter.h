@@ -0,0 +1,91 @@
+#ifndef EVIDENCEWRITER_H
+#define EVIDENCEWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QString>
+#include "framepool.h"
+#include "framehistory.h"
+#include "evidencestore.h"
+#include <atomic>
+#include <deque>
+
+// Encodes violation images and pre/post-event history sequences into the
+// evidence store on its own thread, and applies the store's retention there
+// once an hour. The queue is bounded:
+// when it is full the oldest image of the lowest priority is dropped, so a burst
+// of follow-up shots can never push out the first image of a new violation.
+class EvidenceWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum class Priority { FollowUp = 0, Primary = 1 };
+
+    struct Stats {
+        int queueDepth = 0;
+        int peakQueueDepth = 0;
+        quint64 written = 0;
+        quint64 dropped = 0;
+        quint64 failed = 0;
+        double averageLatencyMs = 0.0; // enqueue to file written, over the last reporting window
+        double maxLatencyMs = 0.0;
+    };
+
+    explicit EvidenceWriter(EvidenceStore* store, QObject *parent = nullptr);
+    ~EvidenceWriter();
+
+    void setJpegQuality(int quality) { jpegQuality = qBound(1, quality, 100); }
+    void setMaxQueueDepth(int depth);
+
+    // Never blocks on disk. Returns false if the image was dropped straight away.
+    bool enqueue(const FrameRef& frame, const EvidenceRecord& record, Priority priority);
+    // Already-encoded history frames, stored unchanged as clip frames of the event
+    // and named after it by their offset from record.eventMs.
+    bool enqueueSequence(const std::vector<FrameHistory::Frame>& frames, const EvidenceRecord& event, Priority priority);
+    // Writes what is still queued, then stops the thread.
+    void stop();
+
+    Stats getStats() const;
+    // Starts a new latency window; counters keep running.
+    Stats takeStats();
+
+signals:
+    void evidenceFailed(const QString& name);
+    void evidenceDropped(const QString& name);
+
+protected:
+    void run() override;
+
+private:
+    struct Request {
+        FrameRef frame;
+        std::vector<FrameHistory::Frame> sequence;
+        EvidenceRecord record;
+        Priority priority = Priority::Primary;
+        qint64 enqueuedNs = 0;
+    };
+
+    mutable QMutex queueMutex;
+    QWaitCondition queueNotEmpty;
+    std::deque<Request> queue;
+    int maxQueueDepth = 32;
+    bool stopRequested = false;
+    std::atomic<int> jpegQuality;
+    EvidenceStore* store;
+    std::vector<uchar> encodeBuffer;
+    qint64 lastRetentionMs = -1;
+
+    QElapsedTimer clock;
+    Stats stats;
+    double windowLatencyMs = 0.0;
+    int windowWrites = 0;
+
+    bool push(Request& request);
+    bool writeImage(Request& request);
+    bool writeSequence(const Request& request);
+};
+
+#endif // EVIDENCEWRITER_H
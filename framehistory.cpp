@@ -0,0 +1,80 @@
+#include "framehistory.h"
+#include <QMutexLocker>
+
+FrameHistory::FrameHistory() {
+}
+
+void FrameHistory::setBudgetBytes(qint64 bytes) {
+    QMutexLocker locker(&mutex);
+    budgetBytes = qMax<qint64>(0, bytes);
+}
+
+void FrameHistory::setSampleIntervalMs(int intervalMs) {
+    QMutexLocker locker(&mutex);
+    sampleIntervalMs = qMax(0, intervalMs);
+}
+
+void FrameHistory::setJpegQuality(int quality) {
+    QMutexLocker locker(&mutex);
+    jpegQuality = qBound(1, quality, 100);
+}
+
+void FrameHistory::offer(const cv::Mat& frame, qint64 timestampMs) {
+    std::shared_ptr<std::vector<uchar>> buffer;
+    int quality;
+    {
+        QMutexLocker locker(&mutex);
+        if (budgetBytes == 0 || frame.empty()) return;
+        if (lastSampleMs != 0 && timestampMs - lastSampleMs < sampleIntervalMs) return;
+        lastSampleMs = timestampMs;
+        buffer = std::move(spareBuffer);
+        quality = jpegQuality;
+    }
+    if (!buffer) buffer = std::make_shared<std::vector<uchar>>();
+
+    const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, quality};
+    if (!cv::imencode(".jpg", frame, *buffer, params)) return;
+
+    QMutexLocker locker(&mutex);
+    Frame entry;
+    entry.timestampMs = timestampMs;
+    entry.jpeg = buffer;
+    frames.push_back(entry);
+    storedBytes += static_cast<qint64>(buffer->size());
+
+    while (storedBytes > budgetBytes && frames.size() > 1) {
+        Frame& oldest = frames.front();
+        storedBytes -= static_cast<qint64>(oldest.jpeg->size());
+        // Only recycle bytes that are not part of a snapshot being written.
+        if (oldest.jpeg.use_count() == 1) {
+            spareBuffer = std::const_pointer_cast<std::vector<uchar>>(oldest.jpeg);
+        }
+        frames.pop_front();
+    }
+}
+
+std::vector<FrameHistory::Frame> FrameHistory::snapshot(qint64 fromMs, qint64 toMs) const {
+    std::vector<Frame> window;
+    QMutexLocker locker(&mutex);
+    for (const Frame& frame : frames) {
+        if (frame.timestampMs >= fromMs && frame.timestampMs <= toMs) window.push_back(frame);
+    }
+    return window;
+}
+
+void FrameHistory::clear() {
+    QMutexLocker locker(&mutex);
+    frames.clear();
+    storedBytes = 0;
+    lastSampleMs = 0;
+}
+
+qint64 FrameHistory::getStoredBytes() const {
+    QMutexLocker locker(&mutex);
+    return storedBytes;
+}
+
+int FrameHistory::getStoredFrames() const {
+    QMutexLocker locker(&mutex);
+    return static_cast<int>(frames.size());
+}
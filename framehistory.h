@@ -0,0 +1,49 @@
+#ifndef FRAMEHISTORY_H
+#define FRAMEHISTORY_H
+
+#include <QMutex>
+#include <QtGlobal>
+#include <opencv2/opencv.hpp>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// The last seconds of one camera, JPEG-compressed, under a fixed byte budget.
+// The capture thread offers every frame; one is kept per sample interval and
+// the oldest are evicted once the budget is exceeded. Snapshots share the
+// encoded bytes, so dumping a window never blocks capture for long.
+class FrameHistory
+{
+public:
+    struct Frame {
+        qint64 timestampMs = 0;
+        std::shared_ptr<const std::vector<uchar>> jpeg;
+    };
+
+    FrameHistory();
+
+    void setBudgetBytes(qint64 bytes);
+    void setSampleIntervalMs(int intervalMs);
+    void setJpegQuality(int quality);
+
+    // Called from the capture thread; encodes outside the lock.
+    void offer(const cv::Mat& frame, qint64 timestampMs);
+    // Frames with fromMs <= timestamp <= toMs, oldest first.
+    std::vector<Frame> snapshot(qint64 fromMs, qint64 toMs) const;
+    void clear();
+
+    qint64 getStoredBytes() const;
+    int getStoredFrames() const;
+
+private:
+    mutable QMutex mutex;
+    std::deque<Frame> frames;
+    qint64 storedBytes = 0;
+    qint64 budgetBytes = 48ll * 1024 * 1024;
+    int sampleIntervalMs = 100;
+    int jpegQuality = 75;
+    qint64 lastSampleMs = 0;
+    std::shared_ptr<std::vector<uchar>> spareBuffer; // evicted buffer nobody else holds, reused for the next encode
+};
+
+#endif // FRAMEHISTORY_H
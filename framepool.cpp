@@ -0,0 +1,51 @@
+#include "framepool.h"
+#include <algorithm>
+
+FramePool::FramePool(int maxFreeBuffers) : shared(std::make_shared<Shared>()) {
+    shared->maxFreeBuffers = std::max(1, maxFreeBuffers);
+}
+
+// Buffers still out with consumers are freed by their last owner.
+FramePool::~FramePool() {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    shared->closed = true;
+    for (cv::Mat* buffer : shared->freeBuffers) delete buffer;
+    shared->freeBuffers.clear();
+}
+
+std::shared_ptr<cv::Mat> FramePool::acquire() {
+    cv::Mat* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (!shared->freeBuffers.empty()) {
+            buffer = shared->freeBuffers.back();
+            shared->freeBuffers.pop_back();
+        } else {
+            shared->allocated++;
+        }
+    }
+    if (!buffer) buffer = new cv::Mat();
+
+    std::shared_ptr<Shared> owner = shared;
+    return std::shared_ptr<cv::Mat>(buffer, [owner](cv::Mat* released) { recycle(owner, released); });
+}
+
+int FramePool::getAllocatedCount() const {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    return shared->allocated;
+}
+
+void FramePool::recycle(const std::shared_ptr<Shared>& shared, cv::Mat* buffer) {
+    // A cv::Mat header copied out of the frame still points at these pixels;
+    // writing into them again would change that consumer's image.
+    const bool stillViewed = buffer->u && buffer->u->refcount > 1;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (!shared->closed && !stillViewed && static_cast<int>(shared->freeBuffers.size()) < shared->maxFreeBuffers) {
+            shared->freeBuffers.push_back(buffer);
+            return;
+        }
+        shared->allocated--;
+    }
+    delete buffer;
+}
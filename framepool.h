@@ -0,0 +1,40 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A captured frame shared by capture, inference, display and evidence code.
+// The pixels are never written once the frame is published.
+typedef std::shared_ptr<const cv::Mat> FrameRef;
+
+// Recycles frame buffers of one camera. acquire() hands out a writable buffer;
+// when the last reference to it is dropped the pixel memory goes back to the
+// pool instead of the heap, so a steady stream stops allocating after warm-up.
+class FramePool
+{
+public:
+    explicit FramePool(int maxFreeBuffers = 6);
+    ~FramePool();
+
+    // Never blocks: allocates a new buffer if none is free.
+    std::shared_ptr<cv::Mat> acquire();
+
+    int getAllocatedCount() const;
+
+private:
+    struct Shared {
+        std::mutex mutex;
+        std::vector<cv::Mat*> freeBuffers;
+        int maxFreeBuffers = 0;
+        int allocated = 0;
+        bool closed = false;
+    };
+    std::shared_ptr<Shared> shared;
+
+    static void recycle(const std::shared_ptr<Shared>& shared, cv::Mat* buffer);
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,171 @@
+#include "framepreprocessor.h"
+#include <algorithm>
+#include <cmath>
+
+// Ultralytics letterbox grey, already scaled to [0, 1].
+static const float LETTERBOX_PAD_VALUE = 114.0f / 255.0f;
+// Source sizes remembered per input size; a camera that keeps changing resolution starts over.
+static const size_t MAX_GEOMETRIES = 64;
+
+namespace {
+
+class LetterboxBody : public cv::ParallelLoopBody
+{
+public:
+    LetterboxBody(const cv::Mat& frame, const FramePreprocessor::Geometry& geometry, float* planes, bool fillPadding)
+        : frame(frame), geometry(geometry), inputSize(geometry.inputSize), planes(planes), fillPadding(fillPadding) {}
+
+    void operator()(const cv::Range& rows) const override {
+        const float scale = 1.0f / 255.0f;
+        const int planeSize = inputSize * inputSize;
+        const int padX = geometry.info.padX;
+        const int padY = geometry.info.padY;
+        const int scaledW = geometry.scaled.width;
+        const int scaledH = geometry.scaled.height;
+
+        for (int y = rows.start; y < rows.end; ++y) {
+            float* r = planes + y * inputSize;
+            float* g = r + planeSize;
+            float* b = g + planeSize;
+
+            const int sy = y - padY;
+            if (sy < 0 || sy >= scaledH) {
+                if (fillPadding) {
+                    std::fill(r, r + inputSize, LETTERBOX_PAD_VALUE);
+                    std::fill(g, g + inputSize, LETTERBOX_PAD_VALUE);
+                    std::fill(b, b + inputSize, LETTERBOX_PAD_VALUE);
+                }
+                continue;
+            }
+            if (fillPadding) {
+                for (int x = 0; x < padX; ++x) r[x] = g[x] = b[x] = LETTERBOX_PAD_VALUE;
+                for (int x = padX + scaledW; x < inputSize; ++x) r[x] = g[x] = b[x] = LETTERBOX_PAD_VALUE;
+            }
+
+            const uchar* top = frame.ptr<uchar>(geometry.y0[sy]);
+            const uchar* bottom = frame.ptr<uchar>(geometry.y1[sy]);
+            const float wy = geometry.yWeight[sy];
+
+            for (int sx = 0; sx < scaledW; ++sx) {
+                const int a = geometry.x0[sx] * 3;
+                const int c = geometry.x1[sx] * 3;
+                const float wx = geometry.xWeight[sx];
+                const int x = padX + sx;
+
+                // Source is BGR, destination planes are R, G, B.
+                float t0 = top[a] + (top[c] - top[a]) * wx;
+                float t1 = top[a + 1] + (top[c + 1] - top[a + 1]) * wx;
+                float t2 = top[a + 2] + (top[c + 2] - top[a + 2]) * wx;
+                float b0 = bottom[a] + (bottom[c] - bottom[a]) * wx;
+                float b1 = bottom[a + 1] + (bottom[c + 1] - bottom[a + 1]) * wx;
+                float b2 = bottom[a + 2] + (bottom[c + 2] - bottom[a + 2]) * wx;
+
+                b[x] = (t0 + (b0 - t0) * wy) * scale;
+                g[x] = (t1 + (b1 - t1) * wy) * scale;
+                r[x] = (t2 + (b2 - t2) * wy) * scale;
+            }
+        }
+    }
+
+private:
+    const cv::Mat& frame;
+    const FramePreprocessor::Geometry& geometry;
+    int inputSize;
+    float* planes;
+    bool fillPadding;
+};
+
+// Bilinear source taps with half-pixel centres, matching cv::resize(INTER_LINEAR).
+void buildTaps(int sourceLength, int scaledLength, std::vector<int>& i0, std::vector<int>& i1, std::vector<float>& weight) {
+    i0.resize(scaledLength);
+    i1.resize(scaledLength);
+    weight.resize(scaledLength);
+    const float ratio = static_cast<float>(sourceLength) / static_cast<float>(scaledLength);
+    for (int d = 0; d < scaledLength; ++d) {
+        float s = (d + 0.5f) * ratio - 0.5f;
+        int lo = static_cast<int>(std::floor(s));
+        float w = s - lo;
+        if (lo < 0) { lo = 0; w = 0.0f; }
+        if (lo >= sourceLength - 1) { lo = sourceLength - 1; w = 0.0f; }
+        i0[d] = lo;
+        i1[d] = std::min(lo + 1, sourceLength - 1);
+        weight[d] = w;
+    }
+}
+
+}
+
+FramePreprocessor::FramePreprocessor() {
+}
+
+const FramePreprocessor::Geometry& FramePreprocessor::geometryFor(const cv::Size& source, int inputSize) {
+    std::map<long long, Geometry>& sizeGeometries = geometries[inputSize];
+    long long key = (static_cast<long long>(source.width) << 32) | static_cast<unsigned int>(source.height);
+    auto it = sizeGeometries.find(key);
+    if (it != sizeGeometries.end()) return it->second;
+
+    if (sizeGeometries.size() >= MAX_GEOMETRIES) sizeGeometries.clear();
+    Geometry& geometry = sizeGeometries[key];
+    geometry.inputSize = inputSize;
+    geometry.source = source;
+    geometry.info.scale = std::min(static_cast<float>(inputSize) / source.width, static_cast<float>(inputSize) / source.height);
+    geometry.scaled.width = std::max(1, std::min(inputSize, static_cast<int>(std::lround(source.width * geometry.info.scale))));
+    geometry.scaled.height = std::max(1, std::min(inputSize, static_cast<int>(std::lround(source.height * geometry.info.scale))));
+    geometry.info.padX = (inputSize - geometry.scaled.width) / 2;
+    geometry.info.padY = (inputSize - geometry.scaled.height) / 2;
+    buildTaps(source.width, geometry.scaled.width, geometry.x0, geometry.x1, geometry.xWeight);
+    buildTaps(source.height, geometry.scaled.height, geometry.y0, geometry.y1, geometry.yWeight);
+    return geometry;
+}
+
+void FramePreprocessor::letterboxInto(const cv::Mat& frame, const Geometry& geometry, float* planes, bool fillPadding) const {
+    LetterboxBody body(frame, geometry, planes, fillPadding);
+    cv::parallel_for_(cv::Range(0, geometry.inputSize), body);
+}
+
+const cv::Mat& FramePreprocessor::prepare(int slot, const cv::Mat& frame, int inputSize, LetterboxInfo& info) {
+    CV_Assert(frame.type() == CV_8UC3 && !frame.empty() && inputSize > 0);
+
+    cv::Mat& tensor = slotTensors[slot];
+    cv::Size& lastSource = slotTensorSources[slot];
+    if (tensor.empty() || tensor.size[2] != inputSize) {
+        const int sizes[4] = {1, 3, inputSize, inputSize};
+        tensor.create(4, sizes, CV_32F);
+        lastSource = cv::Size();
+    }
+
+    const Geometry& geometry = geometryFor(frame.size(), inputSize);
+    letterboxInto(frame, geometry, tensor.ptr<float>(), lastSource != geometry.source);
+    lastSource = geometry.source;
+
+    info = geometry.info;
+    return tensor;
+}
+
+const cv::Mat& FramePreprocessor::prepareBatch(const std::vector<cv::Mat>& frames, int inputSize, std::vector<LetterboxInfo>& infos) {
+    CV_Assert(inputSize > 0);
+    const int batchSize = static_cast<int>(frames.size());
+    BatchTensor& batch = batchTensors[inputSize];
+    // The tensor only grows, to the largest batch seen; smaller batches get a header over its first images.
+    if (batch.tensor.dims != 4 || batch.tensor.size[0] < batchSize) {
+        const int sizes[4] = {batchSize, 3, inputSize, inputSize};
+        batch.tensor.create(4, sizes, CV_32F);
+        batch.sources.assign(batchSize, cv::Size());
+        batch.view.release();
+    }
+    if (batch.view.dims != 4 || batch.view.size[0] != batchSize) {
+        const int sizes[4] = {batchSize, 3, inputSize, inputSize};
+        batch.view = cv::Mat(4, sizes, CV_32F, batch.tensor.ptr<float>());
+    }
+
+    infos.resize(batchSize);
+    const size_t imageStride = static_cast<size_t>(3) * inputSize * inputSize;
+    for (int b = 0; b < batchSize; ++b) {
+        CV_Assert(frames[b].type() == CV_8UC3 && !frames[b].empty());
+        const Geometry& geometry = geometryFor(frames[b].size(), inputSize);
+        letterboxInto(frames[b], geometry, batch.tensor.ptr<float>() + b * imageStride, batch.sources[b] != geometry.source);
+        batch.sources[b] = geometry.source;
+        infos[b] = geometry.info;
+    }
+    return batch.view;
+}
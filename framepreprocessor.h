@@ -0,0 +1,55 @@
+#ifndef FRAMEPREPROCESSOR_H
+#define FRAMEPREPROCESSOR_H
+
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <vector>
+
+// Where the frame landed inside the square network input.
+struct LetterboxInfo {
+    float scale = 1.0f;
+    int padX = 0;
+    int padY = 0;
+};
+
+// Turns BGR frames into YOLO input tensors in a single pass per output pixel:
+// aspect-preserving bilinear resize, letterbox padding, BGR->RGB, 1/255 scaling
+// and HWC->CHW. Tensors and interpolation tables are kept between calls, so once
+// the camera geometry is stable no memory is allocated per frame.
+class FramePreprocessor
+{
+public:
+    FramePreprocessor();
+
+    // Fills the persistent 1 x 3 x S x S tensor of the given slot, e.g. one per road and tile.
+    const cv::Mat& prepare(int slot, const cv::Mat& frame, int inputSize, LetterboxInfo& info);
+    // Fills the first N images of the persistent tensor of this input size, one plane set per
+    // frame, and returns an N x 3 x S x S header over them.
+    const cv::Mat& prepareBatch(const std::vector<cv::Mat>& frames, int inputSize, std::vector<LetterboxInfo>& infos);
+
+    struct Geometry {
+        int inputSize = 0;
+        cv::Size source;
+        LetterboxInfo info;
+        cv::Size scaled;
+        std::vector<int> x0, x1, y0, y1;
+        std::vector<float> xWeight, yWeight;
+    };
+
+private:
+    struct BatchTensor {
+        cv::Mat tensor;                  // largest batch so far
+        cv::Mat view;                    // header over the current batch
+        std::vector<cv::Size> sources;
+    };
+
+    std::map<int, std::map<long long, Geometry>> geometries; // by input size, then source size
+    std::map<int, cv::Mat> slotTensors;
+    std::map<int, cv::Size> slotTensorSources;
+    std::map<int, BatchTensor> batchTensors;                // by input size
+
+    const Geometry& geometryFor(const cv::Size& source, int inputSize);
+    void letterboxInto(const cv::Mat& frame, const Geometry& geometry, float* planes, bool fillPadding) const;
+};
+
+#endif // FRAMEPREPROCESSOR_H
@@ -0,0 +1,83 @@
+#include "framescheduler.h"
+#include <algorithm>
+#include <climits>
+
+// A green with this little time left is about to turn yellow and then red.
+static const int PHASE_ENDING_SECONDS = 5;
+// Priority gained per second without a frame on a worker. Phase and track weights span 1 to 6,
+// so after 1.25 s a waiting road makes up the largest gap and outranks any road just served.
+static const double WAIT_WEIGHT_PER_SECOND = 4.0;
+static const double TRACK_WEIGHT = 0.2;
+static const int MAX_WEIGHTED_TRACKS = 10;
+
+void FrameScheduler::setRoadCount(int count) {
+    roads.resize(qMax(0, count));
+}
+
+void FrameScheduler::setMinimumRate(int roadIndex, double fps) {
+    if (isValidRoad(roadIndex)) roads[roadIndex].minimumFps = qMax(0.0, fps);
+}
+
+double FrameScheduler::getMinimumRate(int roadIndex, TrafficLight light) const {
+    if (!isValidRoad(roadIndex)) return 0.0;
+    const bool stopping = light == TrafficLight::RED || light == TrafficLight::YELLOW;
+    return stopping ? qMax(roads[roadIndex].minimumFps, redMinimumFps) : roads[roadIndex].minimumFps;
+}
+
+void FrameScheduler::updateRoad(int roadIndex, TrafficLight light, int phaseSecondsLeft, int trackCount) {
+    if (!isValidRoad(roadIndex)) return;
+    RoadState& road = roads[roadIndex];
+    road.light = light;
+    road.phaseSecondsLeft = phaseSecondsLeft;
+    road.trackCount = trackCount;
+}
+
+void FrameScheduler::markDispatched(int roadIndex, qint64 nowNs) {
+    if (isValidRoad(roadIndex)) roads[roadIndex].lastDispatchNs = nowNs;
+}
+
+qint64 FrameScheduler::deadlineNs(int roadIndex) const {
+    if (!isValidRoad(roadIndex)) return LLONG_MAX;
+    const RoadState& road = roads[roadIndex];
+    const double fps = getMinimumRate(roadIndex, road.light);
+    if (fps <= 0.0) return LLONG_MAX;
+    if (road.lastDispatchNs < 0) return 0;
+    return road.lastDispatchNs + static_cast<qint64>(1e9 / fps);
+}
+
+double FrameScheduler::priority(int roadIndex, qint64 nowNs) const {
+    if (!isValidRoad(roadIndex)) return 0.0;
+    const RoadState& road = roads[roadIndex];
+
+    double phase = 1.0;
+    switch (road.light) {
+    case TrafficLight::YELLOW: phase = 4.0; break;
+    case TrafficLight::GREEN: phase = road.phaseSecondsLeft <= PHASE_ENDING_SECONDS ? 3.0 : 2.0; break;
+    case TrafficLight::RED: phase = road.trackCount > 0 ? 3.0 : 2.0; break;
+    case TrafficLight::OFF: break;
+    }
+    const double tracks = TRACK_WEIGHT * qMin(road.trackCount, MAX_WEIGHTED_TRACKS);
+    const double waitedSeconds = road.lastDispatchNs < 0 ? 1.0 : (nowNs - road.lastDispatchNs) / 1e9;
+    return phase + tracks + WAIT_WEIGHT_PER_SECOND * waitedSeconds;
+}
+
+void FrameScheduler::order(std::vector<int>& roadIndices, qint64 nowNs) const {
+    std::vector<qint64> deadlines(roads.size(), LLONG_MAX);
+    std::vector<double> priorities(roads.size(), 0.0);
+    for (int r : roadIndices) {
+        if (!isValidRoad(r)) continue;
+        deadlines[r] = deadlineNs(r);
+        priorities[r] = priority(r, nowNs);
+    }
+    auto overdue = [&](int r) { return isValidRoad(r) && deadlines[r] <= nowNs; };
+
+    std::sort(roadIndices.begin(), roadIndices.end(), [&](int a, int b) {
+        const bool aOverdue = overdue(a), bOverdue = overdue(b);
+        if (aOverdue != bOverdue) return aOverdue;
+        if (aOverdue && deadlines[a] != deadlines[b]) return deadlines[a] < deadlines[b];
+        const double pa = isValidRoad(a) ? priorities[a] : 0.0;
+        const double pb = isValidRoad(b) ? priorities[b] : 0.0;
+        if (pa != pb) return pa > pb;
+        return a < b;
+    });
+}
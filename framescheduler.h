@@ -0,0 +1,53 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QtGlobal>
+#include "traffic_types.h"
+#include <vector>
+
+// Decides which waiting roads the next free worker takes. Two rules, in order:
+//  1. Roads past their guaranteed minimum frame rate go first, earliest
+//     deadline first. Red and yellow approaches, where violations happen, are
+//     guaranteed a higher rate than the rest; as long as the workers can
+//     deliver the sum of the minimum rates, every road gets its own.
+//  2. The others by priority: the signal phase (yellow, a green about to end,
+//     red with vehicles waiting), the number of tracked vehicles and the time
+//     since the road's last frame went to a worker. That last term grows
+//     without bound, so no road starves.
+class FrameScheduler
+{
+public:
+    void setRoadCount(int count);
+
+    // Guaranteed frames per second; 0 for no guarantee. The red rate applies
+    // to red and yellow approaches when it is the higher one.
+    void setMinimumRate(int roadIndex, double fps);
+    void setRedMinimumRate(double fps) { redMinimumFps = qMax(0.0, fps); }
+    double getMinimumRate(int roadIndex, TrafficLight light) const;
+
+    // phaseSecondsLeft: time left in the intersection's current phase.
+    void updateRoad(int roadIndex, TrafficLight light, int phaseSecondsLeft, int trackCount);
+    void markDispatched(int roadIndex, qint64 nowNs);
+
+    // Sorts roadIndices most urgent first.
+    void order(std::vector<int>& roadIndices, qint64 nowNs) const;
+    double priority(int roadIndex, qint64 nowNs) const;
+    // Latest time the road's next frame should reach a worker; LLONG_MAX without a guarantee.
+    qint64 deadlineNs(int roadIndex) const;
+
+private:
+    struct RoadState {
+        TrafficLight light = TrafficLight::OFF;
+        int phaseSecondsLeft = 0;
+        int trackCount = 0;
+        double minimumFps = 2.0;
+        qint64 lastDispatchNs = -1;
+    };
+
+    std::vector<RoadState> roads;
+    double redMinimumFps = 10.0;
+
+    bool isValidRoad(int roadIndex) const { return roadIndex >= 0 && roadIndex < static_cast<int>(roads.size()); }
+};
+
+#endif // FRAMESCHEDULER_H
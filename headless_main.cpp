@@ -0,0 +1,253 @@
+#include "trafficsystem.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QTimer>
+#include <QTextStream>
+#include <csignal>
+#include <cstdio>
+
+// Controller without any UI: read the configuration, connect the cameras and
+// run the light cycle until SIGINT/SIGTERM.
+//
+// Example stms.ini:
+//   [layout]      approaches=4, 3      (a four-way and a T-junction; roads 1-4 and 5-7)
+//   [models]      yolo=/opt/stms/yolov8n.onnx  classes=/opt/stms/coco.names
+//   [inference]   workers=2  confidence=0.5  nms=0.4  detectorInterval=3
+//                 backend=onnxruntime  threads=4   (opencv, onnxruntime or openvino; threads per worker)
+//                 inputSizes=320, 416, 640  tileAbove=3  maxTiles=6   (regions over 3 x 640 px are tiled)
+//   [cameras]     road1=rtsp://...  road2=0  ...
+//   [arduino]     intersection1=/dev/ttyACM0  intersection2=sim  (port= is intersection 1)
+//   [timing]      low=10  medium=20  high=30  veryHigh=40  yellow=3  allRedMs=1000   (seconds; all-red clearance in ms)
+//   [evidence]    retentionDays=30  maxGigabytes=50
+//   [metrics]     port=9464            (0 disables the Prometheus endpoint)
+//   [quality]     governor=true  budgetMs=250  road3BudgetMs=400   (p95 latency per road, 0: ungoverned)
+//   [scheduler]   redMinFps=10  minFps=2  road2MinFps=5  maxBatch=4   (guaranteed inference rates, 0: none)
+//   [simulation]  hours=24  seed=1  demand=400  road2Demand=60, 40, ..., 300  policies=short, long
+//                 (vehicles/h, one value or one per hour of day; --simulate compares [timing] with the policies)
+//   [policy_short] low=6  medium=9  high=12  veryHigh=15  yellow=3  allRedMs=1000  energySaving=false
+//   A camera source of sim or sim:<vehicles/h> stands in for a camera with simulated traffic.
+
+namespace {
+volatile std::sig_atomic_t stopSignal = 0;
+
+void handleStopSignal(int) {
+    stopSignal = 1;
+}
+
+// Comma lists come back from QSettings as string lists.
+QString settingText(const QSettings& settings, const QString& key, const QString& defaultValue) {
+    return settings.contains(key) ? settings.value(key).toStringList().join(",") : defaultValue;
+}
+
+// Runs the configured light timing and every policy of [simulation] on simulated
+// traffic at each intersection, in accelerated time, and prints one line per policy.
+int runSimulation(const QSettings& settings, TrafficSystem& system) {
+    QTextStream out(stdout);
+    SimulationPolicy configured;
+    configured.name = "configured";
+    for (int d = 0; d < static_cast<int>(configured.greenSeconds.size()); ++d) {
+        configured.greenSeconds[d] = system.getRedLightDuration(static_cast<TrafficDensity>(d));
+    }
+    configured.yellowSeconds = system.getYellowLightDuration();
+    configured.allRedMs = system.getAllRedDuration();
+    configured.energySaving = system.isEnergySavingEnabled();
+
+    std::vector<SimulationPolicy> policies{configured};
+    for (const QString& name : settings.value("simulation/policies").toStringList()) {
+        SimulationPolicy policy = configured;
+        policy.name = name.trimmed();
+        const QString group = "policy_" + policy.name + "/";
+        const char* keys[] = {"off", "low", "medium", "high", "veryHigh"};
+        for (int d = 0; d < static_cast<int>(policy.greenSeconds.size()); ++d) {
+            policy.greenSeconds[d] = settings.value(group + keys[d], policy.greenSeconds[d]).toInt();
+        }
+        policy.yellowSeconds = settings.value(group + "yellow", policy.yellowSeconds).toInt();
+        policy.allRedMs = settings.value(group + "allRedMs", policy.allRedMs).toInt();
+        policy.energySaving = settings.value(group + "energySaving", policy.energySaving).toBool();
+        policies.push_back(policy);
+    }
+
+    const qint64 durationMs = static_cast<qint64>(settings.value("simulation/hours", 24).toDouble() * 3600000);
+    const quint32 seed = settings.value("simulation/seed", 1).toUInt();
+    const QString demand = settingText(settings, "simulation/demand", "400");
+    QElapsedTimer wallClock;
+    wallClock.start();
+    for (int k = 0; k < system.getIntersectionCount(); ++k) {
+        TrafficSimulator simulator(system.getApproachCount(k), seed);
+        for (int a = 0; a < simulator.getApproachCount(); ++a) {
+            const QString key = QString("simulation/road%1Demand").arg(system.getFirstRoad(k) + a + 1);
+            simulator.setDemand(a, DemandProfile::parse(settingText(settings, key, demand)));
+        }
+        out << QString("Intersection %1, %2 h simulated\n").arg(k + 1).arg(durationMs / 3600000.0, 0, 'f', 1);
+        out << QString("  %1 %2 %3 %4 %5 %6\n").arg("policy", -14).arg("delay s", 9).arg("queue", 8).arg("veh/h", 8).arg("max queue", 10).arg("dark h", 8);
+        for (const SimulationPolicy& policy : policies) {
+            const SimulationReport report = simulator.run(policy, durationMs);
+            out << QString("  %1 %2 %3 %4 %5 %6\n").arg(report.policy, -14)
+                       .arg(report.averageDelaySeconds(), 9, 'f', 1).arg(report.averageQueue(), 8, 'f', 2)
+                       .arg(report.throughputPerHour(), 8, 'f', 0).arg(report.maxQueue(), 10)
+                       .arg(report.darkMs / 3600000.0, 8, 'f', 1);
+        }
+    }
+    out << QString("Simulated in %1 s.\n").arg(wallClock.elapsed() / 1000.0, 0, 'f', 2);
+    return 0;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("stms_headless");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Smart Traffic Management System controller without a user interface.");
+    parser.addHelpOption();
+    QCommandLineOption configOption({"c", "config"}, "Read settings from <file> (INI).", "file");
+    QCommandLineOption modelOption("model", "YOLO ONNX model path.", "path");
+    QCommandLineOption classesOption("classes", "Class names file path.", "path");
+    QCommandLineOption cameraOption("camera", "Camera for a road, e.g. 1=rtsp://host/stream or 2=0. Repeatable.", "road=source");
+    QCommandLineOption arduinoOption("arduino", "Arduino serial port or 'sim', optionally for an intersection: 2=/dev/ttyUSB1. Repeatable.", "[intersection=]port");
+    QCommandLineOption workersOption("workers", "Number of inference workers.", "count");
+    QCommandLineOption backendOption("backend", "Inference backend: opencv, onnxruntime or openvino.", "name");
+    QCommandLineOption threadsOption("threads", "Inference threads per worker (default: an even share of the cores).", "count");
+    QCommandLineOption metricsOption("metrics-port", "Serve Prometheus metrics on 127.0.0.1:<port>/metrics, 0 to disable (default 9464).", "port");
+    QCommandLineOption simulateOption("simulate", "Compare the light timing with the [simulation] policies on simulated traffic, then exit.");
+    QCommandLineOption layoutOption("layout", "Approaches per intersection, e.g. 4,3,5.", "counts");
+    parser.addOptions({configOption, layoutOption, modelOption, classesOption, cameraOption, arduinoOption, workersOption,
+                       backendOption, threadsOption, metricsOption, simulateOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    // Command-line values take precedence over the file.
+    QSettings settings(parser.isSet(configOption) ? parser.value(configOption) : QString(), QSettings::IniFormat);
+    if (parser.isSet(configOption) && (!QFile::exists(parser.value(configOption)) || settings.status() != QSettings::NoError)) {
+        err << "Cannot read config file " << parser.value(configOption) << "\n";
+        return 1;
+    }
+
+    TrafficSystem system;
+    QObject::connect(&system, &TrafficSystem::logMessage, [&err](const QString& message, const QString& level) {
+        err << "[" << level << "] " << message << "\n";
+        err.flush();
+    });
+    system.setPreviewEnabled(false);
+
+    const QStringList layout = parser.isSet(layoutOption) ? parser.value(layoutOption).split(',') : settings.value("layout/approaches", "4").toStringList();
+    std::vector<int> approachCounts;
+    for (const QString& count : layout) approachCounts.push_back(count.trimmed().toInt());
+    if (!system.setIntersectionLayout(approachCounts)) {
+        err << "Invalid intersection layout: " << layout.join(",") << "\n";
+        return 1;
+    }
+
+    system.setModelPaths(parser.isSet(modelOption) ? parser.value(modelOption) : settings.value("models/yolo", "yolov8n.onnx").toString(),
+                         parser.isSet(classesOption) ? parser.value(classesOption) : settings.value("models/classes", "coco.names").toString());
+    system.setInferenceWorkerCount(parser.isSet(workersOption) ? parser.value(workersOption).toInt() : settings.value("inference/workers", 2).toInt());
+    const QString backendName = parser.isSet(backendOption) ? parser.value(backendOption) : settings.value("inference/backend", "opencv").toString();
+    InferenceBackend::Type backendType;
+    if (!InferenceBackend::parseType(backendName, backendType)) {
+        err << "Unknown inference backend: " << backendName << "\n";
+        return 1;
+    }
+    system.setInferenceBackend(backendType, parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : settings.value("inference/threads", 0).toInt());
+    TilingOptions tiling;
+    if (settings.contains("inference/inputSizes")) {
+        tiling.inputSizes.clear();
+        for (const QString& size : settings.value("inference/inputSizes").toStringList()) tiling.inputSizes.push_back(size.trimmed().toInt());
+    }
+    tiling.tileAboveScale = settings.value("inference/tileAbove", tiling.tileAboveScale).toDouble();
+    tiling.maxTiles = settings.value("inference/maxTiles", tiling.maxTiles).toInt();
+    system.setTilingOptions(tiling);
+    if (settings.contains("inference/detectorInterval")) {
+        for (int i = 0; i < system.getRoadCount(); ++i) system.setDetectorInterval(i, settings.value("inference/detectorInterval").toInt());
+    }
+
+    const struct { const char* key; TrafficDensity density; } timings[] = {
+        {"timing/low", TrafficDensity::LOW}, {"timing/medium", TrafficDensity::MEDIUM},
+        {"timing/high", TrafficDensity::HIGH}, {"timing/veryHigh", TrafficDensity::VERY_HIGH}
+    };
+    for (const auto& timing : timings) {
+        if (settings.contains(timing.key)) system.setLightTiming(timing.density, settings.value(timing.key).toInt());
+    }
+    if (settings.contains("timing/yellow")) system.setYellowLightDuration(settings.value("timing/yellow").toInt());
+    if (settings.contains("timing/allRedMs")) system.setAllRedDuration(settings.value("timing/allRedMs").toInt());
+    if (settings.contains("evidence/retentionDays") || settings.contains("evidence/maxGigabytes")) {
+        system.setEvidenceRetention(settings.value("evidence/retentionDays", 30).toInt(),
+                                    static_cast<qint64>(settings.value("evidence/maxGigabytes", 50).toDouble() * 1024 * 1024 * 1024));
+    }
+
+    system.setQualityGovernorEnabled(settings.value("quality/governor", true).toBool());
+    for (int i = 0; i < system.getRoadCount(); ++i) {
+        const int budget = settings.value("quality/budgetMs", 250).toInt();
+        system.setFrameBudget(i, settings.value(QString("quality/road%1BudgetMs").arg(i + 1), budget).toInt());
+    }
+
+    system.setRedMinimumFrameRate(settings.value("scheduler/redMinFps", 10.0).toDouble());
+    system.setMaxBatchSize(settings.value("scheduler/maxBatch", 4).toInt());
+    for (int i = 0; i < system.getRoadCount(); ++i) {
+        const double minFps = settings.value("scheduler/minFps", 2.0).toDouble();
+        system.setMinimumFrameRate(i, settings.value(QString("scheduler/road%1MinFps").arg(i + 1), minFps).toDouble());
+    }
+
+    // Needs the timing and layout only, not the models.
+    if (parser.isSet(simulateOption)) return runSimulation(settings, system);
+
+    if (!system.initializeSystem()) return 1;
+    // Thresholds live in the pool, which initializeSystem() creates.
+    system.setYoloThresholds(settings.value("inference/confidence", 0.5).toFloat(), settings.value("inference/nms", 0.4).toFloat());
+
+    const int metricsPort = parser.isSet(metricsOption) ? parser.value(metricsOption).toInt() : settings.value("metrics/port", 9464).toInt();
+    if (metricsPort > 0) system.startMetricsServer(static_cast<quint16>(metricsPort));
+
+    // The first intersection's board was auto-detected by initializeSystem(); explicit ports replace it.
+    std::vector<QString> arduinoPorts(system.getIntersectionCount());
+    arduinoPorts[0] = settings.value("arduino/port").toString();
+    for (int i = 0; i < system.getIntersectionCount(); ++i) {
+        const QString key = QString("arduino/intersection%1").arg(i + 1);
+        if (settings.contains(key)) arduinoPorts[i] = settings.value(key).toString();
+    }
+    for (const QString& arduino : parser.values(arduinoOption)) {
+        const int separator = arduino.indexOf('=');
+        const int intersection = separator < 0 ? 0 : arduino.left(separator).toInt() - 1;
+        if (intersection < 0 || intersection >= system.getIntersectionCount()) {
+            err << "Ignoring arduino '" << arduino << "': no such intersection\n";
+            continue;
+        }
+        arduinoPorts[intersection] = arduino.mid(separator + 1);
+    }
+    for (int i = 0; i < system.getIntersectionCount(); ++i) {
+        if (arduinoPorts[i] == "sim") system.setArduinoSimulationMode(true, i);
+        else if (!arduinoPorts[i].isEmpty()) system.initializeArduino(arduinoPorts[i], i);
+    }
+
+    QStringList cameras;
+    for (int i = 0; i < system.getRoadCount(); ++i) {
+        const QString source = settings.value(QString("cameras/road%1").arg(i + 1)).toString();
+        if (!source.isEmpty()) cameras << QString("%1=%2").arg(i + 1).arg(source);
+    }
+    cameras << parser.values(cameraOption);
+    for (const QString& camera : cameras) {
+        const int separator = camera.indexOf('=');
+        const int road = camera.left(separator).toInt() - 1;
+        if (separator < 0 || road < 0 || road >= system.getRoadCount()) {
+            err << "Ignoring camera '" << camera << "': expected road=source with road 1-" << system.getRoadCount() << "\n";
+            continue;
+        }
+        system.connectCamera(road, camera.mid(separator + 1));
+    }
+
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    QTimer signalPoll;
+    QObject::connect(&signalPoll, &QTimer::timeout, &app, [&app]() {
+        if (stopSignal) app.quit();
+    });
+    signalPoll.start(200);
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &system, &TrafficSystem::stopSystem);
+
+    system.startSystem();
+    return app.exec();
+}
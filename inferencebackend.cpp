@@ -0,0 +1,248 @@
+#include "inferencebackend.h"
+#include <opencv2/dnn.hpp>
+
+#ifdef STMS_WITH_ONNXRUNTIME
+#include <onnxruntime_cxx_api.h>
+#endif
+#ifdef STMS_WITH_OPENVINO
+#include <openvino/openvino.hpp>
+#endif
+
+namespace {
+
+class OpenCvDnnBackend : public InferenceBackend
+{
+public:
+    Type getType() const override { return Type::OpenCvDnn; }
+
+    void load(const QString& modelPath, int threads) override {
+        net = cv::dnn::readNetFromONNX(modelPath.toStdString());
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        outputNames = net.getUnconnectedOutLayersNames();
+        if (threads > 0) cv::setNumThreads(threads);
+    }
+
+    void infer(const cv::Mat& input, std::vector<cv::Mat>& outputs) override {
+        net.setInput(input);
+        net.forward(outputs, outputNames);
+    }
+
+    QString describe() const override {
+        return QString("OpenCV DNN %1, %2 threads (process-wide)").arg(CV_VERSION).arg(cv::getNumThreads());
+    }
+
+private:
+    cv::dnn::Net net;
+    std::vector<std::string> outputNames;
+};
+
+// Shapes as OpenCV wants them; every dimension of a runtime tensor is known.
+template <typename Dimension>
+std::vector<int> matSizes(const std::vector<Dimension>& shape) {
+    return std::vector<int>(shape.begin(), shape.end());
+}
+
+#ifdef STMS_WITH_ONNXRUNTIME
+// CPU execution provider. FP16 models get their input converted here and
+// their outputs converted back, INT8 (QDQ) models run their quantized kernels.
+class OnnxRuntimeBackend : public InferenceBackend
+{
+public:
+    Type getType() const override { return Type::OnnxRuntime; }
+
+    void load(const QString& modelPath, int threads) override {
+        try {
+            Ort::SessionOptions options;
+            if (threads > 0) options.SetIntraOpNumThreads(threads);
+            // The worker runs one request at a time; extra inter-op threads would only idle.
+            options.SetInterOpNumThreads(1);
+            options.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+            options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+#ifdef _WIN32
+            session = std::make_unique<Ort::Session>(environment(), modelPath.toStdWString().c_str(), options);
+#else
+            session = std::make_unique<Ort::Session>(environment(), modelPath.toStdString().c_str(), options);
+#endif
+            this->threads = threads;
+
+            Ort::AllocatorWithDefaultOptions allocator;
+            inputName = session->GetInputNameAllocated(0, allocator).get();
+            inputType = session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetElementType();
+            outputNames.clear();
+            for (size_t i = 0; i < session->GetOutputCount(); ++i) {
+                outputNames.push_back(session->GetOutputNameAllocated(i, allocator).get());
+            }
+            outputNamePointers.clear();
+            for (const std::string& name : outputNames) outputNamePointers.push_back(name.c_str());
+        } catch (const Ort::Exception& e) {
+            CV_Error(cv::Error::StsError, std::string("ONNX Runtime: ") + e.what());
+        }
+    }
+
+    void infer(const cv::Mat& input, std::vector<cv::Mat>& outputs) override {
+        CV_Assert(session && input.isContinuous() && input.type() == CV_32F);
+        try {
+            const std::vector<int64_t> shape(input.size.p, input.size.p + input.dims);
+            Ort::Value tensor{nullptr};
+            if (inputType == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+                input.convertTo(halfInput, CV_16F);
+                tensor = Ort::Value::CreateTensor(memoryInfo, halfInput.data, halfInput.total() * halfInput.elemSize(),
+                                                  shape.data(), shape.size(), ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16);
+            } else {
+                tensor = Ort::Value::CreateTensor<float>(memoryInfo, const_cast<float*>(input.ptr<float>()), input.total(),
+                                                         shape.data(), shape.size());
+            }
+
+            const char* inputNames[] = {inputName.c_str()};
+            std::vector<Ort::Value> results = session->Run(Ort::RunOptions{nullptr}, inputNames, &tensor, 1,
+                                                           outputNamePointers.data(), outputNamePointers.size());
+            outputs.resize(results.size());
+            for (size_t i = 0; i < results.size(); ++i) {
+                const Ort::TensorTypeAndShapeInfo info = results[i].GetTensorTypeAndShapeInfo();
+                const std::vector<int> sizes = matSizes(info.GetShape());
+                if (info.GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+                    cv::Mat(static_cast<int>(sizes.size()), sizes.data(), CV_16F, results[i].GetTensorMutableRawData()).convertTo(outputs[i], CV_32F);
+                } else {
+                    cv::Mat(static_cast<int>(sizes.size()), sizes.data(), CV_32F, results[i].GetTensorMutableData<float>()).copyTo(outputs[i]);
+                }
+            }
+        } catch (const Ort::Exception& e) {
+            CV_Error(cv::Error::StsError, std::string("ONNX Runtime: ") + e.what());
+        }
+    }
+
+    QString describe() const override {
+        return QString("ONNX Runtime %1 CPU, %2 intra-op threads").arg(OrtGetApiBase()->GetVersionString())
+            .arg(threads > 0 ? QString::number(threads) : QString("default"));
+    }
+
+private:
+    // One environment per process, shared by every worker's session.
+    static Ort::Env& environment() {
+        static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "stms");
+        return env;
+    }
+
+    std::unique_ptr<Ort::Session> session;
+    Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::string inputName;
+    ONNXTensorElementDataType inputType = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+    std::vector<std::string> outputNames;
+    std::vector<const char*> outputNamePointers;
+    cv::Mat halfInput;
+    int threads = 0;
+};
+#endif
+
+#ifdef STMS_WITH_OPENVINO
+// CPU plugin, tuned for latency. Reads ONNX as well as IR (.xml) models; the
+// pre/post-processing steps make the model take and return f32 whatever its
+// own precision, so FP16 and INT8 IRs need no conversion here.
+class OpenVinoBackend : public InferenceBackend
+{
+public:
+    Type getType() const override { return Type::OpenVino; }
+
+    void load(const QString& modelPath, int threads) override {
+        try {
+            std::shared_ptr<ov::Model> model = core.read_model(modelPath.toStdString());
+            ov::preprocess::PrePostProcessor prePost(model);
+            prePost.input().tensor().set_element_type(ov::element::f32);
+            for (size_t i = 0; i < model->outputs().size(); ++i) prePost.output(i).tensor().set_element_type(ov::element::f32);
+            model = prePost.build();
+
+            ov::AnyMap config{ov::hint::performance_mode(ov::hint::PerformanceMode::LATENCY)};
+            if (threads > 0) config.insert(ov::inference_num_threads(threads));
+            compiled = core.compile_model(model, "CPU", config);
+            request = compiled.create_infer_request();
+            this->threads = compiled.get_property(ov::inference_num_threads);
+        } catch (const ov::Exception& e) {
+            CV_Error(cv::Error::StsError, std::string("OpenVINO: ") + e.what());
+        }
+    }
+
+    void infer(const cv::Mat& input, std::vector<cv::Mat>& outputs) override {
+        CV_Assert(input.isContinuous() && input.type() == CV_32F);
+        try {
+            // A batch the model was not exported for throws, which sends the worker to per-frame inference.
+            const ov::Shape shape(input.size.p, input.size.p + input.dims);
+            request.set_input_tensor(ov::Tensor(ov::element::f32, shape, const_cast<float*>(input.ptr<float>())));
+            request.infer();
+
+            outputs.resize(compiled.outputs().size());
+            for (size_t i = 0; i < outputs.size(); ++i) {
+                ov::Tensor output = request.get_output_tensor(i);
+                const std::vector<int> sizes = matSizes(output.get_shape());
+                cv::Mat(static_cast<int>(sizes.size()), sizes.data(), CV_32F, output.data<float>()).copyTo(outputs[i]);
+            }
+        } catch (const ov::Exception& e) {
+            CV_Error(cv::Error::StsError, std::string("OpenVINO: ") + e.what());
+        }
+    }
+
+    QString describe() const override {
+        return QString("OpenVINO %1 CPU, %2 inference threads").arg(ov::get_openvino_version().buildNumber).arg(threads);
+    }
+
+private:
+    ov::Core core;
+    ov::CompiledModel compiled;
+    ov::InferRequest request;
+    int threads = 0;
+};
+#endif
+
+}
+
+std::unique_ptr<InferenceBackend> InferenceBackend::create(Type type) {
+    switch (type) {
+    case Type::OpenCvDnn:
+        return std::make_unique<OpenCvDnnBackend>();
+    case Type::OnnxRuntime:
+#ifdef STMS_WITH_ONNXRUNTIME
+        return std::make_unique<OnnxRuntimeBackend>();
+#else
+        break;
+#endif
+    case Type::OpenVino:
+#ifdef STMS_WITH_OPENVINO
+        return std::make_unique<OpenVinoBackend>();
+#else
+        break;
+#endif
+    }
+    return nullptr;
+}
+
+bool InferenceBackend::isAvailable(Type type) {
+    switch (type) {
+    case Type::OpenCvDnn: return true;
+#ifdef STMS_WITH_ONNXRUNTIME
+    case Type::OnnxRuntime: return true;
+#endif
+#ifdef STMS_WITH_OPENVINO
+    case Type::OpenVino: return true;
+#endif
+    default: return false;
+    }
+}
+
+QString InferenceBackend::typeName(Type type) {
+    switch (type) {
+    case Type::OpenCvDnn: return "opencv";
+    case Type::OnnxRuntime: return "onnxruntime";
+    case Type::OpenVino: return "openvino";
+    }
+    return QString();
+}
+
+bool InferenceBackend::parseType(const QString& name, Type& type) {
+    for (Type candidate : {Type::OpenCvDnn, Type::OnnxRuntime, Type::OpenVino}) {
+        if (name.compare(typeName(candidate), Qt::CaseInsensitive) == 0) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
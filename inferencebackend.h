@@ -0,0 +1,40 @@
+#ifndef INFERENCEBACKEND_H
+#define INFERENCEBACKEND_H
+
+#include <QString>
+#include <opencv2/core.hpp>
+#include <memory>
+#include <vector>
+
+// Runs the YOLO network for one ProcessingWorker. OpenCV DNN is always built;
+// ONNX Runtime and OpenVINO are compiled in with CONFIG+=onnxruntime and
+// CONFIG+=openvino (see inferencebackends.pri). FP32, FP16 and quantized INT8
+// (QDQ) exports all load; inputs and outputs stay float on our side whatever
+// the model's own precision. Failures are thrown as cv::Exception so callers
+// handle every backend the same way.
+class InferenceBackend
+{
+public:
+    enum class Type { OpenCvDnn = 0, OnnxRuntime, OpenVino };
+
+    virtual ~InferenceBackend() {}
+
+    virtual Type getType() const = 0;
+    // threads: intra-op threads for this instance, 0 for the backend's default.
+    // OpenCV's thread count is process-wide, so its instances share the last value set.
+    virtual void load(const QString& modelPath, int threads) = 0;
+    // input is a continuous N x 3 x S x S CV_32F tensor; outputs get one CV_32F
+    // Mat per model output, shaped as exported. Buffers are reused between calls.
+    virtual void infer(const cv::Mat& input, std::vector<cv::Mat>& outputs) = 0;
+    // Library version and effective settings, for logs and benchmark reports.
+    virtual QString describe() const = 0;
+
+    // nullptr when the backend was not compiled in.
+    static std::unique_ptr<InferenceBackend> create(Type type);
+    static bool isAvailable(Type type);
+    static QString typeName(Type type);
+    // Accepts the names typeName() returns: "opencv", "onnxruntime" and "openvino".
+    static bool parseType(const QString& name, Type& type);
+};
+
+#endif // INFERENCEBACKEND_H
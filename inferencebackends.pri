@@ -0,0 +1,24 @@
+# Optional inference backends next to OpenCV DNN, e.g.
+#   qmake CONFIG+=onnxruntime ONNXRUNTIME_DIR=/opt/onnxruntime
+#   qmake CONFIG+=openvino OPENVINO_DIR=C:/openvino    (Linux finds it through pkg-config)
+
+onnxruntime {
+    DEFINES += STMS_WITH_ONNXRUNTIME
+    isEmpty(ONNXRUNTIME_DIR): ONNXRUNTIME_DIR = $$(ONNXRUNTIME_DIR)
+    INCLUDEPATH += $$ONNXRUNTIME_DIR/include
+    LIBS += -L$$ONNXRUNTIME_DIR/lib -lonnxruntime
+}
+
+openvino {
+    DEFINES += STMS_WITH_OPENVINO
+    win32 {
+        isEmpty(OPENVINO_DIR): OPENVINO_DIR = $$(OPENVINO_DIR)
+        INCLUDEPATH += $$OPENVINO_DIR/runtime/include
+        CONFIG(release, debug|release): LIBS += -L$$OPENVINO_DIR/runtime/lib/intel64/Release -lopenvino
+        CONFIG(debug, debug|release): LIBS += -L$$OPENVINO_DIR/runtime/lib/intel64/Debug -lopenvinod
+    }
+    unix {
+        CONFIG += link_pkgconfig
+        PKGCONFIG += openvino
+    }
+}
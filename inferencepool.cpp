@@ -0,0 +1,247 @@
+#include "inferencepool.h"
+
+InferencePool::InferencePool(QObject *parent) : QObject(parent) {
+    monotonicClock.start();
+}
+
+InferencePool::~InferencePool() {
+    shutdown();
+}
+
+bool InferencePool::initialize(int workerCount, const QString& yoloModelPath, const QString& cocoNamesPath) {
+    shutdown();
+    workerCount = qMax(1, workerCount);
+
+    // Workers run their forward passes at the same time, so by default each gets its
+    // share of the cores instead of every one of them trying to use all of them.
+    const int threads = backendThreads > 0 ? backendThreads : qMax(1, QThread::idealThreadCount() / workerCount);
+
+    for (int i = 0; i < workerCount; ++i) {
+        ProcessingWorker* worker = new ProcessingWorker();
+        worker->setMetrics(metrics);
+        worker->setInferenceBackend(backendType, threads);
+        worker->setTilingOptions(tilingOptions);
+        // Forwarded on the emitting thread; the listener is the thread-safe logger.
+        connect(worker, &ProcessingWorker::logMessage, this, &InferencePool::logMessage, Qt::DirectConnection);
+        if (!worker->initializeModels(yoloModelPath, cocoNamesPath)) {
+            delete worker;
+            shutdown();
+            return false;
+        }
+
+        QThread* thread = new QThread(this);
+        thread->setObjectName(QString("InferenceWorker%1").arg(i));
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+        connect(worker, &ProcessingWorker::processingFinished, this,
+                [this, i](int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs,
+                          const FrameRef& frame, qint64 capturedAtMs) {
+                    handleWorkerFinished(i, roadIndex, displayFrame, vehicleCount, violatingVehicleIDs, frame, capturedAtMs);
+                }, Qt::QueuedConnection);
+        thread->start();
+
+        WorkerSlot slot;
+        slot.thread = thread;
+        slot.worker = worker;
+        workers.push_back(slot);
+    }
+
+    emit logMessage(QString("Inference pool started with %1 worker(s) on %2.").arg(workerCount).arg(workers[0].worker->describeInferenceBackend()), "INFO");
+    return true;
+}
+
+void InferencePool::shutdown() {
+    for (WorkerSlot& slot : workers) {
+        slot.thread->quit();
+        slot.thread->wait();
+        delete slot.thread;
+    }
+    workers.clear();
+    for (RoadQueue& queue : roadQueues) {
+        queue.pending.clear();
+        queue.inFlight = false;
+        queue.resetPending = false;
+    }
+}
+
+int InferencePool::addRoads(int count) {
+    const int first = getRoadCount();
+    for (int i = 0; i < count; ++i) {
+        roadQueues.emplace_back();
+        trackStates.emplace_back();
+    }
+    scheduler.setRoadCount(getRoadCount());
+    return first;
+}
+
+void InferencePool::submitFrame(const FrameJob& job) {
+    if (job.roadIndex < 0 || job.roadIndex >= getRoadCount() || !job.frame || job.frame->empty() || workers.empty()) return;
+
+    RoadQueue& queue = roadQueues[job.roadIndex];
+    while (static_cast<int>(queue.pending.size()) >= maxQueueDepth) {
+        queue.pending.pop_front();
+        queue.droppedJobs++;
+        if (metrics) metrics->increment(Metrics::Counter::QueueDropped, job.roadIndex);
+    }
+    if (metrics) metrics->increment(Metrics::Counter::FramesSubmitted, job.roadIndex);
+    PendingJob pending;
+    pending.sequence = nextSequence++;
+    pending.submittedNs = monotonicClock.nsecsElapsed();
+    pending.job = job;
+    pending.job.trackState = &trackStates[job.roadIndex];
+    queue.pending.push_back(pending);
+
+    dispatch();
+}
+
+void InferencePool::resetRoad(int roadIndex) {
+    if (roadIndex < 0 || roadIndex >= getRoadCount()) return;
+    RoadQueue& queue = roadQueues[roadIndex];
+    queue.pending.clear();
+    queue.framesSinceDetection = 0;
+    queue.lastDisplayNs = -1;
+    // A worker may be using the track state right now; it is only touched once the road is back.
+    if (queue.inFlight) queue.resetPending = true;
+    else trackStates[roadIndex] = RoadTrackState();
+}
+
+void InferencePool::updateRoadSchedule(int roadIndex, TrafficLight light, int phaseSecondsLeft, int trackCount) {
+    scheduler.updateRoad(roadIndex, light, phaseSecondsLeft, trackCount);
+}
+
+void InferencePool::setYoloThresholds(float confidence, float nms) {
+    for (WorkerSlot& slot : workers) {
+        ProcessingWorker* worker = slot.worker;
+        QMetaObject::invokeMethod(worker, [worker, confidence, nms]() {
+            worker->setYoloThresholds(confidence, nms);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void InferencePool::setMotionGateEnabled(bool enabled) {
+    for (WorkerSlot& slot : workers) {
+        ProcessingWorker* worker = slot.worker;
+        QMetaObject::invokeMethod(worker, [worker, enabled]() {
+            worker->setMotionGateEnabled(enabled);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void InferencePool::setDetectorInterval(int roadIndex, int interval) {
+    if (roadIndex < 0 || roadIndex >= getRoadCount()) return;
+    RoadQueue& queue = roadQueues[roadIndex];
+    queue.detectorInterval = qMax(1, interval);
+    queue.framesSinceDetection = 0;
+}
+
+void InferencePool::setDisplaySize(int roadIndex, const cv::Size& size) {
+    if (roadIndex < 0 || roadIndex >= getRoadCount()) return;
+    roadQueues[roadIndex].displaySize = size;
+}
+
+void InferencePool::setDisplayMaxFps(int roadIndex, int maxFps) {
+    if (roadIndex < 0 || roadIndex >= getRoadCount()) return;
+    roadQueues[roadIndex].displayMaxFps = qMax(0, maxFps);
+}
+
+void InferencePool::setRoadQuality(int roadIndex, const RoadQuality& quality) {
+    if (roadIndex < 0 || roadIndex >= getRoadCount()) return;
+    RoadQueue& queue = roadQueues[roadIndex];
+    if (queue.quality.detectorIntervalFactor != quality.detectorIntervalFactor) queue.framesSinceDetection = 0;
+    queue.quality = quality;
+    queue.quality.detectorIntervalFactor = qMax(1, quality.detectorIntervalFactor);
+}
+
+int InferencePool::getBusyWorkerCount() const {
+    int busy = 0;
+    for (const WorkerSlot& slot : workers) {
+        if (slot.outstandingRoads > 0) busy++;
+    }
+    return busy;
+}
+
+quint64 InferencePool::getDroppedJobCount(int roadIndex) const {
+    if (roadIndex < 0 || roadIndex >= getRoadCount()) return 0;
+    return roadQueues[roadIndex].droppedJobs;
+}
+
+void InferencePool::dispatch() {
+    std::vector<int> idleWorkers;
+    for (int i = 0; i < static_cast<int>(workers.size()); ++i) {
+        if (workers[i].outstandingRoads == 0) idleWorkers.push_back(i);
+    }
+
+    for (size_t w = 0; w < idleWorkers.size(); ++w) {
+        // Roads that have work and are not already on a worker, most urgent first.
+        std::vector<int> readyRoads;
+        for (int r = 0; r < getRoadCount(); ++r) {
+            if (!roadQueues[r].inFlight && !roadQueues[r].pending.empty()) readyRoads.push_back(r);
+        }
+        if (readyRoads.empty()) return;
+        const qint64 scheduledNs = monotonicClock.nsecsElapsed();
+        scheduler.order(readyRoads, scheduledNs);
+
+        // Spread the ready roads over the idle workers instead of batching them all onto one.
+        size_t idleLeft = idleWorkers.size() - w;
+        size_t take = batchingEnabled ? qMin((readyRoads.size() + idleLeft - 1) / idleLeft, static_cast<size_t>(maxBatchSize)) : 1;
+
+        std::vector<FrameJob> jobs;
+        for (size_t k = 0; k < take; ++k) {
+            RoadQueue& queue = roadQueues[readyRoads[k]];
+            FrameJob job = queue.pending.front().job;
+            queue.inFlightSubmittedNs = queue.pending.front().submittedNs;
+            queue.pending.pop_front();
+            queue.inFlight = true;
+            scheduler.markDispatched(job.roadIndex, scheduledNs);
+            if (metrics) metrics->record(Metrics::Stage::Queue, job.roadIndex, (monotonicClock.nsecsElapsed() - queue.inFlightSubmittedNs) / 1000);
+
+            // Decided at dispatch time so dropped frames don't postpone the next detection.
+            const int detectorInterval = queue.detectorInterval * queue.quality.detectorIntervalFactor;
+            job.runDetector = queue.framesSinceDetection == 0;
+            job.refineTracks = trackRefinementEnabled && detectorInterval > 1;
+            queue.framesSinceDetection = (queue.framesSinceDetection + 1) % detectorInterval;
+
+            const int displayMaxFps = queue.quality.displayMaxFps == 0 ? queue.displayMaxFps
+                                      : queue.displayMaxFps == 0 ? queue.quality.displayMaxFps
+                                      : qMin(queue.displayMaxFps, queue.quality.displayMaxFps);
+            const qint64 nowNs = monotonicClock.nsecsElapsed();
+            job.renderDisplay = displayEnabled
+                                && (displayMaxFps == 0 || queue.lastDisplayNs < 0
+                                    || nowNs - queue.lastDisplayNs >= 1000000000LL / displayMaxFps);
+            if (job.renderDisplay) queue.lastDisplayNs = nowNs;
+            job.displaySize = queue.displaySize;
+            job.maxInputSize = queue.quality.maxInputSize;
+            job.maxTiles = queue.quality.maxTiles;
+            jobs.push_back(job);
+        }
+
+        WorkerSlot& slot = workers[idleWorkers[w]];
+        slot.outstandingRoads = static_cast<int>(jobs.size());
+        ProcessingWorker* worker = slot.worker;
+        QMetaObject::invokeMethod(worker, [worker, jobs]() {
+            worker->processBatch(jobs);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void InferencePool::handleWorkerFinished(int workerIndex, int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs,
+                                         const FrameRef& frame, qint64 capturedAtMs) {
+    if (workerIndex >= 0 && workerIndex < static_cast<int>(workers.size()) && workers[workerIndex].outstandingRoads > 0) {
+        workers[workerIndex].outstandingRoads--;
+    }
+    bool discard = false;
+    if (roadIndex >= 0 && roadIndex < getRoadCount()) {
+        RoadQueue& queue = roadQueues[roadIndex];
+        queue.inFlight = false;
+        if (metrics) metrics->record(Metrics::Stage::Pipeline, roadIndex, (monotonicClock.nsecsElapsed() - queue.inFlightSubmittedNs) / 1000);
+        if (queue.resetPending) {
+            // The result belongs to the source the road had before resetRoad().
+            queue.resetPending = false;
+            trackStates[roadIndex] = RoadTrackState();
+            discard = true;
+        }
+    }
+
+    if (!discard) emit processingFinished(roadIndex, displayFrame, vehicleCount, violatingVehicleIDs, frame, capturedAtMs);
+    dispatch();
+}
@@ -0,0 +1,133 @@
+#ifndef INFERENCEPOOL_H
+#define INFERENCEPOOL_H
+
+#include <QObject>
+#include <QThread>
+#include <QImage>
+#include <QElapsedTimer>
+#include "processingworker.h"
+#include "framescheduler.h"
+
+#include <deque>
+#include <vector>
+
+// Per-road reductions the quality governor applies on top of the configured settings.
+struct RoadQuality {
+    int detectorIntervalFactor = 1;
+    int displayMaxFps = 0;      // cap, 0: none
+    int maxInputSize = 0;       // 0: none
+    int maxTiles = 0;           // 0: none
+};
+
+// Runs several ProcessingWorkers, each with its own network and thread.
+// Roads are not pinned to a worker: frames wait in per-road queues and the
+// next idle worker takes the most urgent pending roads as ranked by the
+// FrameScheduler, while each road stays on at most one worker at a time so
+// its tracker state remains consistent.
+// Every road of every intersection in the process goes through one pool, so
+// the model is loaded once per worker rather than once per junction.
+class InferencePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InferencePool(QObject *parent = nullptr);
+    ~InferencePool();
+
+    bool initialize(int workerCount, const QString& yoloModelPath, const QString& cocoNamesPath);
+    void shutdown();
+
+    // Registers count more roads and returns the index of the first one. Roads are never removed.
+    int addRoads(int count);
+    int getRoadCount() const { return static_cast<int>(roadQueues.size()); }
+
+    // Backend of every worker and its intra-op threads per worker (0: an even share of the cores). Before initialize().
+    void setInferenceBackend(InferenceBackend::Type type, int threadsPerWorker) { backendType = type; backendThreads = qMax(0, threadsPerWorker); }
+    // Input sizes and tiling of the regions of interest. Before initialize().
+    void setTilingOptions(const TilingOptions& options) { tilingOptions = options; }
+
+    void submitFrame(const FrameJob& job);
+    // Drops the road's queued frames and starts its tracks and motion gate afresh, e.g. for a new
+    // camera. A frame still on a worker is discarded when it returns, and the state is reset then.
+    void resetRoad(int roadIndex);
+    void setBatchingEnabled(bool enabled) { batchingEnabled = enabled; }
+    // Roads one worker takes at once, so a burst doesn't tie the urgent ones to a long batch.
+    void setMaxBatchSize(int size) { maxBatchSize = qMax(1, size); }
+    void setMaxQueueDepth(int depth) { maxQueueDepth = qMax(1, depth); }
+    // Signal phase and traffic the scheduler ranks the road by; refreshed with every frame.
+    void updateRoadSchedule(int roadIndex, TrafficLight light, int phaseSecondsLeft, int trackCount);
+    // Guaranteed frame rates, see FrameScheduler.
+    void setMinimumFrameRate(int roadIndex, double fps) { scheduler.setMinimumRate(roadIndex, fps); }
+    void setRedMinimumFrameRate(double fps) { scheduler.setRedMinimumRate(fps); }
+    void setYoloThresholds(float confidence, float nms);
+    // Run YOLO on every Nth frame of a road; the frames in between are served by the tracker.
+    void setDetectorInterval(int roadIndex, int interval);
+    void setTrackRefinementEnabled(bool enabled) { trackRefinementEnabled = enabled; }
+    void setMotionGateEnabled(bool enabled);
+    // Previews are rendered at the view's size, at most maxFps times a second (0: every frame).
+    void setDisplaySize(int roadIndex, const cv::Size& size);
+    void setDisplayMaxFps(int roadIndex, int maxFps);
+    void setRoadQuality(int roadIndex, const RoadQuality& quality);
+    // Without a view nothing is rendered at all.
+    void setDisplayEnabled(bool enabled) { displayEnabled = enabled; }
+    // Queue wait and submit-to-result latency per road, plus the workers' stage timings. Before initialize().
+    void setMetrics(Metrics* metrics) { this->metrics = metrics; }
+
+    int getWorkerCount() const { return static_cast<int>(workers.size()); }
+    int getBusyWorkerCount() const;
+    quint64 getDroppedJobCount(int roadIndex) const;
+
+signals:
+    void processingFinished(int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs,
+                            const FrameRef& frame, qint64 capturedAtMs);
+    void logMessage(const QString& message, const QString& level);
+
+private:
+    struct WorkerSlot {
+        QThread* thread = nullptr;
+        ProcessingWorker* worker = nullptr;
+        int outstandingRoads = 0;
+    };
+
+    struct PendingJob {
+        quint64 sequence = 0;
+        qint64 submittedNs = 0;
+        FrameJob job;
+    };
+
+    struct RoadQueue {
+        std::deque<PendingJob> pending;
+        bool inFlight = false;
+        bool resetPending = false; // reset once the frame in flight is back
+        qint64 inFlightSubmittedNs = 0;
+        quint64 droppedJobs = 0;
+        int detectorInterval = 1;
+        int framesSinceDetection = 0;
+        cv::Size displaySize;
+        int displayMaxFps = 15;
+        qint64 lastDisplayNs = -1;
+        RoadQuality quality;
+    };
+
+    std::vector<WorkerSlot> workers;
+    std::vector<RoadQueue> roadQueues;
+    std::deque<RoadTrackState> trackStates; // a deque so workers' references survive addRoads()
+    quint64 nextSequence = 0;
+    QElapsedTimer monotonicClock;
+    int maxQueueDepth = 2;
+    int maxBatchSize = 4;
+    FrameScheduler scheduler;
+    bool batchingEnabled = true;
+    bool trackRefinementEnabled = true;
+    bool displayEnabled = true;
+    Metrics* metrics = nullptr;
+    InferenceBackend::Type backendType = InferenceBackend::Type::OpenCvDnn;
+    int backendThreads = 0;
+    TilingOptions tilingOptions;
+
+    void dispatch();
+    void handleWorkerFinished(int workerIndex, int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs,
+                              const FrameRef& frame, qint64 capturedAtMs);
+};
+
+#endif // INFERENCEPOOL_H
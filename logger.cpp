@@ -0,0 +1,232 @@
+#include "logger.h"
+#include <QMutexLocker>
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <algorithm>
+
+Logger::Logger(const QString& directory, QObject *parent)
+    : QThread(parent),
+    directory(directory),
+    ring(new Slot[RING_CAPACITY])
+{
+    for (int i = 0; i < RING_CAPACITY; ++i) ring[i].turn.store(static_cast<quint64>(i), std::memory_order_relaxed);
+
+    rateLimits[static_cast<int>(Level::Debug)] = 10;
+    rateLimits[static_cast<int>(Level::Info)] = 50;
+    rateLimits[static_cast<int>(Level::Action)] = 50;
+    rateLimits[static_cast<int>(Level::Violation)] = 0;
+    rateLimits[static_cast<int>(Level::Warning)] = 20;
+    rateLimits[static_cast<int>(Level::Error)] = 20;
+
+    QDir().mkpath(directory);
+}
+
+Logger::~Logger() {
+    stop();
+}
+
+void Logger::setFileLimits(qint64 bytes, int files) {
+    QMutexLocker locker(&fileMutex);
+    maxFileBytes = qMax<qint64>(64 * 1024, bytes);
+    maxFiles = qMax(1, files);
+}
+
+void Logger::setRateLimit(Level level, int perSecond) {
+    rateLimits[static_cast<int>(level)] = qMax(0, perSecond);
+}
+
+bool Logger::log(Level level, const QString& source, const QString& message) {
+    Entry entry;
+    entry.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    entry.level = level;
+    entry.source = source;
+
+    const int limit = level == Level::Violation ? 0 : rateLimits[static_cast<int>(level)].load(std::memory_order_relaxed);
+    if (limit > 0) {
+        // Buckets are shared on hash collisions, which only makes the limit stricter.
+        const uint hash = qHash(source) ^ (static_cast<uint>(level) * 0x9e3779b9u);
+        RateBucket& bucket = rateBuckets[hash % RATE_BUCKET_COUNT];
+        const qint64 second = entry.timestampMs / 1000;
+        qint64 seen = bucket.second.load(std::memory_order_relaxed);
+        if (seen != second && bucket.second.compare_exchange_strong(seen, second)) {
+            bucket.count.store(0);
+            const int suppressed = bucket.suppressed.exchange(0);
+            if (suppressed > 0) {
+                Entry summary = entry;
+                summary.level = Level::Warning;
+                summary.message = QString("%1 %2 message(s) suppressed by the rate limit.").arg(suppressed).arg(levelName(level));
+                push(summary);
+            }
+        }
+        if (bucket.count.fetch_add(1) >= limit) {
+            bucket.suppressed.fetch_add(1);
+            rateLimited.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    entry.message = message;
+    return push(entry);
+}
+
+// Bounded MPSC ring: a producer claims a position with a CAS and publishes the
+// slot by advancing its turn; the single consumer hands the slot back a lap later.
+bool Logger::push(Entry& entry) {
+    quint64 position = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &ring[position & (RING_CAPACITY - 1)];
+        const quint64 turn = slot->turn.load(std::memory_order_acquire);
+        const qint64 difference = static_cast<qint64>(turn - position);
+        if (difference == 0) {
+            if (enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        } else if (difference < 0) {
+            overflowed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->entry = std::move(entry);
+    slot->turn.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool Logger::pop(Entry& entry) {
+    Slot& slot = ring[dequeuePos & (RING_CAPACITY - 1)];
+    if (slot.turn.load(std::memory_order_acquire) != dequeuePos + 1) return false;
+    entry = std::move(slot.entry);
+    slot.turn.store(dequeuePos + RING_CAPACITY, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+void Logger::stop() {
+    stopRequested = true;
+    if (isRunning()) wait();
+}
+
+void Logger::run() {
+    std::vector<Entry> batch;
+    batch.reserve(512);
+    for (;;) {
+        Entry entry;
+        while (batch.size() < 512 && pop(entry)) batch.push_back(std::move(entry));
+        if (!batch.empty()) {
+            writeBatch(batch);
+            batch.clear();
+            continue;
+        }
+        if (stopRequested) break; // everything queued is written
+        QThread::msleep(20);
+    }
+    QMutexLocker locker(&fileMutex);
+    if (file.isOpen()) file.close();
+}
+
+void Logger::writeBatch(std::vector<Entry>& batch) {
+    QByteArray text;
+    for (Entry& entry : batch) {
+        entry.sequence = nextSequence++;
+        text += QString("%1 %2 [%3] %4\n")
+                    .arg(QDateTime::fromMSecsSinceEpoch(entry.timestampMs).toString("yyyy-MM-dd hh:mm:ss.zzz"))
+                    .arg(levelName(entry.level).leftJustified(9))
+                    .arg(entry.source)
+                    .arg(entry.message)
+                    .toUtf8();
+    }
+
+    {
+        QMutexLocker locker(&fileMutex);
+        if (!file.isOpen()) {
+            file.setFileName(filePath(0));
+            file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+        }
+        if (file.isOpen()) {
+            file.write(text);
+            file.flush();
+            written += batch.size();
+            if (file.size() >= maxFileBytes) rotate();
+        }
+    }
+
+    QMutexLocker locker(&tailMutex);
+    for (Entry& entry : batch) tailEntries.push_back(std::move(entry));
+    while (static_cast<int>(tailEntries.size()) > TAIL_CAPACITY) tailEntries.pop_front();
+}
+
+// stms.log becomes stms.1.log and so on; the oldest generation is deleted.
+void Logger::rotate() {
+    file.close();
+    QFile::remove(filePath(maxFiles - 1));
+    for (int generation = maxFiles - 2; generation >= 0; --generation) {
+        if (QFile::exists(filePath(generation))) QFile::rename(filePath(generation), filePath(generation + 1));
+    }
+    file.setFileName(filePath(0));
+    file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
+
+std::vector<Logger::Entry> Logger::tail(quint64 afterSequence, int maxCount) const {
+    std::vector<Entry> entries;
+    QMutexLocker locker(&tailMutex);
+    auto it = tailEntries.end();
+    while (it != tailEntries.begin() && static_cast<int>(entries.size()) < maxCount) {
+        --it;
+        if (it->sequence <= afterSequence) break;
+        entries.push_back(*it);
+    }
+    std::reverse(entries.begin(), entries.end());
+    return entries;
+}
+
+bool Logger::exportTo(const QString& path) const {
+    QMutexLocker locker(&fileMutex);
+    QFile out(path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    for (int generation = maxFiles - 1; generation >= 0; --generation) {
+        QFile in(filePath(generation));
+        if (!in.open(QIODevice::ReadOnly)) continue;
+        while (!in.atEnd()) {
+            const QByteArray chunk = in.read(1 << 16);
+            if (out.write(chunk) != chunk.size()) return false;
+        }
+    }
+    return true;
+}
+
+Logger::Stats Logger::getStats() const {
+    Stats stats;
+    {
+        QMutexLocker locker(&fileMutex);
+        stats.written = written;
+    }
+    stats.rateLimited = rateLimited.load();
+    stats.overflowed = overflowed.load();
+    return stats;
+}
+
+QString Logger::filePath(int generation) const {
+    return QDir(directory).filePath(generation == 0 ? QString("stms.log") : QString("stms.%1.log").arg(generation));
+}
+
+Logger::Level Logger::levelFromString(const QString& level) {
+    if (level == "ERROR") return Level::Error;
+    if (level == "WARNING") return Level::Warning;
+    if (level == "VIOLATION") return Level::Violation;
+    if (level == "ACTION") return Level::Action;
+    if (level == "DEBUG") return Level::Debug;
+    return Level::Info;
+}
+
+QString Logger::levelName(Level level) {
+    switch (level) {
+    case Level::Debug: return "DEBUG";
+    case Level::Info: return "INFO";
+    case Level::Action: return "ACTION";
+    case Level::Violation: return "VIOLATION";
+    case Level::Warning: return "WARNING";
+    case Level::Error: return "ERROR";
+    }
+    return "INFO";
+}
@@ -0,0 +1,108 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Log sink shared by every thread. log() never locks: entries go into a
+// bounded multi-producer ring that this thread drains into a rotating file
+// (stms.log, stms.1.log, ...) and a bounded in-memory tail the UI polls.
+// Each source gets a per-level budget of messages per second; the excess is
+// counted and reported in one line instead of flooding the sink.
+class Logger : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum class Level { Debug = 0, Info, Action, Violation, Warning, Error };
+
+    struct Entry {
+        quint64 sequence = 0;       // assigned when written, increasing
+        qint64 timestampMs = 0;
+        Level level = Level::Info;
+        QString source;
+        QString message;
+    };
+
+    struct Stats {
+        quint64 written = 0;
+        quint64 rateLimited = 0;
+        quint64 overflowed = 0;     // ring was full
+    };
+
+    explicit Logger(const QString& directory, QObject *parent = nullptr);
+    ~Logger();
+
+    void setFileLimits(qint64 maxFileBytes, int maxFiles);
+    // Messages per second and source; 0 means unlimited. Violations are never limited.
+    void setRateLimit(Level level, int perSecond);
+
+    // Callable from any thread. Returns false if the message was rate limited or the ring was full.
+    bool log(Level level, const QString& source, const QString& message);
+    bool log(const QString& level, const QString& source, const QString& message) { return log(levelFromString(level), source, message); }
+
+    // Entries written after afterSequence, oldest first; only the newest maxCount if there are more.
+    std::vector<Entry> tail(quint64 afterSequence, int maxCount) const;
+    // Concatenates the rotated files, oldest first, into path.
+    bool exportTo(const QString& path) const;
+    QString getDirectory() const { return directory; }
+    Stats getStats() const;
+    // Writes what is still queued, then stops the thread.
+    void stop();
+
+    static Level levelFromString(const QString& level);
+    static QString levelName(Level level);
+
+protected:
+    void run() override;
+
+private:
+    struct Slot {
+        std::atomic<quint64> turn;
+        Entry entry;
+    };
+    struct RateBucket {
+        std::atomic<qint64> second{-1};
+        std::atomic<int> count{0};
+        std::atomic<int> suppressed{0};
+    };
+
+    static const int RING_CAPACITY = 4096; // power of two
+    static const int RATE_BUCKET_COUNT = 64;
+    static const int TAIL_CAPACITY = 2000;
+
+    QString directory;
+    std::unique_ptr<Slot[]> ring;
+    std::atomic<quint64> enqueuePos{0};
+    quint64 dequeuePos = 0; // this thread only
+    RateBucket rateBuckets[RATE_BUCKET_COUNT];
+    std::atomic<int> rateLimits[6];
+    std::atomic<quint64> rateLimited{0};
+    std::atomic<quint64> overflowed{0};
+    std::atomic<bool> stopRequested{false};
+
+    mutable QMutex fileMutex; // the sink file; rotation against export
+    QFile file;
+    qint64 maxFileBytes = 5ll * 1024 * 1024;
+    int maxFiles = 5;
+    quint64 written = 0;
+
+    mutable QMutex tailMutex;
+    std::deque<Entry> tailEntries;
+    quint64 nextSequence = 1;
+
+    bool push(Entry& entry);
+    bool pop(Entry& entry);
+    void writeBatch(std::vector<Entry>& batch);
+    void rotate();
+    QString filePath(int generation) const;
+};
+
+#endif // LOGGER_H
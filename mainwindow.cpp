@@ -6,12 +6,18 @@
 #include <QDesktopServices>
 #include <QDebug>
 #include <QCloseEvent>
+#include <QScrollBar>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <limits>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
     ui(new Ui::MainWindow),
     trafficSystem(new TrafficSystem(this)),
-    uiUpdateTimer(new QTimer(this))
+    violationModel(new ViolationTableModel(this)),
+    uiUpdateTimer(new QTimer(this)),
+    logRefreshTimer(new QTimer(this))
 {
     ui->setupUi(this);
     this->setWindowTitle("ㅤㅤSmart Traffic Management System");
@@ -26,18 +32,39 @@ MainWindow::MainWindow(QWidget *parent)
 
     initializeUiConnections();
     connectTrafficSystemSignals();
-
-    ui->violations_tableWidget->setColumnCount(3);
-    ui->violations_tableWidget->setHorizontalHeaderLabels({"Timestamp", "Road", "Reason"});
-    ui->violations_tableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-    ui->violations_tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    // The [metrics] port of stms_headless, read from stms.ini next to the executable; 0 disables.
+    const QSettings settings(QCoreApplication::applicationDirPath() + "/stms.ini", QSettings::IniFormat);
+    const int metricsPort = settings.value("metrics/port", 9464).toInt();
+    if (metricsPort > 0) trafficSystem->startMetricsServer(static_cast<quint16>(metricsPort));
+
+    violationModel->setStore(trafficSystem->getEvidenceStore());
+    ui->violations_tableView->setModel(violationModel);
+    ui->violations_tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->violations_tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->violations_tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ui->violations_tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->violations_fromEdit->setDateTime(QDateTime(QDate::currentDate(), QTime(0, 0)));
+    ui->violations_toEdit->setDateTime(QDateTime(QDate::currentDate(), QTime(23, 59)));
     ui->logs_logDisplay->setFont(QFont("Monospace", 9));
 
+    // Previews are rendered at the label size by the workers; let the layout size
+    // the labels instead of the pixmaps, and follow their resizes.
+    QLabel* displays[] = {ui->monitor_cameraDisplay1, ui->monitor_cameraDisplay2, ui->monitor_cameraDisplay3, ui->monitor_cameraDisplay4};
+    for (int i = 0; i < 4; ++i) {
+        displays[i]->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+        displays[i]->setAlignment(Qt::AlignCenter);
+        displays[i]->installEventFilter(this);
+        trafficSystem->setDisplaySize(i, displays[i]->contentsRect().size());
+    }
+
     populateArduinoPortsCombobox();
     updateStatusbar();
 
     connect(uiUpdateTimer, &QTimer::timeout, this, &MainWindow::onUiUpdateTimerTimeout);
     uiUpdateTimer->start(1000); // Update timers once per second
+    // The log view pulls a bounded batch from the logger instead of receiving every message.
+    connect(logRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshLogView);
+    logRefreshTimer->start(250);
     addLogMessage("UI and TrafficSystem initialized. System ready.", "INFO");
 }
 
@@ -68,6 +95,11 @@ void MainWindow::initializeUiConnections()
 
     connect(ui->violations_openFolderBtn, &QPushButton::clicked, this, &MainWindow::onOpenViolationsFolderClicked);
     connect(ui->violations_clearTableBtn, &QPushButton::clicked, this, &MainWindow::onClearViolationsTableClicked);
+    connect(ui->violations_applyFilterBtn, &QPushButton::clicked, this, &MainWindow::onApplyViolationFilterClicked);
+    connect(ui->violations_historyBtn, &QPushButton::clicked, this, &MainWindow::onShowViolationHistoryClicked);
+    connect(ui->violations_sessionBtn, &QPushButton::clicked, this, &MainWindow::onShowSessionViolationsClicked);
+    connect(ui->violations_timeFilterCheck, &QCheckBox::toggled, ui->violations_fromEdit, &QWidget::setEnabled);
+    connect(ui->violations_timeFilterCheck, &QCheckBox::toggled, ui->violations_toEdit, &QWidget::setEnabled);
 
     connect(ui->logs_exportLogBtn, &QPushButton::clicked, this, &MainWindow::onExportLogsClicked);
     connect(ui->logs_clearLogBtn, &QPushButton::clicked, this, &MainWindow::onClearLogClicked);
@@ -83,7 +115,6 @@ void MainWindow::connectTrafficSystemSignals()
     connect(trafficSystem, &TrafficSystem::cameraStatusChanged, this, &MainWindow::handleCameraStatusChanged);
     connect(trafficSystem, &TrafficSystem::arduinoStatusChanged, this, &MainWindow::handleArduinoStatusChanged);
     connect(trafficSystem, &TrafficSystem::energySavingStatusChanged, this, &MainWindow::handleEnergySavingStatusChanged);
-    connect(trafficSystem, &TrafficSystem::logMessage, this, &MainWindow::addLogMessage, Qt::QueuedConnection);
 }
 
 void MainWindow::onStartSystemClicked() {
@@ -152,21 +183,41 @@ void MainWindow::onOpenViolationsFolderClicked() {
 }
 
 void MainWindow::onClearViolationsTableClicked() {
-    ui->violations_tableWidget->setRowCount(0);
+    violationModel->clearSession();
+}
+
+void MainWindow::onApplyViolationFilterClicked() {
+    const int road = ui->violations_roadFilterCombo->currentIndex() - 1; // 0 is "All Roads"
+    if (!ui->violations_timeFilterCheck->isChecked()) {
+        if (road < 0) violationModel->clearFilter();
+        else violationModel->setFilter(road, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max());
+        return;
+    }
+    // The edits show minutes; include the whole last minute.
+    const qint64 fromMs = ui->violations_fromEdit->dateTime().toMSecsSinceEpoch();
+    const qint64 toMs = ui->violations_toEdit->dateTime().toMSecsSinceEpoch() + 59999;
+    violationModel->setFilter(road, fromMs, toMs);
+}
+
+void MainWindow::onShowViolationHistoryClicked() {
+    onApplyViolationFilterClicked();
+    violationModel->showHistory();
+    ui->violations_sessionBtn->setEnabled(true);
+}
+
+void MainWindow::onShowSessionViolationsClicked() {
+    violationModel->showSession();
+    ui->violations_sessionBtn->setEnabled(false);
 }
 
 void MainWindow::onExportLogsClicked() {
     QString fileName = QFileDialog::getSaveFileName(this, "Export Logs", QDir::homePath() + "/stms_log.txt", "Text Files (*.txt)");
     if (fileName.isEmpty()) return;
 
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&file);
-        out << ui->logs_logDisplay->toPlainText();
-        file.close();
+    if (trafficSystem->getLogger()->exportTo(fileName)) {
         addLogMessage("Log exported to: " + fileName, "INFO");
     } else {
-        QMessageBox::critical(this, "Export Error", "Could not write to file: " + file.errorString());
+        QMessageBox::critical(this, "Export Error", "Could not write to file: " + fileName);
     }
 }
 
@@ -212,22 +263,31 @@ void MainWindow::handleTrafficLightChanged(int roadIndex, TrafficLight light) {
     }
 }
 
-void MainWindow::handleViolationDetected(int roadIndex, const QString& timestamp, const QString& reason, const cv::Mat& frame) {
-    addViolationEntryToTable(roadIndex, timestamp, reason);
-    if (!frame.empty()) {
-        QString filename = QString("VIO_%1_R%2.jpg").arg(timestamp).arg(roadIndex + 1);
-        QString fullPath = QDir(trafficSystem->getViolationDirectory()).filePath(filename);
-        if (!cv::imwrite(fullPath.toStdString(), frame)) {
-            addLogMessage("Failed to save violation image: " + fullPath, "ERROR");
+// The evidence image is already queued by TrafficSystem's writer; only the table is updated here.
+void MainWindow::handleViolationDetected(int roadIndex, qint64 timestampMs, const QString& reason, const FrameRef& frame) {
+    Q_UNUSED(frame);
+    violationModel->appendViolation(timestampMs, roadIndex, reason);
+}
+
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
+    if (event->type() == QEvent::Resize) {
+        QLabel* displays[] = {ui->monitor_cameraDisplay1, ui->monitor_cameraDisplay2, ui->monitor_cameraDisplay3, ui->monitor_cameraDisplay4};
+        for (int i = 0; i < 4; ++i) {
+            if (watched == displays[i]) trafficSystem->setDisplaySize(i, displays[i]->contentsRect().size());
         }
     }
+    return QMainWindow::eventFilter(watched, event);
 }
 
-
 void MainWindow::handleFrameUpdated(int roadIndex, const QImage& frame) {
     QLabel* displays[] = {ui->monitor_cameraDisplay1, ui->monitor_cameraDisplay2, ui->monitor_cameraDisplay3, ui->monitor_cameraDisplay4};
     if (roadIndex >= 0 && roadIndex < 4 && !frame.isNull()) {
+        // The paint itself happens later; this covers the pixmap upload and the label update.
+        QElapsedTimer presentTimer;
+        presentTimer.start();
         displays[roadIndex]->setPixmap(QPixmap::fromImage(frame));
+        trafficSystem->getMetrics()->record(Metrics::Stage::Present, roadIndex, presentTimer.nsecsElapsed() / 1000);
     }
 }
 
@@ -241,7 +301,9 @@ void MainWindow::handleCameraStatusChanged(int roadIndex, bool connected) {
     updateStatusbar();
 }
 
-void MainWindow::handleArduinoStatusChanged(bool connected, const QString& portName) {
+// The dashboard shows the first intersection only.
+void MainWindow::handleArduinoStatusChanged(int intersectionIndex, bool connected, const QString& portName) {
+    if (intersectionIndex != 0) return;
     if (connected) {
         int index = ui->sysctrl_arduinoPortCombo->findText(portName);
         if (index != -1) {
@@ -255,42 +317,52 @@ void MainWindow::handleArduinoStatusChanged(bool connected, const QString& portN
     updateStatusbar();
 }
 
-void MainWindow::handleEnergySavingStatusChanged(bool active) {
+void MainWindow::handleEnergySavingStatusChanged(int intersectionIndex, bool active) {
+    if (intersectionIndex != 0) return;
     if (active) ui->lights_currentRoadLabel->setText("Energy Saving (Lights OFF)");
     updateStatusbar();
 }
 
 void MainWindow::addLogMessage(const QString& message, const QString& level) {
-    QString color = "white";
-    if (level == "ERROR") color = "#FF5555";
-    else if (level == "WARNING") color = "#FFAA00";
-    else if (level == "INFO") color = "#55FFFF";
-    else if (level == "ACTION") color = "lightgreen";
-    QString formattedMessage = QString("<font color='%1'>[%2] [%3] %4</font>")
-                                   .arg(color)
-                                   .arg(QDateTime::currentDateTime().toString("hh:mm:ss.zzz"))
-                                   .arg(level.toUpper().leftJustified(7))
-                                   .arg(message.toHtmlEscaped());
-    ui->logs_logDisplay->append(formattedMessage);
+    trafficSystem->getLogger()->log(level, "ui", message);
+}
+
+void MainWindow::refreshLogView() {
+    std::vector<Logger::Entry> entries = trafficSystem->getLogger()->tail(lastLogSequence, 200);
+    if (entries.empty()) return;
+    lastLogSequence = entries.back().sequence;
+
+    for (const Logger::Entry& entry : entries) {
+        QString color = "white";
+        if (entry.level == Logger::Level::Error) color = "#FF5555";
+        else if (entry.level == Logger::Level::Warning) color = "#FFAA00";
+        else if (entry.level == Logger::Level::Info) color = "#55FFFF";
+        else if (entry.level == Logger::Level::Action) color = "lightgreen";
+        ui->logs_logDisplay->appendHtml(QString("<font color='%1'>[%2] [%3] %4</font>")
+                                            .arg(color)
+                                            .arg(QDateTime::fromMSecsSinceEpoch(entry.timestampMs).toString("hh:mm:ss.zzz"))
+                                            .arg(Logger::levelName(entry.level).leftJustified(7))
+                                            .arg(entry.message.toHtmlEscaped()));
+    }
+    if (ui->logs_autoScrollCheck->isChecked()) {
+        ui->logs_logDisplay->verticalScrollBar()->setValue(ui->logs_logDisplay->verticalScrollBar()->maximum());
+    }
 }
 
 
 void MainWindow::onUiUpdateTimerTimeout() {
     updateStatusbar();
     if (trafficSystem && trafficSystem->isSystemRunning()) {
-        int remaining = trafficSystem->getCurrentLightTimeRemaining();
-        int currentRoad = trafficSystem->getCurrentRoadIndex();
-        int totalDuration = 0;
-        if (trafficSystem->getCurrentLight(currentRoad) == TrafficLight::GREEN) {
-            totalDuration = trafficSystem->getRedLightDuration(trafficSystem->getRoadData(currentRoad).density);
-        } else if (trafficSystem->getCurrentLight(currentRoad) == TrafficLight::YELLOW) {
-            totalDuration = trafficSystem->getYellowLightDuration();
-        }
-
-        if (totalDuration > 0) {
-            ui->lights_lightTimerProgress->setRange(0, totalDuration);
-            ui->lights_lightTimerProgress->setValue(totalDuration - remaining);
-            ui->lights_lightTimerProgress->setFormat(QString("%1s / %2s").arg(totalDuration - remaining).arg(totalDuration));
+        // The phase's own duration, fixed when it started, in milliseconds.
+        const SignalController* controller = trafficSystem->getSignalController();
+        const int totalMs = controller && controller->isRunning() ? static_cast<int>(controller->getPhaseDuration()) : 0;
+
+        if (totalMs > 0) {
+            const int elapsedMs = totalMs - static_cast<int>(controller->getRemainingMs());
+            ui->lights_lightTimerProgress->setRange(0, totalMs);
+            ui->lights_lightTimerProgress->setValue(elapsedMs);
+            ui->lights_lightTimerProgress->setFormat(QString("%1 %2s / %3s").arg(SignalController::phaseName(controller->getPhase()))
+                                                         .arg(elapsedMs / 1000.0, 0, 'f', 1).arg(totalMs / 1000.0, 0, 'f', 1));
         } else {
             ui->lights_lightTimerProgress->setValue(0);
             ui->lights_lightTimerProgress->setFormat("N/A");
@@ -307,6 +379,13 @@ void MainWindow::updateStatusbar() {
     for(int i = 0; i < 4; ++i) if(trafficSystem->getRoadData(i).cameraConnected) connectedCams++;
     status << QString("Cams:%1/4").arg(connectedCams);
 
+    QStringList drops;
+    for(int i = 0; i < 4; ++i) drops << QString::number(trafficSystem->getDroppedFrameCount(i));
+    status << "Drops:" + drops.join("/");
+
+    EvidenceWriter::Stats evidence = trafficSystem->getEvidenceStats();
+    status << QString("Evidence q:%1 lat:%2ms").arg(evidence.queueDepth).arg(evidence.averageLatencyMs, 0, 'f', 0);
+
     if (ui->sysctrl_simulationModeCheck->isChecked()){
         status << "Arduino:Sim";
     } else {
@@ -336,14 +415,6 @@ void MainWindow::styleLightIndicatorLabel(QLabel* label, TrafficLight light) {
                              .arg(colorStyle).arg(label->height() / 2));
 }
 
-void MainWindow::addViolationEntryToTable(int roadIndex, const QString& timestamp, const QString& reason) {
-    int row = ui->violations_tableWidget->rowCount();
-    ui->violations_tableWidget->insertRow(row);
-    ui->violations_tableWidget->setItem(row, 0, new QTableWidgetItem(QDateTime::fromString(timestamp, "yyyy-MM-dd_hh-mm-ss-zzz").toString("yyyy-MM-dd hh:mm:ss")));
-    ui->violations_tableWidget->setItem(row, 1, new QTableWidgetItem(QString("Road %1").arg(roadIndex + 1)));
-    ui->violations_tableWidget->setItem(row, 2, new QTableWidgetItem(reason));
-}
-
 QString MainWindow::formatDensityToString(TrafficDensity density) const {
     switch(density) {
     case TrafficDensity::OFF: return "OFF";
@@ -4,6 +4,7 @@
 #include <QMainWindow>
 #include <QLabel>
 #include "trafficsystem.h"
+#include "violationtablemodel.h"
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
@@ -18,6 +19,7 @@ public:
 
 protected:
     void closeEvent(QCloseEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private slots:
     void onStartSystemClicked();
@@ -28,6 +30,9 @@ private slots:
     void onApplyTrafficSettingsClicked();
     void onOpenViolationsFolderClicked();
     void onClearViolationsTableClicked();
+    void onApplyViolationFilterClicked();
+    void onShowViolationHistoryClicked();
+    void onShowSessionViolationsClicked();
     void onExportLogsClicked();
     void onClearLogClicked();
     void onArduinoPortSelected(const QString& portName);
@@ -35,26 +40,29 @@ private slots:
     void handleVehicleCountChanged(int roadIndex, int count);
     void handleDensityChanged(int roadIndex, TrafficDensity density);
     void handleTrafficLightChanged(int roadIndex, TrafficLight light);
-    void handleViolationDetected(int roadIndex, const QString& timestamp, const QString& reason, const cv::Mat& frame);
+    void handleViolationDetected(int roadIndex, qint64 timestampMs, const QString& reason, const FrameRef& frame);
     void handleFrameUpdated(int roadIndex, const QImage& frame);
     void handleCameraStatusChanged(int roadIndex, bool connected);
-    void handleArduinoStatusChanged(bool connected, const QString& portName);
-    void handleEnergySavingStatusChanged(bool active);
+    void handleArduinoStatusChanged(int intersectionIndex, bool connected, const QString& portName);
+    void handleEnergySavingStatusChanged(int intersectionIndex, bool active);
     void addLogMessage(const QString& message, const QString& level);
 
 
     void onUiUpdateTimerTimeout();
+    void refreshLogView();
 
 private:
     Ui::MainWindow *ui;
     TrafficSystem* trafficSystem;
+    ViolationTableModel* violationModel;
     QTimer* uiUpdateTimer;
+    QTimer* logRefreshTimer;
+    quint64 lastLogSequence = 0;
     void initializeUiConnections();
     void connectTrafficSystemSignals();
     void updateStatusbar();
     void populateArduinoPortsCombobox();
     void styleLightIndicatorLabel(QLabel* label, TrafficLight light);
-    void addViolationEntryToTable(int roadIndex, const QString& timestamp, const QString& reason);
     QString formatDensityToString(TrafficDensity density) const;
 };
 
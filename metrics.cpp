@@ -0,0 +1,204 @@
+#include "metrics.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+
+static const char* const COUNTER_NAMES[] = {
+    "stms_frames_submitted_total",
+    "stms_capture_frames_dropped_total",
+    "stms_inference_queue_dropped_total",
+    "stms_roads_skipped_total"
+};
+static const char* const COUNTER_HELP[] = {
+    "Frames handed to the inference pool.",
+    "Captured frames replaced before the controller took them.",
+    "Queued frames replaced because every worker was busy with the road.",
+    "Controller ticks that found no new frame for a connected road."
+};
+static const char* const GAUGE_NAMES[] = {
+    "stms_quality_level"
+};
+static const char* const GAUGE_HELP[] = {
+    "Quality governor step of the road, 0 for full quality."
+};
+// Cumulative histogram bounds exported to Prometheus, in seconds.
+static const double EXPORT_BOUNDS_SECONDS[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5};
+
+namespace {
+QByteArray formatSeconds(double micros) {
+    return QByteArray::number(micros / 1e6, 'g', 6);
+}
+}
+
+LatencyHistogram::LatencyHistogram() {
+    for (std::atomic<quint64>& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(qint64 micros) {
+    const quint64 value = micros > 0 ? static_cast<quint64>(micros) : 0;
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(value, std::memory_order_relaxed);
+    quint64 seen = maxMicros.load(std::memory_order_relaxed);
+    while (value > seen && !maxMicros.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+}
+
+// Buckets are read one by one while writers continue, so a snapshot may be off by the
+// samples recorded meanwhile; the count is taken from the buckets to stay consistent.
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.buckets.resize(BUCKET_COUNT);
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sumMicros = sumMicros.load(std::memory_order_relaxed);
+    snapshot.maxMicros = maxMicros.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+// Values below 16 get a bucket each; above, the top four bits of the value pick the bucket.
+int LatencyHistogram::bucketIndex(quint64 micros) {
+    if (micros < 16) return static_cast<int>(micros);
+    const int msb = 63 - static_cast<int>(qCountLeadingZeroBits(micros));
+    if (msb > 31) return BUCKET_COUNT - 1;
+    const int shift = msb - 3;
+    return 16 + (msb - 4) * 8 + static_cast<int>((micros >> shift) - 8);
+}
+
+quint64 LatencyHistogram::bucketUpperBound(int index) {
+    if (index < 16) return static_cast<quint64>(index);
+    const int octave = (index - 16) / 8;
+    const int sub = (index - 16) % 8;
+    const int shift = octave + 1;
+    return ((static_cast<quint64>(8 + sub + 1)) << shift) - 1;
+}
+
+double LatencyHistogram::Snapshot::quantileMicros(double q) const {
+    if (count == 0) return 0.0;
+    const quint64 target = std::max<quint64>(1, static_cast<quint64>(std::ceil(q * count)));
+    quint64 seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= target) return static_cast<double>(std::min(bucketUpperBound(static_cast<int>(i)), maxMicros));
+    }
+    return static_cast<double>(maxMicros);
+}
+
+quint64 LatencyHistogram::Snapshot::countAtOrBelow(quint64 micros) const {
+    // The bucket holding micros counts in full: the export bounds fall inside buckets, and
+    // leaving that bucket out would drop samples that are at or below the bound.
+    const int last = std::min(bucketIndex(micros), static_cast<int>(buckets.size()) - 1);
+    quint64 total = 0;
+    for (int i = 0; i <= last; ++i) total += buckets[i];
+    return total;
+}
+
+Metrics::Metrics(int roadCount)
+    : roadCount(qMax(0, roadCount)),
+    histograms(new LatencyHistogram[STAGE_COUNT * qMax(0, roadCount)]),
+    counters(new std::atomic<quint64>[COUNTER_COUNT * qMax(0, roadCount)]),
+    gauges(new std::atomic<qint64>[GAUGE_COUNT * qMax(0, roadCount)])
+{
+    for (int i = 0; i < COUNTER_COUNT * this->roadCount; ++i) counters[i].store(0, std::memory_order_relaxed);
+    for (int i = 0; i < GAUGE_COUNT * this->roadCount; ++i) gauges[i].store(0, std::memory_order_relaxed);
+}
+
+void Metrics::record(Stage stage, int roadIndex, qint64 micros) {
+    if (roadIndex < 0 || roadIndex >= roadCount) return;
+    histograms[static_cast<int>(stage) * roadCount + roadIndex].record(micros);
+}
+
+void Metrics::increment(Counter counter, int roadIndex, quint64 amount) {
+    if (roadIndex < 0 || roadIndex >= roadCount) return;
+    counters[static_cast<int>(counter) * roadCount + roadIndex].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void Metrics::setGauge(Gauge gauge, int roadIndex, qint64 value) {
+    if (roadIndex < 0 || roadIndex >= roadCount) return;
+    gauges[static_cast<int>(gauge) * roadCount + roadIndex].store(value, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot Metrics::snapshot(Stage stage, int roadIndex) const {
+    if (roadIndex < 0 || roadIndex >= roadCount) return LatencyHistogram::Snapshot();
+    return histograms[static_cast<int>(stage) * roadCount + roadIndex].snapshot();
+}
+
+quint64 Metrics::getCounter(Counter counter, int roadIndex) const {
+    if (roadIndex < 0 || roadIndex >= roadCount) return 0;
+    return counters[static_cast<int>(counter) * roadCount + roadIndex].load(std::memory_order_relaxed);
+}
+
+qint64 Metrics::getGauge(Gauge gauge, int roadIndex) const {
+    if (roadIndex < 0 || roadIndex >= roadCount) return 0;
+    return gauges[static_cast<int>(gauge) * roadCount + roadIndex].load(std::memory_order_relaxed);
+}
+
+// Histograms that never saw a sample are left out to keep the scrape small.
+QByteArray Metrics::toPrometheusText() const {
+    QByteArray text;
+    text += "# HELP stms_stage_latency_seconds Time spent in each pipeline stage, per road.\n";
+    text += "# TYPE stms_stage_latency_seconds histogram\n";
+    QByteArray quantiles;
+    quantiles += "# HELP stms_stage_latency_quantile_seconds Stage latency quantiles since start, from the same histograms.\n";
+    quantiles += "# TYPE stms_stage_latency_quantile_seconds gauge\n";
+
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        for (int r = 0; r < roadCount; ++r) {
+            const LatencyHistogram::Snapshot histogram = histograms[s * roadCount + r].snapshot();
+            if (histogram.count == 0) continue;
+            const QByteArray labels = QByteArray("stage=\"") + stageName(static_cast<Stage>(s)) + "\",road=\"" + QByteArray::number(r + 1) + "\"";
+            for (double bound : EXPORT_BOUNDS_SECONDS) {
+                text += "stms_stage_latency_seconds_bucket{" + labels + ",le=\"" + QByteArray::number(bound, 'g', 6) + "\"} "
+                        + QByteArray::number(histogram.countAtOrBelow(static_cast<quint64>(bound * 1e6))) + "\n";
+            }
+            text += "stms_stage_latency_seconds_bucket{" + labels + ",le=\"+Inf\"} " + QByteArray::number(histogram.count) + "\n";
+            text += "stms_stage_latency_seconds_sum{" + labels + "} " + formatSeconds(static_cast<double>(histogram.sumMicros)) + "\n";
+            text += "stms_stage_latency_seconds_count{" + labels + "} " + QByteArray::number(histogram.count) + "\n";
+
+            const double levels[] = {0.5, 0.95, 0.99};
+            for (double level : levels) {
+                quantiles += "stms_stage_latency_quantile_seconds{" + labels + ",quantile=\"" + QByteArray::number(level) + "\"} "
+                             + formatSeconds(histogram.quantileMicros(level)) + "\n";
+            }
+        }
+    }
+    text += quantiles;
+
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        text += QByteArray("# HELP ") + COUNTER_NAMES[c] + " " + COUNTER_HELP[c] + "\n";
+        text += QByteArray("# TYPE ") + COUNTER_NAMES[c] + " counter\n";
+        for (int r = 0; r < roadCount; ++r) {
+            text += QByteArray(COUNTER_NAMES[c]) + "{road=\"" + QByteArray::number(r + 1) + "\"} "
+                    + QByteArray::number(counters[c * roadCount + r].load(std::memory_order_relaxed)) + "\n";
+        }
+    }
+
+    for (int g = 0; g < GAUGE_COUNT; ++g) {
+        text += QByteArray("# HELP ") + GAUGE_NAMES[g] + " " + GAUGE_HELP[g] + "\n";
+        text += QByteArray("# TYPE ") + GAUGE_NAMES[g] + " gauge\n";
+        for (int r = 0; r < roadCount; ++r) {
+            text += QByteArray(GAUGE_NAMES[g]) + "{road=\"" + QByteArray::number(r + 1) + "\"} "
+                    + QByteArray::number(gauges[g * roadCount + r].load(std::memory_order_relaxed)) + "\n";
+        }
+    }
+    return text;
+}
+
+const char* Metrics::stageName(Stage stage) {
+    switch (stage) {
+    case Stage::Capture: return "capture";
+    case Stage::Queue: return "queue";
+    case Stage::MotionGate: return "motion_gate";
+    case Stage::Preprocess: return "preprocess";
+    case Stage::Inference: return "inference";
+    case Stage::Decode: return "decode";
+    case Stage::Tracking: return "tracking";
+    case Stage::Draw: return "draw";
+    case Stage::Convert: return "convert";
+    case Stage::Present: return "present";
+    case Stage::Pipeline: return "pipeline";
+    case Stage::Count: break;
+    }
+    return "unknown";
+}
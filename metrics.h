@@ -0,0 +1,83 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Log-linear latency histogram in microseconds: exact below 16 us, then eight
+// buckets per power of two (at most 12.5% relative error) up to about an hour;
+// longer samples land in the last bucket. record() never locks, so any thread
+// can call it on the hot path.
+class LatencyHistogram
+{
+public:
+    static const int BUCKET_COUNT = 16 + 28 * 8;
+
+    struct Snapshot {
+        std::vector<quint64> buckets;
+        quint64 count = 0;
+        quint64 sumMicros = 0;
+        quint64 maxMicros = 0;
+
+        double quantileMicros(double q) const;
+        // Samples in the buckets up to and including the one holding micros, i.e. at most
+        // one bucket width (12.5%) above it.
+        quint64 countAtOrBelow(quint64 micros) const;
+    };
+
+    LatencyHistogram();
+
+    void record(qint64 micros);
+    Snapshot snapshot() const;
+
+    static int bucketIndex(quint64 micros);
+    static quint64 bucketUpperBound(int index);
+
+private:
+    std::atomic<quint64> buckets[BUCKET_COUNT];
+    std::atomic<quint64> count{0};
+    std::atomic<quint64> sumMicros{0};
+    std::atomic<quint64> maxMicros{0};
+};
+
+// Per-road latency histograms of every pipeline stage plus a few per-road
+// counters and gauges, exported in the Prometheus text format. The road count is fixed
+// at construction, so recording never allocates or locks.
+class Metrics
+{
+public:
+    enum class Stage { Capture = 0, Queue, MotionGate, Preprocess, Inference, Decode, Tracking, Draw, Convert, Present, Pipeline, Count };
+    enum class Counter { FramesSubmitted = 0, CaptureDropped, QueueDropped, RoadSkipped, Count };
+    enum class Gauge { QualityLevel = 0, Count };
+
+    explicit Metrics(int roadCount);
+
+    int getRoadCount() const { return roadCount; }
+
+    // Out-of-range roads are ignored.
+    void record(Stage stage, int roadIndex, qint64 micros);
+    void increment(Counter counter, int roadIndex, quint64 amount = 1);
+    void setGauge(Gauge gauge, int roadIndex, qint64 value);
+
+    LatencyHistogram::Snapshot snapshot(Stage stage, int roadIndex) const;
+    quint64 getCounter(Counter counter, int roadIndex) const;
+    qint64 getGauge(Gauge gauge, int roadIndex) const;
+    QByteArray toPrometheusText() const;
+
+    static const char* stageName(Stage stage);
+
+private:
+    static const int STAGE_COUNT = static_cast<int>(Stage::Count);
+    static const int COUNTER_COUNT = static_cast<int>(Counter::Count);
+    static const int GAUGE_COUNT = static_cast<int>(Gauge::Count);
+
+    int roadCount;
+    std::unique_ptr<LatencyHistogram[]> histograms;     // stage-major
+    std::unique_ptr<std::atomic<quint64>[]> counters;   // counter-major
+    std::unique_ptr<std::atomic<qint64>[]> gauges;      // gauge-major
+};
+
+#endif // METRICS_H
@@ -0,0 +1,59 @@
+#include "metricsserver.h"
+#include <QTcpSocket>
+#include <QTimer>
+
+static const int MAX_REQUEST_BYTES = 8192;
+static const int REQUEST_TIMEOUT_MS = 5000;
+
+MetricsServer::MetricsServer(const Metrics* metrics, QObject *parent)
+    : QObject(parent),
+    metrics(metrics),
+    server(new QTcpServer(this))
+{
+    connect(server, &QTcpServer::newConnection, this, &MetricsServer::handleConnection);
+}
+
+bool MetricsServer::listen(quint16 port, const QHostAddress& address) {
+    if (server->isListening()) server->close();
+    return server->listen(address, port);
+}
+
+void MetricsServer::handleConnection() {
+    while (QTcpSocket* socket = server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        // Scrapers that never finish their request are dropped.
+        QTimer::singleShot(REQUEST_TIMEOUT_MS, socket, [socket]() { socket->abort(); });
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+            if (request.size() > MAX_REQUEST_BYTES) {
+                socket->abort();
+                return;
+            }
+            if (!request.contains("\r\n\r\n")) {
+                socket->setProperty("request", request);
+                return;
+            }
+
+            const QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+            QByteArray status = "200 OK";
+            QByteArray contentType = "text/plain; version=0.0.4; charset=utf-8";
+            QByteArray body;
+            if (requestLine.size() < 2 || requestLine[0] != "GET") {
+                status = "405 Method Not Allowed";
+                body = "Only GET is supported.\n";
+            } else if (requestLine[1] != "/metrics" && !requestLine[1].startsWith("/metrics?")) {
+                status = "404 Not Found";
+                body = "Metrics are served at /metrics.\n";
+            } else {
+                body = metrics->toPrometheusText();
+            }
+
+            socket->write("HTTP/1.1 " + status + "\r\n"
+                          "Content-Type: " + contentType + "\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body);
+            socket->disconnectFromHost();
+        });
+    }
+}
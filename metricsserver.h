@@ -0,0 +1,30 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHostAddress>
+#include "metrics.h"
+
+// Minimal HTTP endpoint for Prometheus: GET /metrics returns the text format.
+// Listens on localhost only; one short request per connection.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(const Metrics* metrics, QObject *parent = nullptr);
+
+    bool listen(quint16 port, const QHostAddress& address = QHostAddress::LocalHost);
+    void close() { server->close(); }
+    bool isListening() const { return server->isListening(); }
+    QString errorString() const { return server->errorString(); }
+
+private:
+    const Metrics* metrics;
+    QTcpServer* server;
+
+    void handleConnection();
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,75 @@
+#include "motiongate.h"
+#include <algorithm>
+
+// Thumbnail width; the height follows the ROI aspect ratio.
+static const int THUMBNAIL_WIDTH = 64;
+// A thumbnail pixel counts as changed above this grey-level difference,
+// and the scene as changed once this fraction of pixels did.
+static const int PIXEL_CHANGE_THRESHOLD = 18;
+static const double CHANGED_PIXEL_FRACTION = 0.004;
+// Run the detector at least this often even on a static road, in case the gate misses a far vehicle.
+static const int MAX_CONSECUTIVE_SKIPS = 50;
+
+MotionGate::Decision MotionGate::decide(const cv::Mat& frame, const cv::Rect& region, int activeTracks) {
+    const int64 start = cv::getTickCount();
+
+    const int thumbnailHeight = std::max(1, cvRound(static_cast<double>(THUMBNAIL_WIDTH) * region.height / std::max(1, region.width)));
+    const cv::Size thumbnailSize(THUMBNAIL_WIDTH, thumbnailHeight);
+    if (frame.channels() == 1) {
+        cv::resize(frame(region), thumbnail, thumbnailSize, 0, 0, cv::INTER_AREA);
+    } else {
+        cv::resize(frame(region), colourThumbnail, thumbnailSize, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(colourThumbnail, thumbnail, frame.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    }
+
+    Decision decision = Decision::RunDetector;
+    if (previousThumbnail.size() != thumbnail.size()) {
+        // First frame or the ROI changed: nothing to compare against.
+        referenceThumbnail.release();
+        consecutiveFrozenFrames = 0;
+    } else if (cv::norm(thumbnail, previousThumbnail, cv::NORM_INF) == 0.0) {
+        consecutiveFrozenFrames++;
+        decision = Decision::SkipFrozen;
+    } else {
+        consecutiveFrozenFrames = 0;
+        if (activeTracks == 0 && !referenceThumbnail.empty() && consecutiveSkips < MAX_CONSECUTIVE_SKIPS
+            && !changedSince(referenceThumbnail)) {
+            decision = Decision::SkipStatic;
+        }
+    }
+
+    thumbnail.copyTo(previousThumbnail);
+    if (decision == Decision::RunDetector) {
+        // Compare later frames with the last detector pass so slow changes still add up.
+        thumbnail.copyTo(referenceThumbnail);
+        consecutiveSkips = 0;
+    } else {
+        consecutiveSkips++;
+        stats.skippedFrames++;
+        if (decision == Decision::SkipFrozen) stats.frozenFrames++;
+    }
+
+    stats.evaluatedFrames++;
+    stats.gateMilliseconds += (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    return decision;
+}
+
+bool MotionGate::changedSince(const cv::Mat& reference) {
+    cv::absdiff(thumbnail, reference, difference);
+    cv::threshold(difference, difference, PIXEL_CHANGE_THRESHOLD, 255, cv::THRESH_BINARY);
+    const int changedPixels = cv::countNonZero(difference);
+    return changedPixels > std::max(1, cvRound(CHANGED_PIXEL_FRACTION * difference.total()));
+}
+
+void MotionGate::reset() {
+    previousThumbnail.release();
+    referenceThumbnail.release();
+    consecutiveSkips = 0;
+    consecutiveFrozenFrames = 0;
+}
+
+MotionGate::Stats MotionGate::takeStats() {
+    Stats window = stats;
+    stats = Stats();
+    return window;
+}
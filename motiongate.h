@@ -0,0 +1,43 @@
+#ifndef MOTIONGATE_H
+#define MOTIONGATE_H
+
+#include <opencv2/opencv.hpp>
+
+// Cheap per-road check run before YOLO. The ROI is shrunk to a tiny grey
+// thumbnail and compared with the thumbnail of the last detector pass; an
+// empty road that has not changed since then doesn't need a forward pass.
+// Thumbnails that are bit-identical to the previous frame mean the stream
+// itself has stalled or is repeating frames.
+class MotionGate
+{
+public:
+    enum class Decision { RunDetector, SkipStatic, SkipFrozen };
+
+    struct Stats {
+        long long evaluatedFrames = 0;
+        long long skippedFrames = 0;
+        long long frozenFrames = 0;
+        double gateMilliseconds = 0.0;
+    };
+
+    Decision decide(const cv::Mat& frame, const cv::Rect& region, int activeTracks);
+    void reset();
+
+    int getConsecutiveFrozenFrames() const { return consecutiveFrozenFrames; }
+    const Stats& getStats() const { return stats; }
+    // Counters since the last call, then starts a new reporting window.
+    Stats takeStats();
+
+private:
+    cv::Mat thumbnail, colourThumbnail;
+    cv::Mat previousThumbnail;
+    cv::Mat referenceThumbnail;
+    cv::Mat difference;
+    int consecutiveSkips = 0;
+    int consecutiveFrozenFrames = 0;
+    Stats stats;
+
+    bool changedSince(const cv::Mat& reference);
+};
+
+#endif // MOTIONGATE_H
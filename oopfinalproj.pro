@@ -4,20 +4,8 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 
-# OpenCV 4.11.0 Configuration (Release mode only)
-INCLUDEPATH += "C:/opencv/build/include"
-
-# Release configuration for OpenCV
-CONFIG(release, debug|release) {
-    LIBS += -L"C:/opencv/build/x64/vc16/lib" \
-            -lopencv_world4110
-}
-
-# Debug fallback (if needed)
-CONFIG(debug, debug|release) {
-    LIBS += -L"C:/opencv/build/x64/vc16/lib" \
-            -lopencv_world4110d
-}
+# Core sources and the OpenCV configuration
+include(stmscore.pri)
 
 TARGET = SmartTrafficSystem
 TEMPLATE = app
@@ -26,15 +14,12 @@ TEMPLATE = app
 SOURCES += \
     main.cpp \
     mainwindow.cpp \
-    processingworker.cpp \
-    trafficsystem.cpp
+    violationtablemodel.cpp
 
 # Header files
 HEADERS += \
     mainwindow.h \
-    processingworker.h \
-    traffic_types.h \
-    trafficsystem.h
+    violationtablemodel.h
 # Forms
 FORMS += \
     mainwindow.ui
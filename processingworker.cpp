@@ -1,31 +1,49 @@
 #include "processingworker.h"
+#include "yolodecoder.h"
 #include <QCoreApplication>
 #include <QFileInfo>
+#include <QStringList>
 #include <QTextStream>
 #include <algorithm>
+#include <chrono>
 
-// COCO class IDs for vehicles: car, motorcycle, bus, truck
-const std::vector<int> VEHICLE_CLASS_IDS_COCO = {2, 3, 5, 7};
+// Identical thumbnails on this many detector frames in a row: the stream has stalled.
+static const int FROZEN_STREAM_FRAMES = 10;
+// Motion gate statistics are logged once per this many gated frames of a road.
+static const int GATE_REPORT_FRAMES = 600;
+
+using StageClock = std::chrono::steady_clock;
+static double millisecondsSince(StageClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(StageClock::now() - start).count();
+}
 
 ProcessingWorker::ProcessingWorker(QObject *parent) : QObject(parent) {
-    nextVehicleID.fill(0);
 }
 
 ProcessingWorker::~ProcessingWorker() {}
 
 bool ProcessingWorker::initializeModels(const QString& yoloModelPath, const QString& cocoNamesPath) {
     try {
-        QString fullModelPath = QCoreApplication::applicationDirPath() + "/" + yoloModelPath;
-        QString fullClassesPath = QCoreApplication::applicationDirPath() + "/" + cocoNamesPath;
+        // Relative paths are relative to the executable, absolute ones are used as given.
+        QString fullModelPath = QFileInfo(yoloModelPath).isRelative() ? QCoreApplication::applicationDirPath() + "/" + yoloModelPath : yoloModelPath;
+        QString fullClassesPath = QFileInfo(cocoNamesPath).isRelative() ? QCoreApplication::applicationDirPath() + "/" + cocoNamesPath : cocoNamesPath;
 
         if (!QFileInfo::exists(fullModelPath)) {
             emit logMessage("YOLO model file not found at: " + fullModelPath, "ERROR");
             return false;
         }
 
-        yoloNet = cv::dnn::readNetFromONNX(fullModelPath.toStdString());
-        yoloNet.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-        yoloNet.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        backend = InferenceBackend::create(backendType);
+        if (!backend) {
+            emit logMessage(QString("Inference backend '%1' is not built in; rebuild with CONFIG+=%1.").arg(InferenceBackend::typeName(backendType)), "ERROR");
+            return false;
+        }
+        backend->load(fullModelPath, backendThreads);
+        if (!probeInputSizes()) {
+            backend.reset();
+            return false;
+        }
+        probeBatchForward();
 
         QFile file(fullClassesPath);
         if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -38,46 +56,237 @@ bool ProcessingWorker::initializeModels(const QString& yoloModelPath, const QStr
             classNames.push_back(in.readLine().trimmed().toStdString());
         }
         yoloInitialized = true;
-        emit logMessage("YOLO model loaded successfully.", "INFO");
+        emit logMessage("YOLO model loaded successfully (" + backend->describe() + ").", "INFO");
         return true;
 
     } catch (const cv::Exception& e) {
+        backend.reset();
         emit logMessage(QString("OpenCV Exception during YOLO init: %1").arg(e.what()), "ERROR");
         return false;
     }
 }
 
+// Inputs below the native size only work with models exported with dynamic shapes;
+// keep the sizes whose output has the anchor count YOLOv8 produces at that size.
+bool ProcessingWorker::probeInputSizes() {
+    const std::vector<int> requested = tilePlanner.getOptions().inputSizes;
+    std::vector<int> accepted;
+    QStringList rejected;
+    for (int size : requested) {
+        const int sizes[4] = {1, 3, size, size};
+        const cv::Mat probe(4, sizes, CV_32F, cv::Scalar(0.5));
+        const int anchors = (size / 8) * (size / 8) + (size / 16) * (size / 16) + (size / 32) * (size / 32);
+        try {
+            backend->infer(probe, outputs);
+            if (!outputs.empty() && outputs[0].dims == 3 && outputs[0].size[2] == anchors) {
+                accepted.push_back(size);
+                continue;
+            }
+        } catch (const cv::Exception&) {
+        }
+        rejected << QString::number(size);
+    }
+    if (accepted.empty()) {
+        emit logMessage("The YOLO model accepts none of the configured input sizes.", "ERROR");
+        return false;
+    }
+    if (!rejected.isEmpty()) {
+        emit logMessage(QString("The YOLO model does not accept %1 pixel inputs; export it with dynamic shapes to use them.").arg(rejected.join(", ")), "WARNING");
+    }
+    tilePlanner.setInputSizes(accepted);
+    return true;
+}
+
+// Models exported with a fixed batch of 1 cannot run stacked input; find out once, here,
+// rather than on the first live batch.
+void ProcessingWorker::probeBatchForward() {
+    const int size = tilePlanner.getOptions().inputSizes.front();
+    const int sizes[4] = {2, 3, size, size};
+    const cv::Mat probe(4, sizes, CV_32F, cv::Scalar(0.5));
+    try {
+        backend->infer(probe, outputs);
+        batchForwardSupported = !outputs.empty() && outputs[0].dims == 3 && outputs[0].size[0] == 2;
+    } catch (const cv::Exception&) {
+        batchForwardSupported = false;
+    }
+    if (!batchForwardSupported) {
+        emit logMessage("The YOLO model does not accept batched input; using per-frame inference.", "INFO");
+    }
+}
+
+void ProcessingWorker::setTilingOptions(const TilingOptions& options) {
+    tilePlanner.setOptions(options);
+}
+
+RoadTrackState& ProcessingWorker::trackStateFor(const FrameJob& job) {
+    return job.trackState ? *job.trackState : ownTrackStates[job.roadIndex];
+}
+
+void ProcessingWorker::recordStage(Metrics::Stage stage, int roadIndex, double milliseconds) {
+    if (metrics) metrics->record(stage, roadIndex, static_cast<qint64>(milliseconds * 1000.0));
+}
+
 void ProcessingWorker::setYoloThresholds(float confidence, float nms) {
     yoloConfidenceThreshold = confidence;
     yoloNmsThreshold = nms;
 }
 
+void ProcessingWorker::setMotionGateEnabled(bool enabled) {
+    motionGateEnabled = enabled;
+}
+
+// Region of the frame that is analysed: the ROI if it's valid, otherwise the whole frame.
+static cv::Rect processingRegion(const cv::Mat& frame, const cv::Rect& roi) {
+    cv::Rect full(0, 0, frame.cols, frame.rows);
+    cv::Rect region = roi & full;
+    return region.area() > 0 ? region : full;
+}
+
+// Detections come back relative to the ROI; trackers and drawing work in full-frame coordinates.
+static void offsetBoxes(std::vector<VehicleDetection>& detections, const cv::Point& origin) {
+    for (VehicleDetection& detection : detections) {
+        detection.box.x += origin.x;
+        detection.box.y += origin.y;
+    }
+}
+
 void ProcessingWorker::processFrame(int roadIndex, cv::Mat frame, cv::Rect roi, TrafficLight currentLight) {
     if (frame.empty() || !yoloInitialized) return;
 
-    cv::Mat processingFrame = frame;
-    // Use the Region of Interest if it's valid
-    if (roi.area() > 0) {
-        processingFrame = frame(roi & cv::Rect(0, 0, frame.cols, frame.rows));
+    FrameJob job;
+    job.roadIndex = roadIndex;
+    job.frame = std::make_shared<const cv::Mat>(frame);
+    job.roi = roi;
+    job.currentLight = currentLight;
+    processBatch({job});
+}
+
+void ProcessingWorker::processBatch(std::vector<FrameJob> jobs) {
+    // Every job is finished, with or without a result, or the pool would wait for its road forever.
+    if (jobs.empty()) return;
+    if (!yoloInitialized) {
+        for (const FrameJob& job : jobs) finishFrame(job);
+        return;
+    }
+    stageTimings = StageTimings();
+    lastDetections.clear();
+
+    // Frames between detector passes only advance the trackers; the rest share one forward pass.
+    std::vector<FrameJob> detectorJobs;
+    std::vector<cv::Mat> processingFrames;
+    std::vector<cv::Rect> regions;
+    detectorJobs.reserve(jobs.size());
+    processingFrames.reserve(jobs.size());
+    regions.reserve(jobs.size());
+    for (FrameJob& job : jobs) {
+        const cv::Mat& frame = *job.frame;
+        if (!job.runDetector) {
+            advanceTrackers(job);
+            finishFrame(job);
+            continue;
+        }
+        cv::Rect region = processingRegion(frame, job.roi);
+        const StageClock::time_point gateStart = StageClock::now();
+        const bool passed = passesMotionGate(job, frame, region);
+        const double gateMs = millisecondsSince(gateStart);
+        stageTimings.motionGateMs += gateMs;
+        recordStage(Metrics::Stage::MotionGate, job.roadIndex, gateMs);
+        if (!passed) {
+            // Empty, unchanged road or a repeated frame: keep the previous result.
+            finishFrame(job);
+            continue;
+        }
+        regions.push_back(region);
+        processingFrames.push_back(frame(region));
+        detectorJobs.push_back(job);
+    }
+    if (detectorJobs.empty()) return;
+
+    // Each region is inferred at the input size its resolution calls for, large ones as several tiles.
+    std::vector<DetectorTile> tiles;
+    std::vector<const std::vector<InferenceTile>*> plans(detectorJobs.size());
+    for (size_t b = 0; b < detectorJobs.size(); ++b) {
+        plans[b] = &tilePlanner.plan(regions[b].size(), detectorJobs[b].maxInputSize, detectorJobs[b].maxTiles);
+        for (size_t t = 0; t < plans[b]->size(); ++t) {
+            const InferenceTile& plannedTile = (*plans[b])[t];
+            DetectorTile tile;
+            tile.roadIndex = detectorJobs[b].roadIndex;
+            tile.slot = tile.roadIndex * TilePlanner::MAX_TILE_LIMIT + static_cast<int>(t);
+            tile.image = processingFrames[b](plannedTile.rect);
+            tile.inputSize = plannedTile.inputSize;
+            tiles.push_back(tile);
+        }
     }
 
-    detectAndTrack(roadIndex, processingFrame, currentLight);
-    drawDetections(frame, roadIndex);
+    std::vector<std::vector<VehicleDetection>> tileDetections = detectVehiclesYOLOBatch(tiles);
+    size_t firstTile = 0;
+    for (size_t b = 0; b < detectorJobs.size(); ++b) {
+        const std::vector<InferenceTile>& plan = *plans[b];
+        std::vector<VehicleDetection> detections;
+        if (plan.size() == 1) {
+            detections = std::move(tileDetections[firstTile]);
+        } else {
+            const StageClock::time_point start = StageClock::now();
+            for (size_t t = 0; t < plan.size(); ++t) offsetBoxes(tileDetections[firstTile + t], plan[t].rect.tl());
+            detections = TilePlanner::mergeTiles({tileDetections.begin() + firstTile, tileDetections.begin() + firstTile + plan.size()}, yoloNmsThreshold);
+            const double ms = millisecondsSince(start);
+            stageTimings.decodeMs += ms;
+            recordStage(Metrics::Stage::Decode, detectorJobs[b].roadIndex, ms);
+        }
+        firstTile += plan.size();
+
+        offsetBoxes(detections, regions[b].tl());
+        updateTrackers(detectorJobs[b], detections);
+        lastDetections[detectorJobs[b].roadIndex] = std::move(detections);
+        finishFrame(detectorJobs[b]);
+    }
+}
 
+void ProcessingWorker::finishFrame(const FrameJob& job) {
     std::vector<int> violatingIDs;
-    for(const auto& pair : roadTrackers[roadIndex]){
+    const VehicleTracker& tracker = trackStateFor(job).tracker;
+    for(int t = 0; t < tracker.size(); ++t){
         // A vehicle is violating if it's a candidate for several frames, confirming movement on red.
-        if(pair.second.isViolationCandidate && pair.second.violationFrameCount > 15) { // Threshold of ~0.5 seconds of detection
-            violatingIDs.push_back(pair.first);
+        if(tracker.isViolationCandidate(t) && tracker.getViolationFrameCount(t) > 15) { // Threshold of ~0.5 seconds of detection
+            violatingIDs.push_back(tracker.getId(t));
         }
     }
 
-    emit processingFinished(roadIndex, matToQImage(frame), static_cast<int>(roadTrackers[roadIndex].size()), violatingIDs);
+    // Views capped below the processing rate get a null image for this frame.
+    QImage displayFrame;
+    try {
+        if (job.renderDisplay) displayFrame = renderDisplayFrame(*job.frame, job.roadIndex, tracker, job.displaySize);
+    } catch (const cv::Exception& e) {
+        emit logMessage(QString("Road %1 preview failed: %2").arg(job.roadIndex + 1).arg(e.what()), "WARNING");
+    }
+    emit processingFinished(job.roadIndex, displayFrame, tracker.size(), violatingIDs, job.frame, job.capturedAtMs);
 }
 
-void ProcessingWorker::detectAndTrack(int roadIndex, cv::Mat &frame, TrafficLight currentLight) {
-    std::vector<cv::Rect> detections = detectVehiclesYOLO(frame);
-    updateTrackers(roadIndex, detections, currentLight);
+bool ProcessingWorker::passesMotionGate(const FrameJob& job, const cv::Mat& frame, const cv::Rect& region) {
+    if (!motionGateEnabled) return true;
+
+    const int roadIndex = job.roadIndex;
+    RoadTrackState& state = trackStateFor(job);
+    MotionGate::Decision decision = MotionGate::Decision::RunDetector;
+    try {
+        decision = state.motionGate.decide(frame, region, state.tracker.size());
+    } catch (const cv::Exception& e) {
+        emit logMessage(QString("Road %1 motion gate failed, running the detector: %2").arg(roadIndex + 1).arg(e.what()), "WARNING");
+        return true;
+    }
+
+    if (state.motionGate.getConsecutiveFrozenFrames() == FROZEN_STREAM_FRAMES) {
+        emit logMessage(QString("Road %1: camera stream looks frozen, frames are repeating.").arg(roadIndex + 1), "WARNING");
+    }
+    if (state.motionGate.getStats().evaluatedFrames >= GATE_REPORT_FRAMES) {
+        MotionGate::Stats stats = state.motionGate.takeStats();
+        emit logMessage(QString("Road %1 motion gate: skipped %2% of detector frames (%3% frozen), %4 ms per frame.")
+                            .arg(roadIndex + 1)
+                            .arg(100.0 * stats.skippedFrames / stats.evaluatedFrames, 0, 'f', 1)
+                            .arg(100.0 * stats.frozenFrames / stats.evaluatedFrames, 0, 'f', 1)
+                            .arg(stats.gateMilliseconds / stats.evaluatedFrames, 0, 'f', 3), "INFO");
+    }
+    return decision == MotionGate::Decision::RunDetector;
 }
 
 // ===================================================================================
@@ -85,144 +294,191 @@ void ProcessingWorker::detectAndTrack(int roadIndex, cv::Mat &frame, TrafficLigh
 // THIS IS THE CORRECTED YOLOv8 PARSING LOGIC
 //
 // ===================================================================================
-std::vector<cv::Rect> ProcessingWorker::detectVehiclesYOLO(const cv::Mat& frame) {
-    std::vector<cv::Rect> boxes;
+std::vector<VehicleDetection> ProcessingWorker::detectVehiclesYOLO(const DetectorTile& tile) {
+    std::vector<VehicleDetection> boxes;
     if (!yoloInitialized) return boxes;
 
+    const int roadIndex = tile.roadIndex;
     try {
-        cv::Mat blob;
-        cv::dnn::blobFromImage(frame, blob, 1.0 / 255.0, cv::Size(640, 640), cv::Scalar(), true, false);
-        yoloNet.setInput(blob);
-
-        std::vector<cv::Mat> outputs;
-        yoloNet.forward(outputs, yoloNet.getUnconnectedOutLayersNames());
-
-        // The output of YOLOv8 is [1][84][8400]. We need to transpose it to [1][8400][84]
+        LetterboxInfo letterbox;
+        StageClock::time_point start = StageClock::now();
+        const cv::Mat& input = preprocessor.prepare(tile.slot, tile.image, tile.inputSize, letterbox);
+        double ms = millisecondsSince(start);
+        stageTimings.preprocessMs += ms;
+        recordStage(Metrics::Stage::Preprocess, roadIndex, ms);
+
+        start = StageClock::now();
+        backend->infer(input, outputs);
+        ms = millisecondsSince(start);
+        stageTimings.inferenceMs += ms;
+        recordStage(Metrics::Stage::Inference, roadIndex, ms);
+
+        // The output of YOLOv8 is [1][84][anchors], 8400 anchors at 640 x 640.
+        start = StageClock::now();
         cv::Mat detection_matrix = outputs[0].reshape(1, {outputs[0].size[1], outputs[0].size[2]});
-        cv::transpose(detection_matrix, detection_matrix);
-
-
-        std::vector<int> class_ids;
-        std::vector<float> confidences;
-        std::vector<cv::Rect> boxes_vec;
-
-        float x_factor = static_cast<float>(frame.cols) / 640.0f;
-        float y_factor = static_cast<float>(frame.rows) / 640.0f;
-
-        for (int i = 0; i < detection_matrix.rows; i++) {
-            float* row = detection_matrix.ptr<float>(i);
-            cv::Mat class_scores = cv::Mat(1, classNames.size(), CV_32F, row + 4);
-
-            cv::Point class_id_point;
-            double max_class_score;
-            cv::minMaxLoc(class_scores, 0, &max_class_score, 0, &class_id_point);
-
-            if (max_class_score > yoloConfidenceThreshold) {
-                // Check if the detected class is a vehicle
-                if (std::find(VEHICLE_CLASS_IDS_COCO.begin(), VEHICLE_CLASS_IDS_COCO.end(), class_id_point.x) == VEHICLE_CLASS_IDS_COCO.end()){
-                    continue;
-                }
-
-                confidences.push_back(static_cast<float>(max_class_score));
-                class_ids.push_back(class_id_point.x);
-
-                float cx = row[0];
-                float cy = row[1];
-                float w = row[2];
-                float h = row[3];
-
-                int left = static_cast<int>((cx - 0.5 * w) * x_factor);
-                int top = static_cast<int>((cy - 0.5 * h) * y_factor);
-                int width = static_cast<int>(w * x_factor);
-                int height = static_cast<int>(h * y_factor);
-                boxes_vec.push_back(cv::Rect(left, top, width, height));
-            }
-        }
-
-        std::vector<int> nms_indices;
-        cv::dnn::NMSBoxes(boxes_vec, confidences, yoloConfidenceThreshold, yoloNmsThreshold, nms_indices);
-        for (int idx : nms_indices) {
-            boxes.push_back(boxes_vec[idx]);
-        }
+        boxes = decodeYoloOutput(detection_matrix, letterbox);
+        ms = millisecondsSince(start);
+        stageTimings.decodeMs += ms;
+        recordStage(Metrics::Stage::Decode, roadIndex, ms);
     } catch (const cv::Exception& e) {
         emit logMessage(QString("YOLO detection cv::Exception: %1").arg(e.what()), "ERROR");
     }
     return boxes;
 }
 
-void ProcessingWorker::updateTrackers(int roadIndex, const std::vector<cv::Rect>& detections, TrafficLight currentLight) {
-    auto& trackers = roadTrackers[roadIndex];
-    const int maxFramesDisappeared = 15;
+// Stacks all tiles of the same input size into one N x 3 x S x S tensor so a single
+// forward pass per size serves every road.
+std::vector<std::vector<VehicleDetection>> ProcessingWorker::detectVehiclesYOLOBatch(const std::vector<DetectorTile>& tiles) {
+    std::vector<std::vector<VehicleDetection>> results(tiles.size());
+    if (!yoloInitialized || tiles.empty()) return results;
 
-    std::vector<bool> usedDetections(detections.size(), false);
+    std::map<int, std::vector<size_t>> groups;
+    for (size_t i = 0; i < tiles.size(); ++i) groups[tiles[i].inputSize].push_back(i);
 
-    // Update existing trackers based on IoU (Intersection over Union)
-    for (auto& pair : trackers) {
-        TrackedVehicle& tracker = pair.second;
-        tracker.framesWithoutDetection++;
-        int bestDetIdx = -1;
-        double maxIoU = 0.0;
+    for (const auto& group : groups) {
+        const std::vector<size_t>& members = group.second;
+        if (members.size() == 1 || !batchForwardSupported) {
+            for (size_t i : members) results[i] = detectVehiclesYOLO(tiles[i]);
+            continue;
+        }
 
-        for (size_t i = 0; i < detections.size(); ++i) {
-            if (!usedDetections[i]) {
-                double iou = (double)(tracker.boundingBox & detections[i]).area() / (double)(tracker.boundingBox | detections[i]).area();
-                if (iou > maxIoU) {
-                    maxIoU = iou;
-                    bestDetIdx = i;
-                }
+        batchImages.clear();
+        for (size_t i : members) batchImages.push_back(tiles[i].image);
+        try {
+            // Every tile of the batch waits for the whole batch, so each road records the full time once.
+            StageClock::time_point start = StageClock::now();
+            const cv::Mat& input = preprocessor.prepareBatch(batchImages, group.first, batchLetterboxes);
+            const double preprocessMs = millisecondsSince(start);
+            stageTimings.preprocessMs += preprocessMs;
+
+            start = StageClock::now();
+            backend->infer(input, outputs);
+            const double inferenceMs = millisecondsSince(start);
+            stageTimings.inferenceMs += inferenceMs;
+            for (size_t b = 0; b < members.size(); ++b) {
+                const int roadIndex = tiles[members[b]].roadIndex;
+                if (b > 0 && tiles[members[b - 1]].roadIndex == roadIndex) continue; // a road's tiles are adjacent
+                recordStage(Metrics::Stage::Preprocess, roadIndex, preprocessMs);
+                recordStage(Metrics::Stage::Inference, roadIndex, inferenceMs);
             }
-        }
 
-        if (maxIoU > 0.3) {
-            tracker.boundingBox = detections[bestDetIdx];
-            tracker.framesWithoutDetection = 0;
-            usedDetections[bestDetIdx] = true;
-
-            // Violation logic: If light is red, vehicle is a candidate.
-            if (currentLight == TrafficLight::RED) {
-                tracker.violationFrameCount++;
-                tracker.isViolationCandidate = true;
-            } else { // Reset if light is not red
-                tracker.violationFrameCount = 0;
-                tracker.isViolationCandidate = false;
+            // Batched output is [N][84][anchors]; each batch index is a contiguous 84 x anchors plane.
+            const cv::Mat& output = outputs[0];
+            if (output.dims != 3 || output.size[0] != static_cast<int>(members.size())) {
+                CV_Error(cv::Error::StsUnmatchedSizes, "model returned an unexpected batch size");
             }
+            for (size_t b = 0; b < members.size(); ++b) {
+                start = StageClock::now();
+                cv::Mat detection_matrix(output.size[1], output.size[2], CV_32F, const_cast<float*>(output.ptr<float>(static_cast<int>(b))));
+                results[members[b]] = decodeYoloOutput(detection_matrix, batchLetterboxes[b]);
+                const double decodeMs = millisecondsSince(start);
+                stageTimings.decodeMs += decodeMs;
+                recordStage(Metrics::Stage::Decode, tiles[members[b]].roadIndex, decodeMs);
+            }
+        } catch (const cv::Exception& e) {
+            // The model passed the batch probe, so this is a failure of this batch only; run it per frame.
+            emit logMessage(QString("Batched YOLO inference failed, running this batch per frame: %1").arg(e.what()), "WARNING");
+            for (size_t i : members) results[i] = detectVehiclesYOLO(tiles[i]);
         }
     }
+    return results;
+}
 
-    // Deregister old trackers that have been lost for too long
-    for (auto it = trackers.begin(); it != trackers.end();) {
-        if (it->second.framesWithoutDetection > maxFramesDisappeared) {
-            it = trackers.erase(it);
-        } else {
-            ++it;
-        }
+// Decodes one 84 x anchors YOLOv8 output plane into vehicle boxes in frame coordinates,
+// undoing the letterbox padding and scale. Boxes down to the tracker's low threshold
+// are kept so weak detections can still extend existing tracks.
+std::vector<VehicleDetection> ProcessingWorker::decodeYoloOutput(const cv::Mat& output, const LetterboxInfo& letterbox) {
+    std::vector<VehicleDetection> boxes;
+
+    float factor = 1.0f / letterbox.scale;
+    float threshold = std::min(yoloConfidenceThreshold, trackLowConfidenceThreshold);
+    YoloDecoder::decodeVehicles(output, threshold, factor, factor,
+                                static_cast<float>(letterbox.padX), static_cast<float>(letterbox.padY),
+                                candidateBoxes, candidateConfidences);
+
+    std::vector<int> nms_indices;
+    cv::dnn::NMSBoxes(candidateBoxes, candidateConfidences, threshold, yoloNmsThreshold, nms_indices);
+    for (int idx : nms_indices) {
+        VehicleDetection detection;
+        detection.box = candidateBoxes[idx];
+        detection.confidence = candidateConfidences[idx];
+        boxes.push_back(detection);
     }
+    return boxes;
+}
 
-    // Register new detections as new trackers
-    for (size_t i = 0; i < detections.size(); ++i) {
-        if (!usedDetections[i]) {
-            TrackedVehicle newVehicle;
-            newVehicle.id = nextVehicleID[roadIndex]++;
-            newVehicle.boundingBox = detections[i];
-            trackers[newVehicle.id] = newVehicle;
-        }
+void ProcessingWorker::updateTrackers(const FrameJob& job, const std::vector<VehicleDetection>& detections) {
+    const StageClock::time_point start = StageClock::now();
+    VehicleTracker& tracker = trackStateFor(job).tracker;
+    tracker.setHighConfidenceThreshold(yoloConfidenceThreshold);
+    // Templates are only needed when the following skipped frames will refine with them.
+    try {
+        tracker.update(detections, job.currentLight, *job.frame, job.refineTracks);
+    } catch (const cv::Exception& e) {
+        emit logMessage(QString("Road %1 tracking failed: %2").arg(job.roadIndex + 1).arg(e.what()), "WARNING");
     }
+    const double ms = millisecondsSince(start);
+    stageTimings.trackingMs += ms;
+    recordStage(Metrics::Stage::Tracking, job.roadIndex, ms);
 }
 
+void ProcessingWorker::advanceTrackers(const FrameJob& job) {
+    const StageClock::time_point start = StageClock::now();
+    VehicleTracker& tracker = trackStateFor(job).tracker;
+    try {
+        tracker.advance(job.currentLight, *job.frame, job.refineTracks);
+    } catch (const cv::Exception& e) {
+        emit logMessage(QString("Road %1 tracking failed: %2").arg(job.roadIndex + 1).arg(e.what()), "WARNING");
+    }
+    const double ms = millisecondsSince(start);
+    stageTimings.trackingMs += ms;
+    recordStage(Metrics::Stage::Tracking, job.roadIndex, ms);
+}
 
-void ProcessingWorker::drawDetections(cv::Mat &frame, int roadIndex) {
-    const auto& trackers = roadTrackers[roadIndex];
-    for (const auto& pair : trackers) {
-        const TrackedVehicle& veh = pair.second;
-        cv::Scalar color = veh.isViolationCandidate ? cv::Scalar(0, 0, 255) : cv::Scalar(0, 255, 0); // Red if violation candidate
-        cv::rectangle(frame, veh.boundingBox, color, 2);
-        QString label = "ID: " + QString::number(veh.id);
-        cv::putText(frame, label.toStdString(), cv::Point(veh.boundingBox.x, veh.boundingBox.y - 10), cv::FONT_HERSHEY_SIMPLEX, 0.6, color, 2);
+void ProcessingWorker::drawDetections(cv::Mat& bgraFrame, const VehicleTracker& tracker, double scale) {
+    const double fontScale = std::max(0.35, 0.6 * scale);
+    const int thickness = scale < 0.5 ? 1 : 2;
+    for (int t = 0; t < tracker.size(); ++t) {
+        cv::Rect fullBox = tracker.getBox(t);
+        cv::Rect box(cvRound(fullBox.x * scale), cvRound(fullBox.y * scale), cvRound(fullBox.width * scale), cvRound(fullBox.height * scale));
+        cv::Scalar color = tracker.isViolationCandidate(t) ? cv::Scalar(0, 0, 255, 255) : cv::Scalar(0, 255, 0, 255); // Red if violation candidate
+        cv::rectangle(bgraFrame, box, color, thickness);
+        QString label = "ID: " + QString::number(tracker.getId(t));
+        cv::putText(bgraFrame, label.toStdString(), cv::Point(box.x, box.y - 5), cv::FONT_HERSHEY_SIMPLEX, fontScale, color, thickness);
     }
 }
 
-QImage ProcessingWorker::matToQImage(const cv::Mat& mat) {
-    if (mat.empty()) return QImage();
-    if (mat.type() == CV_8UC3) return QImage(mat.data, mat.cols, mat.rows, static_cast<int>(mat.step), QImage::Format_RGB888).rgbSwapped();
-    return QImage(mat.data, mat.cols, mat.rows, static_cast<int>(mat.step), QImage::Format_Grayscale8);
+// Renders the preview at the size of the view that shows it, never larger than the
+// frame, straight into a Format_RGB32 QImage (BGRA in memory), which the GUI thread
+// can turn into a pixmap without converting. The shared captured frame stays untouched.
+QImage ProcessingWorker::renderDisplayFrame(const cv::Mat& frame, int roadIndex, const VehicleTracker& tracker, const cv::Size& displaySize) {
+    if (frame.empty()) return QImage();
+    StageClock::time_point start = StageClock::now();
+
+    double scale = 1.0;
+    if (displaySize.width > 0 && displaySize.height > 0) {
+        scale = std::min(1.0, std::min(static_cast<double>(displaySize.width) / frame.cols,
+                                       static_cast<double>(displaySize.height) / frame.rows));
+    }
+    cv::Size scaled(std::max(1, cvRound(frame.cols * scale)), std::max(1, cvRound(frame.rows * scale)));
+
+    QImage image(scaled.width, scaled.height, QImage::Format_RGB32);
+    cv::Mat bgra(image.height(), image.width(), CV_8UC4, image.bits(), static_cast<size_t>(image.bytesPerLine()));
+    const cv::Mat* source = &frame;
+    if (scaled != frame.size()) {
+        // Bilinear is plenty for a preview and much cheaper than INTER_AREA at these ratios.
+        cv::resize(frame, displayScratch, scaled, 0, 0, cv::INTER_LINEAR);
+        source = &displayScratch;
+    }
+    cv::cvtColor(*source, bgra, source->channels() == 1 ? cv::COLOR_GRAY2BGRA : cv::COLOR_BGR2BGRA);
+    double ms = millisecondsSince(start);
+    stageTimings.renderMs += ms;
+    recordStage(Metrics::Stage::Convert, roadIndex, ms);
+
+    start = StageClock::now();
+    drawDetections(bgra, tracker, static_cast<double>(scaled.width) / frame.cols);
+    ms = millisecondsSince(start);
+    stageTimings.renderMs += ms;
+    recordStage(Metrics::Stage::Draw, roadIndex, ms);
+    return image;
 }
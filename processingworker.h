@@ -7,16 +7,42 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/dnn.hpp>
 #include "traffic_types.h"
-#include <array>
+#include "framepreprocessor.h"
+#include "vehicletracker.h"
+#include "motiongate.h"
+#include "framepool.h"
+#include "metrics.h"
+#include "inferencebackend.h"
+#include "tileplanner.h"
 #include <map>
+#include <memory>
 #include <vector>
 
-struct TrackedVehicle {
-    int id;
-    cv::Rect boundingBox;
-    int framesWithoutDetection = 0;
-    bool isViolationCandidate = false;
-    int violationFrameCount = 0;
+// Tracker state of one road. Owned by the pool and handed to whichever worker
+// gets the road's frame; a road is only ever processed by one worker at a
+// time, so no locking is needed.
+struct RoadTrackState {
+    VehicleTracker tracker;
+    MotionGate motionGate;
+};
+
+struct FrameJob {
+    int roadIndex = -1;
+    // Set by the pool; jobs without one use the worker's own state for the road.
+    RoadTrackState* trackState = nullptr;
+    FrameRef frame;
+    qint64 capturedAtMs = 0; // wall clock, ms since epoch
+    cv::Rect roi;
+    TrafficLight currentLight = TrafficLight::OFF;
+    // false: no YOLO pass, tracks are advanced by their motion model only.
+    bool runDetector = true;
+    bool refineTracks = false;
+    // Preview for the road's view: skipped when the view's frame-rate cap says so.
+    bool renderDisplay = true;
+    cv::Size displaySize;
+    // Caps on the input size and tile count from the quality governor; 0: none.
+    int maxInputSize = 0;
+    int maxTiles = 0;
 };
 
 class ProcessingWorker : public QObject
@@ -24,37 +50,91 @@ class ProcessingWorker : public QObject
     Q_OBJECT
 
 public:
+    // Wall time of each pipeline stage, summed over the frames of the last processBatch() call.
+    struct StageTimings {
+        double motionGateMs = 0.0;
+        double preprocessMs = 0.0;
+        double inferenceMs = 0.0;
+        double decodeMs = 0.0;
+        double trackingMs = 0.0;
+        double renderMs = 0.0;
+    };
+
     explicit ProcessingWorker(QObject *parent = nullptr);
     ~ProcessingWorker();
 
+    // Backend and intra-op threads used by the next initializeModels() (default: OpenCV DNN, its own thread count).
+    void setInferenceBackend(InferenceBackend::Type type, int threads) { backendType = type; backendThreads = threads; }
+    // Input sizes and tiling; call before initializeModels(), which drops the sizes the model rejects.
+    void setTilingOptions(const TilingOptions& options);
     bool initializeModels(const QString& yoloModelPath, const QString& cocoNamesPath);
+    QString describeInferenceBackend() const { return backend ? backend->describe() : QString(); }
+    // Only meaningful on the worker's thread, e.g. from a processingFinished handler or after a direct call.
+    const StageTimings& getLastStageTimings() const { return stageTimings; }
+    // Detector output of the last processBatch() call per road, in frame coordinates. Same threading rule.
+    const std::map<int, std::vector<VehicleDetection>>& getLastDetections() const { return lastDetections; }
+    // Per-road stage histograms; set before the worker's thread starts.
+    void setMetrics(Metrics* metrics) { this->metrics = metrics; }
 
 public slots:
     void processFrame(int roadIndex, cv::Mat frame, cv::Rect roi, TrafficLight currentLight);
+    void processBatch(std::vector<FrameJob> jobs);
     void setYoloThresholds(float confidence, float nms);
+    void setMotionGateEnabled(bool enabled);
 
 signals:
-    void processingFinished(int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs);
+    // frame and capturedAtMs are the job's, so violations are evidenced with the frame they were detected on.
+    void processingFinished(int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs,
+                            const FrameRef& frame, qint64 capturedAtMs);
     void logMessage(const QString& message, const QString& level);
 
 private:
+    // One network input: a whole region of interest or one tile of it.
+    struct DetectorTile {
+        int roadIndex = -1;
+        int slot = 0;           // preprocessor tensor, one per road and tile
+        cv::Mat image;
+        int inputSize = 0;
+    };
 
-    cv::dnn::Net yoloNet;
+    std::unique_ptr<InferenceBackend> backend;
+    InferenceBackend::Type backendType = InferenceBackend::Type::OpenCvDnn;
+    int backendThreads = 0;
     std::vector<std::string> classNames;
     bool yoloInitialized = false;
+    bool batchForwardSupported = true;
+    FramePreprocessor preprocessor;
+    TilePlanner tilePlanner;
+    std::vector<cv::Mat> batchImages;
+    std::vector<LetterboxInfo> batchLetterboxes;
+    std::vector<cv::Mat> outputs;
+    std::vector<cv::Rect> candidateBoxes;
+    std::vector<float> candidateConfidences;
+    cv::Mat displayScratch;
     float yoloConfidenceThreshold = 0.45f;
     float yoloNmsThreshold = 0.4f;
+    float trackLowConfidenceThreshold = 0.1f;
+    bool motionGateEnabled = true;
+    StageTimings stageTimings;
+    std::map<int, std::vector<VehicleDetection>> lastDetections;
+    Metrics* metrics = nullptr;
 
+    std::map<int, RoadTrackState> ownTrackStates;
 
-    std::array<std::map<int, TrackedVehicle>, 4> roadTrackers;
-    std::array<int, 4> nextVehicleID;
-
-    void detectAndTrack(int roadIndex, cv::Mat &frame, TrafficLight currentLight);
-    std::vector<cv::Rect> detectVehiclesYOLO(const cv::Mat& frame);
-    void updateTrackers(int roadIndex, const std::vector<cv::Rect>& detections, TrafficLight currentLight);
+    bool probeInputSizes();
+    void probeBatchForward();
+    RoadTrackState& trackStateFor(const FrameJob& job);
+    void recordStage(Metrics::Stage stage, int roadIndex, double milliseconds);
+    void finishFrame(const FrameJob& job);
+    bool passesMotionGate(const FrameJob& job, const cv::Mat& frame, const cv::Rect& region);
+    std::vector<VehicleDetection> detectVehiclesYOLO(const DetectorTile& tile);
+    std::vector<std::vector<VehicleDetection>> detectVehiclesYOLOBatch(const std::vector<DetectorTile>& tiles);
+    std::vector<VehicleDetection> decodeYoloOutput(const cv::Mat& output, const LetterboxInfo& letterbox);
+    void updateTrackers(const FrameJob& job, const std::vector<VehicleDetection>& detections);
+    void advanceTrackers(const FrameJob& job);
 
-    QImage matToQImage(const cv::Mat& mat);
-    void drawDetections(cv::Mat& frame, int roadIndex);
+    QImage renderDisplayFrame(const cv::Mat& frame, int roadIndex, const VehicleTracker& tracker, const cv::Size& displaySize);
+    void drawDetections(cv::Mat& bgraFrame, const VehicleTracker& tracker, double scale);
 };
 
 #endif // PROCESSINGWORKER_H
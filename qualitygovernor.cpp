@@ -0,0 +1,147 @@
+#include "qualitygovernor.h"
+#include <QStringList>
+
+// A window needs this many finished frames (or some drops) to be judged at all.
+static const quint64 MIN_WINDOW_FRAMES = 5;
+// Share of submitted frames the queue may replace before the road counts as overloaded.
+static const double MAX_DROP_SHARE = 0.1;
+// Stepping back up needs RECOVER_WINDOWS windows in a row below this share of the budget.
+static const double RECOVER_BUDGET_SHARE = 0.6;
+static const int RECOVER_WINDOWS = 5;
+
+// Cheapest savings first: the preview costs nothing in accuracy, tiles and the
+// detector interval a little, a smaller input the most.
+static const RoadQuality LADDER[] = {
+    {1, 0, 0, 0},
+    {1, 10, 0, 0},
+    {1, 5, 0, 2},
+    {2, 5, 0, 1},
+    {2, 5, 416, 1},
+    {3, 2, 416, 1},
+    {4, 2, 320, 1}
+};
+static const int LEVEL_COUNT = sizeof(LADDER) / sizeof(LADDER[0]);
+
+namespace {
+
+// Samples recorded between two snapshots of the same histogram. The maximum is
+// not windowed; it only caps the top bucket.
+LatencyHistogram::Snapshot windowBetween(const LatencyHistogram::Snapshot& before, const LatencyHistogram::Snapshot& now) {
+    LatencyHistogram::Snapshot window = now;
+    window.count = 0;
+    for (size_t i = 0; i < window.buckets.size(); ++i) {
+        if (i < before.buckets.size()) window.buckets[i] -= before.buckets[i];
+        window.count += window.buckets[i];
+    }
+    window.sumMicros = now.sumMicros - before.sumMicros;
+    return window;
+}
+
+}
+
+QualityGovernor::QualityGovernor(Metrics* metrics, InferencePool* pool, QObject *parent)
+    : QObject(parent),
+    metrics(metrics),
+    pool(pool),
+    timer(new QTimer(this)),
+    roads(metrics->getRoadCount())
+{
+    connect(timer, &QTimer::timeout, this, &QualityGovernor::evaluate);
+}
+
+void QualityGovernor::setFrameBudget(int roadIndex, int milliseconds) {
+    if (!isValidRoad(roadIndex)) return;
+    roads[roadIndex].budgetMs = qMax(0, milliseconds);
+    if (roads[roadIndex].budgetMs == 0 && roads[roadIndex].level != 0) applyLevel(roadIndex, 0, "no budget");
+}
+
+int QualityGovernor::getFrameBudget(int roadIndex) const {
+    return isValidRoad(roadIndex) ? roads[roadIndex].budgetMs : 0;
+}
+
+int QualityGovernor::getLevel(int roadIndex) const {
+    return isValidRoad(roadIndex) ? roads[roadIndex].level : 0;
+}
+
+void QualityGovernor::start(int windowMs) {
+    // The first window starts now, not at process start.
+    for (int r = 0; r < static_cast<int>(roads.size()); ++r) {
+        roads[r].lastPipeline = metrics->snapshot(Metrics::Stage::Pipeline, r);
+        roads[r].lastSubmitted = metrics->getCounter(Metrics::Counter::FramesSubmitted, r);
+        roads[r].lastDropped = metrics->getCounter(Metrics::Counter::QueueDropped, r);
+        roads[r].calmWindows = 0;
+        roads[r].settling = false;
+    }
+    timer->start(qMax(100, windowMs));
+}
+
+void QualityGovernor::stop() {
+    timer->stop();
+}
+
+int QualityGovernor::getLevelCount() {
+    return LEVEL_COUNT;
+}
+
+QString QualityGovernor::describeLevel(int level) {
+    if (level <= 0 || level >= LEVEL_COUNT) return "full quality";
+    const RoadQuality& quality = LADDER[level];
+    QStringList parts;
+    if (quality.displayMaxFps > 0) parts << QString("preview at most %1 fps").arg(quality.displayMaxFps);
+    if (quality.maxTiles > 0) parts << (quality.maxTiles == 1 ? QString("no tiling") : QString("at most %1 tiles").arg(quality.maxTiles));
+    if (quality.detectorIntervalFactor > 1) parts << QString("detector interval x%1").arg(quality.detectorIntervalFactor);
+    if (quality.maxInputSize > 0) parts << QString("input at most %1 px").arg(quality.maxInputSize);
+    return parts.join(", ");
+}
+
+void QualityGovernor::evaluate() {
+    for (int r = 0; r < static_cast<int>(roads.size()); ++r) {
+        RoadState& road = roads[r];
+        const LatencyHistogram::Snapshot pipeline = metrics->snapshot(Metrics::Stage::Pipeline, r);
+        const quint64 submitted = metrics->getCounter(Metrics::Counter::FramesSubmitted, r);
+        const quint64 dropped = metrics->getCounter(Metrics::Counter::QueueDropped, r);
+        const LatencyHistogram::Snapshot window = windowBetween(road.lastPipeline, pipeline);
+        const quint64 windowSubmitted = submitted - road.lastSubmitted;
+        const quint64 windowDropped = dropped - road.lastDropped;
+        road.lastPipeline = pipeline;
+        road.lastSubmitted = submitted;
+        road.lastDropped = dropped;
+
+        if (road.budgetMs <= 0) continue;
+        if (road.settling) {
+            road.settling = false;
+            continue;
+        }
+        if (window.count < MIN_WINDOW_FRAMES && windowDropped == 0) continue;
+
+        const double p95Ms = window.quantileMicros(0.95) / 1000.0;
+        const double dropShare = windowSubmitted > 0 ? static_cast<double>(windowDropped) / windowSubmitted : 0.0;
+        const QString reason = QString("p95 %1 ms, %2% of frames dropped, budget %3 ms")
+                                   .arg(p95Ms, 0, 'f', 1).arg(100.0 * dropShare, 0, 'f', 1).arg(road.budgetMs);
+
+        if (p95Ms > road.budgetMs || dropShare > MAX_DROP_SHARE) {
+            road.calmWindows = 0;
+            if (road.level + 1 < LEVEL_COUNT) applyLevel(r, road.level + 1, reason);
+        } else if (p95Ms < road.budgetMs * RECOVER_BUDGET_SHARE && windowDropped == 0) {
+            if (road.level > 0 && ++road.calmWindows >= RECOVER_WINDOWS) {
+                road.calmWindows = 0;
+                applyLevel(r, road.level - 1, reason);
+            }
+        } else {
+            road.calmWindows = 0;
+        }
+    }
+}
+
+void QualityGovernor::applyLevel(int roadIndex, int level, const QString& reason) {
+    RoadState& road = roads[roadIndex];
+    const int previous = road.level;
+    road.level = level;
+    road.settling = true;
+    pool->setRoadQuality(roadIndex, LADDER[level]);
+    metrics->setGauge(Metrics::Gauge::QualityLevel, roadIndex, level);
+
+    const QString description = describeLevel(level);
+    emit logMessage(QString("Road %1 quality %2 -> %3 (%4): %5.").arg(roadIndex + 1).arg(previous).arg(level).arg(reason, description), "ACTION");
+    emit qualityChanged(roadIndex, level, description);
+}
@@ -0,0 +1,62 @@
+#ifndef QUALITYGOVERNOR_H
+#define QUALITYGOVERNOR_H
+
+#include <QObject>
+#include <QTimer>
+#include "inferencepool.h"
+#include "metrics.h"
+#include <vector>
+
+// Feedback loop between measured latency and pipeline quality. Once per window
+// it compares each road's p95 submit-to-result latency and its queue drops with
+// the road's frame budget, and moves the road one step along a fixed ladder:
+// preview rate first, then tiles, detector interval and input size. A missed
+// budget steps down at once; stepping back up takes several windows well
+// inside the budget. The window right after a change is skipped, since most
+// of its frames were processed before the change.
+class QualityGovernor : public QObject
+{
+    Q_OBJECT
+
+public:
+    QualityGovernor(Metrics* metrics, InferencePool* pool, QObject *parent = nullptr);
+
+    // 0 leaves the road at full quality and out of the loop.
+    void setFrameBudget(int roadIndex, int milliseconds);
+    int getFrameBudget(int roadIndex) const;
+    int getLevel(int roadIndex) const;
+
+    void start(int windowMs = 2000);
+    void stop();
+
+    static int getLevelCount();
+    static QString describeLevel(int level);
+
+signals:
+    void qualityChanged(int roadIndex, int level, const QString& description);
+    void logMessage(const QString& message, const QString& level);
+
+private slots:
+    void evaluate();
+
+private:
+    struct RoadState {
+        int budgetMs = 0;
+        int level = 0;
+        int calmWindows = 0;
+        bool settling = false;
+        LatencyHistogram::Snapshot lastPipeline;
+        quint64 lastSubmitted = 0;
+        quint64 lastDropped = 0;
+    };
+
+    Metrics* metrics;
+    InferencePool* pool;
+    QTimer* timer;
+    std::vector<RoadState> roads;
+
+    bool isValidRoad(int roadIndex) const { return roadIndex >= 0 && roadIndex < static_cast<int>(roads.size()); }
+    void applyLevel(int roadIndex, int level, const QString& reason);
+};
+
+#endif // QUALITYGOVERNOR_H
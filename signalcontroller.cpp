@@ -0,0 +1,93 @@
+#include "signalcontroller.h"
+
+SignalController::SignalController(int approachCount, const SignalClock* clock, QObject *parent)
+    : QObject(parent),
+    clock(clock ? clock : &steadyClock),
+    lights(qMax(1, approachCount), TrafficLight::OFF),
+    greenDuration([](int) { return qint64(10000); })
+{
+}
+
+void SignalController::start(int approach) {
+    const int count = static_cast<int>(lights.size());
+    servedApproach = ((approach % count) + count) % count;
+    enterPhase(Phase::AllRed, clock->nowMs());
+    update();
+}
+
+void SignalController::stop(TrafficLight light) {
+    phase = Phase::Off;
+    for (int a = 0; a < static_cast<int>(lights.size()); ++a) setLight(a, light);
+}
+
+qint64 SignalController::update() {
+    if (phase == Phase::Off) return -1;
+    const qint64 now = clock->nowMs();
+    while (phase != Phase::Off && now >= phaseEndMs) {
+        const qint64 startMs = now - phaseEndMs > MAX_CATCH_UP_MS ? now : phaseEndMs;
+        switch (phase) {
+        case Phase::AllRed:
+            enterPhase(Phase::Green, startMs);
+            break;
+        case Phase::Green:
+            enterPhase(Phase::Yellow, startMs);
+            break;
+        case Phase::Yellow:
+            servedApproach = (servedApproach + 1) % static_cast<int>(lights.size());
+            enterPhase(Phase::AllRed, startMs);
+            break;
+        case Phase::Off:
+            break;
+        }
+    }
+    return phase == Phase::Off ? -1 : phaseEndMs - now;
+}
+
+TrafficLight SignalController::getLight(int approach) const {
+    return approach >= 0 && approach < static_cast<int>(lights.size()) ? lights[approach] : TrafficLight::OFF;
+}
+
+qint64 SignalController::getRemainingMs() const {
+    return phase == Phase::Off ? 0 : qMax<qint64>(0, phaseEndMs - clock->nowMs());
+}
+
+const char* SignalController::phaseName(Phase phase) {
+    switch (phase) {
+    case Phase::AllRed: return "all-red";
+    case Phase::Green: return "green";
+    case Phase::Yellow: return "yellow";
+    case Phase::Off: break;
+    }
+    return "off";
+}
+
+void SignalController::enterPhase(Phase next, qint64 startMs) {
+    phase = next;
+    phaseStartMs = startMs;
+    qint64 duration = 0;
+    switch (next) {
+    case Phase::AllRed:
+        for (int a = 0; a < static_cast<int>(lights.size()); ++a) setLight(a, TrafficLight::RED);
+        duration = allRedMs;
+        break;
+    case Phase::Green:
+        setLight(servedApproach, TrafficLight::GREEN);
+        // At least a second, so a misconfigured duration can't spin the loop.
+        duration = qMax<qint64>(1000, greenDuration(servedApproach));
+        break;
+    case Phase::Yellow:
+        setLight(servedApproach, TrafficLight::YELLOW);
+        duration = yellowMs;
+        break;
+    case Phase::Off:
+        break;
+    }
+    phaseEndMs = startMs + duration;
+    emit phaseChanged(next, servedApproach);
+}
+
+void SignalController::setLight(int approach, TrafficLight light) {
+    if (lights[approach] == light) return;
+    lights[approach] = light;
+    emit lightChanged(approach, light);
+}
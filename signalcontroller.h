@@ -0,0 +1,111 @@
+#ifndef SIGNALCONTROLLER_H
+#define SIGNALCONTROLLER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include "traffic_types.h"
+#include <functional>
+#include <vector>
+
+// Monotonic milliseconds. Controllers read time only through this, so a test
+// can drive them with a ManualClock instead of waiting for real time.
+class SignalClock
+{
+public:
+    virtual ~SignalClock() = default;
+    virtual qint64 nowMs() const = 0;
+};
+
+class SteadyClock : public SignalClock
+{
+public:
+    SteadyClock() { timer.start(); }
+    qint64 nowMs() const override { return timer.elapsed(); }
+
+private:
+    QElapsedTimer timer;
+};
+
+class ManualClock : public SignalClock
+{
+public:
+    qint64 nowMs() const override { return now; }
+    void setMs(qint64 ms) { now = qMax(now, ms); }
+    void advance(qint64 ms) { now += qMax<qint64>(0, ms); }
+
+private:
+    qint64 now = 0;
+};
+
+// Light cycle of one intersection as an explicit state machine:
+//   AllRed -> Green(n) -> Yellow(n) -> AllRed -> Green(n + 1) -> ...
+// Every phase ends at a deadline on the clock. A phase starts at its
+// predecessor's deadline, not when update() happened to run, so a slow event
+// loop doesn't stretch the cycle; only when update() is more than
+// MAX_CATCH_UP_MS late does the next phase start from now, so yellow and all-red
+// are never cut short in real time.
+//
+// update() makes every transition that is due and returns the time to the next
+// one. A live controller calls it from a single-shot timer; a test fast-forwards
+// with clock.setMs(nextDeadlineMs()); update(); in a loop.
+class SignalController : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Phase { Off, AllRed, Green, Yellow };
+    static const qint64 MAX_CATCH_UP_MS = 250;
+
+    // clock is not owned; null uses a steady clock of the controller's own.
+    explicit SignalController(int approachCount, const SignalClock* clock = nullptr, QObject *parent = nullptr);
+
+    // Read when a green phase starts; defaults to 10 s for every approach.
+    void setGreenDurationSource(std::function<qint64(int approach)> source) { greenDuration = std::move(source); }
+    void setYellowDuration(qint64 ms) { yellowMs = qMax<qint64>(0, ms); }
+    // Clearance with every approach red between a yellow and the next green; 0 skips it.
+    void setAllRedDuration(qint64 ms) { allRedMs = qMax<qint64>(0, ms); }
+    qint64 getYellowDuration() const { return yellowMs; }
+    qint64 getAllRedDuration() const { return allRedMs; }
+
+    // Starts the cycle with the all-red clearance, then a green for approach.
+    void start(int approach = 0);
+    // Stops the cycle and shows light on every approach.
+    void stop(TrafficLight light = TrafficLight::OFF);
+    bool isRunning() const { return phase != Phase::Off; }
+
+    // Returns the milliseconds until the next transition, -1 when stopped.
+    qint64 update();
+
+    Phase getPhase() const { return phase; }
+    int getServedApproach() const { return servedApproach; }
+    TrafficLight getLight(int approach) const;
+    qint64 getPhaseDuration() const { return phaseEndMs - phaseStartMs; }
+    qint64 getRemainingMs() const;
+    qint64 nextDeadlineMs() const { return phaseEndMs; }
+    const SignalClock* getClock() const { return clock; }
+
+    static const char* phaseName(Phase phase);
+
+signals:
+    void lightChanged(int approach, TrafficLight light);
+    // During all-red, approach is the one whose green comes next.
+    void phaseChanged(SignalController::Phase phase, int approach);
+
+private:
+    SteadyClock steadyClock;
+    const SignalClock* clock;
+    std::vector<TrafficLight> lights;
+    std::function<qint64(int)> greenDuration;
+    qint64 yellowMs = 3000;
+    qint64 allRedMs = 1000;
+
+    Phase phase = Phase::Off;
+    int servedApproach = 0;
+    qint64 phaseStartMs = 0;
+    qint64 phaseEndMs = 0;
+
+    void enterPhase(Phase next, qint64 startMs);
+    void setLight(int approach, TrafficLight light);
+};
+
+#endif // SIGNALCONTROLLER_H
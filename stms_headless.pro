@@ -0,0 +1,19 @@
+# Headless controller: the same core as SmartTrafficSystem without QtWidgets,
+# configured from an INI file and the command line.
+QT -= widgets
+QT += core gui serialport
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+include(stmscore.pri)
+
+TARGET = stms_headless
+TEMPLATE = app
+
+SOURCES += \
+    headless_main.cpp
+
+# Deployment
+unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,38 @@
+# Traffic control core shared by the desktop UI and the headless controller.
+# Nothing here may depend on QtWidgets; QtGui is only needed for QImage.
+QT += core gui network serialport
+
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+
+# Detection pipeline, OpenCV and the inference backends
+include($$PWD/stmspipeline.pri)
+
+SOURCES += \
+    $$PWD/cameracapture.cpp \
+    $$PWD/evidencestore.cpp \
+    $$PWD/evidencewriter.cpp \
+    $$PWD/framehistory.cpp \
+    $$PWD/framescheduler.cpp \
+    $$PWD/inferencepool.cpp \
+    $$PWD/logger.cpp \
+    $$PWD/metricsserver.cpp \
+    $$PWD/qualitygovernor.cpp \
+    $$PWD/signalcontroller.cpp \
+    $$PWD/trafficsimulator.cpp \
+    $$PWD/trafficsystem.cpp
+
+HEADERS += \
+    $$PWD/cameracapture.h \
+    $$PWD/evidencestore.h \
+    $$PWD/evidencewriter.h \
+    $$PWD/framehistory.h \
+    $$PWD/framescheduler.h \
+    $$PWD/inferencepool.h \
+    $$PWD/logger.h \
+    $$PWD/metricsserver.h \
+    $$PWD/qualitygovernor.h \
+    $$PWD/signalcontroller.h \
+    $$PWD/trafficsimulator.h \
+    $$PWD/trafficsystem.h
@@ -0,0 +1,43 @@
+# Detection pipeline: frames in, tracked vehicles out. Shared by the core and the
+# offline tools (tools/replay); needs QtCore and QtGui (QImage) only.
+QT += core gui
+
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+
+# OpenCV 4.11.0 Configuration
+win32 {
+    INCLUDEPATH += "C:/opencv/build/include"
+    CONFIG(release, debug|release): LIBS += -L"C:/opencv/build/x64/vc16/lib" -lopencv_world4110
+    CONFIG(debug, debug|release): LIBS += -L"C:/opencv/build/x64/vc16/lib" -lopencv_world4110d
+}
+unix {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv4
+}
+
+include($$PWD/inferencebackends.pri)
+
+SOURCES += \
+    $$PWD/framepool.cpp \
+    $$PWD/framepreprocessor.cpp \
+    $$PWD/inferencebackend.cpp \
+    $$PWD/metrics.cpp \
+    $$PWD/motiongate.cpp \
+    $$PWD/processingworker.cpp \
+    $$PWD/tileplanner.cpp \
+    $$PWD/vehicletracker.cpp \
+    $$PWD/yolodecoder.cpp
+
+HEADERS += \
+    $$PWD/framepool.h \
+    $$PWD/framepreprocessor.h \
+    $$PWD/inferencebackend.h \
+    $$PWD/metrics.h \
+    $$PWD/motiongate.h \
+    $$PWD/processingworker.h \
+    $$PWD/tileplanner.h \
+    $$PWD/traffic_types.h \
+    $$PWD/vehicletracker.h \
+    $$PWD/yolodecoder.h
@@ -0,0 +1,142 @@
+#include "tileplanner.h"
+#include <algorithm>
+#include <cmath>
+
+// Share of the smaller box inside the other one that marks two boxes from different tiles as one vehicle.
+static const float CROSS_TILE_CONTAINMENT = 0.6f;
+
+namespace {
+
+int tileCount(int length, int tile, int overlap) {
+    if (length <= tile) return 1;
+    return static_cast<int>(std::ceil(static_cast<double>(length - overlap) / (tile - overlap)));
+}
+
+// Spreads count tiles evenly over length; neighbours overlap by at least the requested amount.
+void placeTiles(int length, int count, int overlap, std::vector<int>& starts, int& tileLength) {
+    tileLength = std::min(length, static_cast<int>(std::ceil(static_cast<double>(length + (count - 1) * overlap) / count)));
+    starts.resize(count);
+    for (int i = 0; i < count; ++i) {
+        starts[i] = count == 1 ? 0 : static_cast<int>(std::lround(static_cast<double>(i) * (length - tileLength) / (count - 1)));
+    }
+}
+
+}
+
+TilePlanner::TilePlanner() {
+}
+
+void TilePlanner::setOptions(const TilingOptions& options) {
+    this->options = options;
+    setInputSizes(options.inputSizes);
+    this->options.tileAboveScale = std::max(1.0, options.tileAboveScale);
+    this->options.tileScale = std::max(1.0, options.tileScale);
+    this->options.overlap = std::min(0.5, std::max(0.0, options.overlap));
+    this->options.maxTiles = std::min(MAX_TILE_LIMIT, std::max(1, options.maxTiles));
+}
+
+void TilePlanner::setInputSizes(const std::vector<int>& sizes) {
+    std::vector<int> inputSizes;
+    for (int size : sizes) {
+        if (size > 0) inputSizes.push_back(size);
+    }
+    std::sort(inputSizes.begin(), inputSizes.end());
+    inputSizes.erase(std::unique(inputSizes.begin(), inputSizes.end()), inputSizes.end());
+    if (inputSizes.empty()) inputSizes.push_back(640);
+    options.inputSizes = inputSizes;
+    plans.clear();
+}
+
+const std::vector<InferenceTile>& TilePlanner::plan(const cv::Size& region, int maxInputSize, int maxTiles) {
+    const std::tuple<int, int, int, int> key(region.width, region.height, maxInputSize, maxTiles);
+    auto it = plans.find(key);
+    if (it != plans.end()) return it->second;
+
+    std::vector<InferenceTile>& tiles = plans[key];
+    // The capped size list still keeps the smallest size, so there is always one to use.
+    const std::vector<int>& sizes = options.inputSizes;
+    const auto sizesEnd = maxInputSize > 0 ? std::max(sizes.begin() + 1, std::upper_bound(sizes.begin(), sizes.end(), maxInputSize)) : sizes.end();
+    const int largestInput = *(sizesEnd - 1);
+    // Tile geometry follows the model's own size so a capped input only coarsens the tiles.
+    const int modelSize = sizes.back();
+    const int tileLimit = maxTiles > 0 ? std::min(maxTiles, options.maxTiles) : options.maxTiles;
+    const int longest = std::max(region.width, region.height);
+    const cv::Rect whole(0, 0, region.width, region.height);
+
+    if (longest <= largestInput) {
+        InferenceTile tile;
+        tile.rect = whole;
+        tile.inputSize = *std::lower_bound(sizes.begin(), sizesEnd, longest);
+        tiles.push_back(tile);
+        return tiles;
+    }
+    if (tileLimit <= 1 || longest <= modelSize * options.tileAboveScale) {
+        InferenceTile tile;
+        tile.rect = whole;
+        tile.inputSize = largestInput;
+        tiles.push_back(tile);
+        return tiles;
+    }
+
+    double tileLength = modelSize * options.tileScale;
+    int columns = 1, rows = 1, overlap = 0;
+    for (;;) {
+        overlap = static_cast<int>(std::lround(tileLength * options.overlap));
+        columns = tileCount(region.width, static_cast<int>(tileLength), overlap);
+        rows = tileCount(region.height, static_cast<int>(tileLength), overlap);
+        if (columns * rows <= tileLimit) break;
+        tileLength *= 1.25;
+    }
+
+    std::vector<int> xs, ys;
+    int tileWidth = 0, tileHeight = 0;
+    placeTiles(region.width, columns, overlap, xs, tileWidth);
+    placeTiles(region.height, rows, overlap, ys, tileHeight);
+    for (int y : ys) {
+        for (int x : xs) {
+            InferenceTile tile;
+            tile.rect = cv::Rect(x, y, tileWidth, tileHeight) & whole;
+            tile.inputSize = largestInput;
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+std::vector<VehicleDetection> TilePlanner::mergeTiles(const std::vector<std::vector<VehicleDetection>>& tiles, float nmsThreshold) {
+    struct Candidate {
+        VehicleDetection detection;
+        int tile;
+    };
+    std::vector<Candidate> candidates;
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        for (const VehicleDetection& detection : tiles[t]) candidates.push_back({detection, static_cast<int>(t)});
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.detection.confidence > b.detection.confidence;
+    });
+
+    // Each tile's own boxes went through NMS already, so only boxes from different tiles are compared.
+    std::vector<Candidate> kept;
+    for (const Candidate& candidate : candidates) {
+        bool merged = false;
+        for (Candidate& strong : kept) {
+            if (strong.tile == candidate.tile) continue;
+            const double intersection = (strong.detection.box & candidate.detection.box).area();
+            if (intersection <= 0.0) continue;
+            const double smaller = std::min(strong.detection.box.area(), candidate.detection.box.area());
+            const double unionArea = strong.detection.box.area() + candidate.detection.box.area() - intersection;
+            if (intersection / unionArea > nmsThreshold || intersection / smaller > CROSS_TILE_CONTAINMENT) {
+                strong.detection.box |= candidate.detection.box;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) kept.push_back(candidate);
+    }
+
+    std::vector<VehicleDetection> detections;
+    detections.reserve(kept.size());
+    for (const Candidate& candidate : kept) detections.push_back(candidate.detection);
+    return detections;
+}
@@ -0,0 +1,61 @@
+#ifndef TILEPLANNER_H
+#define TILEPLANNER_H
+
+#include <opencv2/core.hpp>
+#include "vehicletracker.h"
+#include <map>
+#include <tuple>
+#include <vector>
+
+struct TilingOptions {
+    // Network input sizes, ascending; the largest is the model's native size.
+    // Smaller ones need a model exported with dynamic shapes.
+    std::vector<int> inputSizes{320, 416, 640};
+    // Regions longer than this many native inputs are tiled instead of being
+    // squeezed into one, with tiles of about tileScale native inputs each.
+    double tileAboveScale = 3.0;
+    double tileScale = 1.5;
+    // Overlap between neighbouring tiles as a fraction of the tile.
+    double overlap = 0.2;
+    // Tiles grow until a region needs at most this many; 1 disables tiling.
+    int maxTiles = 6;
+};
+
+struct InferenceTile {
+    cv::Rect rect;      // in region coordinates
+    int inputSize = 0;
+};
+
+// Picks how a region of interest is fed to the detector from its real size: a
+// small region at the smallest input that holds it without downscaling, a
+// medium one at the native input, and a large one as overlapping tiles at the
+// native input whose detections are merged again with mergeTiles(). Plans are
+// cached per region size.
+class TilePlanner
+{
+public:
+    static const int MAX_TILE_LIMIT = 16;
+
+    TilePlanner();
+
+    // Drops the cached plans.
+    void setOptions(const TilingOptions& options);
+    const TilingOptions& getOptions() const { return options; }
+    // Input sizes the model accepts, as found when it was loaded.
+    void setInputSizes(const std::vector<int>& sizes);
+
+    // maxInputSize and maxTiles tighten the options for this call, 0 leaves them alone.
+    const std::vector<InferenceTile>& plan(const cv::Size& region, int maxInputSize = 0, int maxTiles = 0);
+
+    // Cross-tile NMS over detections already in region coordinates. A box that
+    // overlaps a stronger one from another tile by more than nmsThreshold IoU,
+    // or lies mostly inside it, is the same vehicle cut by a tile edge: the
+    // stronger box is widened to cover both and the weaker one dropped.
+    static std::vector<VehicleDetection> mergeTiles(const std::vector<std::vector<VehicleDetection>>& tiles, float nmsThreshold);
+
+private:
+    TilingOptions options;
+    std::map<std::tuple<int, int, int, int>, std::vector<InferenceTile>> plans;
+};
+
+#endif // TILEPLANNER_H
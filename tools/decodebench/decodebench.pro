@@ -0,0 +1,26 @@
+# Micro-benchmark: YoloDecoder vs. the original transpose + minMaxLoc decoder
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+TARGET = decodebench
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+# OpenCV 4.11.0 Configuration (same layout as the main project)
+win32 {
+    INCLUDEPATH += "C:/opencv/build/include"
+    CONFIG(release, debug|release): LIBS += -L"C:/opencv/build/x64/vc16/lib" -lopencv_world4110
+    CONFIG(debug, debug|release): LIBS += -L"C:/opencv/build/x64/vc16/lib" -lopencv_world4110d
+}
+unix {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv4
+}
+
+SOURCES += \
+    main.cpp \
+    ../../yolodecoder.cpp
+
+HEADERS += \
+    ../../yolodecoder.h
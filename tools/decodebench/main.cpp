@@ -0,0 +1,100 @@
+#include "yolodecoder.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// The decoder ProcessingWorker used before YoloDecoder, kept here as the reference.
+static const std::vector<int> VEHICLE_CLASS_IDS_COCO = {2, 3, 5, 7};
+
+static void legacyDecode(const cv::Mat& output, float threshold, float x_factor, float y_factor,
+                         std::vector<cv::Rect>& boxes_vec, std::vector<float>& confidences) {
+    boxes_vec.clear();
+    confidences.clear();
+
+    cv::Mat detection_matrix;
+    cv::transpose(output, detection_matrix);
+    const int numClasses = output.rows - 4;
+
+    for (int i = 0; i < detection_matrix.rows; i++) {
+        float* row = detection_matrix.ptr<float>(i);
+        cv::Mat class_scores = cv::Mat(1, numClasses, CV_32F, row + 4);
+
+        cv::Point class_id_point;
+        double max_class_score;
+        cv::minMaxLoc(class_scores, 0, &max_class_score, 0, &class_id_point);
+
+        if (max_class_score > threshold) {
+            if (std::find(VEHICLE_CLASS_IDS_COCO.begin(), VEHICLE_CLASS_IDS_COCO.end(), class_id_point.x) == VEHICLE_CLASS_IDS_COCO.end()){
+                continue;
+            }
+            confidences.push_back(static_cast<float>(max_class_score));
+
+            float cx = row[0];
+            float cy = row[1];
+            float w = row[2];
+            float h = row[3];
+
+            int left = static_cast<int>((cx - 0.5 * w) * x_factor);
+            int top = static_cast<int>((cy - 0.5 * h) * y_factor);
+            int width = static_cast<int>(w * x_factor);
+            int height = static_cast<int>(h * y_factor);
+            boxes_vec.push_back(cv::Rect(left, top, width, height));
+        }
+    }
+}
+
+// Synthetic [84][8400] output: background noise plus a few hundred confident anchors,
+// some of them on non-vehicle classes so the argmax rule is exercised.
+static cv::Mat makeSyntheticOutput(int numAnchors, int hotAnchors, uint64_t seed) {
+    cv::Mat output(84, numAnchors, CV_32F);
+    cv::RNG rng(seed);
+    rng.fill(output.rowRange(0, 2), cv::RNG::UNIFORM, cv::Scalar(0), cv::Scalar(640));
+    rng.fill(output.rowRange(2, 4), cv::RNG::UNIFORM, cv::Scalar(4), cv::Scalar(200));
+    rng.fill(output.rowRange(4, 84), cv::RNG::UNIFORM, cv::Scalar(0), cv::Scalar(0.05));
+
+    for (int n = 0; n < hotAnchors; ++n) {
+        int anchor = rng.uniform(0, numAnchors);
+        int classId = rng.uniform(0, 80);
+        output.at<float>(4 + classId, anchor) = rng.uniform(0.3f, 0.99f);
+    }
+    return output;
+}
+
+template <typename Fn>
+static double timeMs(int iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 500;
+    const float threshold = 0.45f;
+    const float xFactor = 1920.0f / 640.0f;
+    const float yFactor = 1080.0f / 640.0f;
+
+    cv::Mat output = makeSyntheticOutput(8400, 400, 42);
+
+    std::vector<cv::Rect> legacyBoxes, fastBoxes;
+    std::vector<float> legacyScores, fastScores;
+    legacyDecode(output, threshold, xFactor, yFactor, legacyBoxes, legacyScores);
+    YoloDecoder::decodeVehicles(output, threshold, xFactor, yFactor, 0.0f, 0.0f, fastBoxes, fastScores);
+
+    bool identical = legacyBoxes.size() == fastBoxes.size() && legacyScores == fastScores;
+    for (size_t i = 0; identical && i < legacyBoxes.size(); ++i) {
+        identical = legacyBoxes[i] == fastBoxes[i];
+    }
+    std::printf("candidates: legacy=%zu fast=%zu identical=%s\n", legacyBoxes.size(), fastBoxes.size(), identical ? "yes" : "NO");
+
+    double legacyMs = timeMs(iterations, [&]() { legacyDecode(output, threshold, xFactor, yFactor, legacyBoxes, legacyScores); });
+    double fastMs = timeMs(iterations, [&]() { YoloDecoder::decodeVehicles(output, threshold, xFactor, yFactor, 0.0f, 0.0f, fastBoxes, fastScores); });
+
+    std::printf("legacy decode: %8.3f ms\n", legacyMs);
+    std::printf("fast decode:   %8.3f ms\n", fastMs);
+    std::printf("speedup:       %8.1fx\n", fastMs > 0.0 ? legacyMs / fastMs : 0.0);
+    return identical ? 0 : 1;
+}
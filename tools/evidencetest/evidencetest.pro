@@ -0,0 +1,17 @@
+# EvidenceStore crash recovery checks: torn data and index tails, trailing garbage
+QT += core
+QT -= gui widgets
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = evidencetest
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../evidencestore.cpp
+
+HEADERS += \
+    ../../evidencestore.h
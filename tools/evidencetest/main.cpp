@@ -0,0 +1,128 @@
+#include "evidencestore.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <climits>
+#include <cstdio>
+
+// Damages the files of a closed EvidenceStore the way a crash mid-append does and
+// checks what open() recovers. Prints each failed check and exits with the number
+// of failures.
+
+static const int RECORD_COUNT = 5;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what, qint64 actual = 0, qint64 expected = 0) {
+    if (condition) return;
+    std::printf("FAIL: %s (got %lld, expected %lld)\n", what, static_cast<long long>(actual), static_cast<long long>(expected));
+    ++failures;
+}
+
+static QByteArray payloadFor(int n) {
+    return QByteArray(1000 + 37 * n, static_cast<char>('a' + n));
+}
+
+static bool appendRecords(EvidenceStore& store, int first, int count) {
+    for (int n = first; n < first + count; ++n) {
+        EvidenceRecord record;
+        record.timestampMs = 1700000000000ll + 1000 * n;
+        record.eventMs = record.timestampMs;
+        record.roadIndex = n % 4;
+        record.reason = "Red Light";
+        record.name = QString("VIO_%1.jpg").arg(n);
+        const QByteArray payload = payloadFor(n);
+        if (!store.append(record, reinterpret_cast<const uchar*>(payload.constData()), static_cast<size_t>(payload.size()))) return false;
+    }
+    return true;
+}
+
+// Reopens the store and checks it holds records 0 .. expected - 1 with their payloads.
+static void checkContents(const QString& directory, int expected, const char* what) {
+    EvidenceStore store(directory);
+    check(store.open(), what);
+    check(store.count() == expected, what, store.count(), expected);
+    const std::vector<EvidenceRecord> records = store.query(0, LLONG_MAX);
+    for (int n = 0; n < static_cast<int>(records.size()) && n < expected; ++n) {
+        check(records[n].name == QString("VIO_%1.jpg").arg(n), what, n, n);
+        check(store.readPayload(records[n]) == payloadFor(n), what, n, n);
+    }
+}
+
+static QString segmentFile(const QString& directory, const char* suffix) {
+    const QStringList names = QDir(directory).entryList({QString("evidence_*.") + suffix}, QDir::Files, QDir::Name);
+    return names.isEmpty() ? QString() : QDir(directory).filePath(names.first());
+}
+
+static qint64 fileSize(const QString& path) {
+    return QFileInfo(path).size();
+}
+
+static bool truncateBy(const QString& path, qint64 bytes) {
+    QFile file(path);
+    return file.open(QIODevice::ReadWrite) && file.resize(file.size() - bytes);
+}
+
+static bool writeInitialStore(const QString& directory) {
+    EvidenceStore store(directory);
+    return store.open() && appendRecords(store, 0, RECORD_COUNT);
+}
+
+// The last record was cut short: it is dropped, the file is cut back to the record
+// before it, and appends continue from there.
+static void testTornDataTail() {
+    QTemporaryDir dir;
+    check(writeInitialStore(dir.path()), "torn data: write");
+    const QString data = segmentFile(dir.path(), "seg");
+    const qint64 dataSize = fileSize(data);
+    check(truncateBy(data, 10), "torn data: truncate");
+
+    checkContents(dir.path(), RECORD_COUNT - 1, "torn data: last record dropped");
+    const qint64 keptSize = dataSize - payloadFor(RECORD_COUNT - 1).size();
+    check(fileSize(data) > 0 && fileSize(data) < keptSize, "torn data: tail cut off", fileSize(data), keptSize);
+
+    {
+        EvidenceStore store(dir.path());
+        check(store.open() && appendRecords(store, RECORD_COUNT - 1, 1), "torn data: append after recovery");
+    }
+    checkContents(dir.path(), RECORD_COUNT, "torn data: reopened after append");
+}
+
+// The last index entry was cut short but its record is complete: it is rebuilt from the
+// self-describing record, and the index ends up as it was.
+static void testTornIndexTail() {
+    QTemporaryDir dir;
+    check(writeInitialStore(dir.path()), "torn index: write");
+    const QString index = segmentFile(dir.path(), "idx");
+    const qint64 indexSize = fileSize(index);
+    check(truncateBy(index, 3), "torn index: truncate");
+
+    checkContents(dir.path(), RECORD_COUNT, "torn index: record recovered from the data");
+    check(fileSize(index) == indexSize, "torn index: entry rewritten", fileSize(index), indexSize);
+    checkContents(dir.path(), RECORD_COUNT, "torn index: reopened");
+}
+
+// Bytes after the last record that are not a record, e.g. a partly written prefix.
+static void testTrailingGarbage() {
+    QTemporaryDir dir;
+    check(writeInitialStore(dir.path()), "garbage: write");
+    const QString data = segmentFile(dir.path(), "seg");
+    const qint64 dataSize = fileSize(data);
+    {
+        QFile file(data);
+        check(file.open(QIODevice::Append) && file.write("EVD1 not a record") > 0, "garbage: append");
+    }
+
+    checkContents(dir.path(), RECORD_COUNT, "garbage: records kept");
+    check(fileSize(data) == dataSize, "garbage: cut off", fileSize(data), dataSize);
+}
+
+int main()
+{
+    testTornDataTail();
+    testTornIndexTail();
+    testTrailingGarbage();
+    std::printf(failures == 0 ? "evidencetest: all checks passed\n" : "evidencetest: %d checks failed\n", failures);
+    return failures;
+}
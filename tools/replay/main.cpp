@@ -0,0 +1,459 @@
+#include "processingworker.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QThread>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <thread>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Feeds recorded videos through ProcessingWorker the way InferencePool does,
+// either as fast as possible or at a fixed frame rate per road, and reports
+// throughput, end-to-end latency, per-stage timings and peak memory.
+//
+//   replay --roads 4 --frames 600 -o yolov8n_i7.json road1.mp4 road2.mp4
+//
+// Backends are checked against each other by saving one run's detections and
+// comparing another run with them; the motion gate is best left off so both
+// runs detect on the same frames:
+//
+//   replay --no-motion-gate --frames 300 --detections opencv.json road1.mp4
+//   replay --no-motion-gate --frames 300 --backend onnxruntime --model yolov8n_int8.onnx --reference opencv.json road1.mp4
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsBetween(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+struct Distribution {
+    std::vector<double> samples;
+
+    void add(double value) { samples.push_back(value); }
+
+    // Nearest-rank percentile.
+    static double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    QJsonObject summary() const {
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double value : sorted) sum += value;
+        QJsonObject object;
+        object["count"] = static_cast<double>(sorted.size());
+        object["mean"] = sorted.empty() ? 0.0 : sum / sorted.size();
+        object["p50"] = percentile(sorted, 50);
+        object["p95"] = percentile(sorted, 95);
+        object["p99"] = percentile(sorted, 99);
+        object["max"] = sorted.empty() ? 0.0 : sorted.back();
+        return object;
+    }
+};
+
+static double peakRssMegabytes() {
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0.0;
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+}
+
+// Detector output per (road, frame).
+using DetectionLog = std::map<std::pair<int, int>, std::vector<VehicleDetection>>;
+
+static double intersectionOverUnion(const cv::Rect& a, const cv::Rect& b) {
+    const double intersection = (a & b).area();
+    const double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+static QJsonObject detectionLogToJson(const DetectionLog& log) {
+    QJsonArray frames;
+    for (const auto& entry : log) {
+        QJsonArray boxes;
+        for (const VehicleDetection& detection : entry.second) {
+            boxes.append(QJsonArray({detection.box.x, detection.box.y, detection.box.width, detection.box.height, static_cast<double>(detection.confidence)}));
+        }
+        QJsonObject frame;
+        frame["road"] = entry.first.first + 1;
+        frame["frame"] = entry.first.second;
+        frame["boxes"] = boxes;
+        frames.append(frame);
+    }
+    QJsonObject object;
+    object["frames"] = frames;
+    return object;
+}
+
+static bool readDetectionLog(const QString& path, DetectionLog& log) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    if (!document.isObject()) return false;
+    for (const QJsonValue& frameValue : document.object()["frames"].toArray()) {
+        const QJsonObject frame = frameValue.toObject();
+        std::vector<VehicleDetection>& detections = log[{frame["road"].toInt() - 1, frame["frame"].toInt()}];
+        for (const QJsonValue& boxValue : frame["boxes"].toArray()) {
+            const QJsonArray box = boxValue.toArray();
+            VehicleDetection detection;
+            detection.box = cv::Rect(box[0].toInt(), box[1].toInt(), box[2].toInt(), box[3].toInt());
+            detection.confidence = static_cast<float>(box[4].toDouble());
+            detections.push_back(detection);
+        }
+    }
+    return true;
+}
+
+// Greedy one-to-one matching per frame, strongest reference boxes first. Frames
+// only one of the runs detected on count as a mismatch.
+static QJsonObject compareDetections(const DetectionLog& reference, const DetectionLog& actual, double minIou, double maxConfidenceDelta) {
+    long long frames = 0, oneSidedFrames = 0, referenceBoxes = 0, actualBoxes = 0, matched = 0;
+    double worstIou = 1.0, worstConfidenceDelta = 0.0;
+    for (const auto& entry : reference) {
+        const auto found = actual.find(entry.first);
+        if (found == actual.end()) {
+            ++oneSidedFrames;
+            continue;
+        }
+        ++frames;
+        std::vector<VehicleDetection> expected = entry.second;
+        std::sort(expected.begin(), expected.end(), [](const VehicleDetection& a, const VehicleDetection& b) { return a.confidence > b.confidence; });
+        std::vector<bool> taken(found->second.size(), false);
+        referenceBoxes += static_cast<long long>(expected.size());
+        actualBoxes += static_cast<long long>(found->second.size());
+        for (const VehicleDetection& detection : expected) {
+            int best = -1;
+            double bestIou = 0.0;
+            for (size_t i = 0; i < found->second.size(); ++i) {
+                const double iou = intersectionOverUnion(detection.box, found->second[i].box);
+                if (!taken[i] && iou > bestIou) {
+                    best = static_cast<int>(i);
+                    bestIou = iou;
+                }
+            }
+            if (best < 0 || bestIou < minIou) continue;
+            taken[best] = true;
+            ++matched;
+            worstIou = std::min(worstIou, bestIou);
+            worstConfidenceDelta = std::max(worstConfidenceDelta, static_cast<double>(std::abs(detection.confidence - found->second[best].confidence)));
+        }
+    }
+    for (const auto& entry : actual) {
+        if (reference.find(entry.first) == reference.end()) ++oneSidedFrames;
+    }
+
+    QJsonObject comparison;
+    comparison["frames"] = static_cast<double>(frames);
+    comparison["oneSidedFrames"] = static_cast<double>(oneSidedFrames);
+    comparison["referenceBoxes"] = static_cast<double>(referenceBoxes);
+    comparison["boxes"] = static_cast<double>(actualBoxes);
+    comparison["matchedBoxes"] = static_cast<double>(matched);
+    comparison["worstIou"] = matched > 0 ? worstIou : 0.0;
+    comparison["worstConfidenceDelta"] = worstConfidenceDelta;
+    comparison["iouTolerance"] = minIou;
+    comparison["confidenceTolerance"] = maxConfidenceDelta;
+    comparison["identical"] = oneSidedFrames == 0 && matched == referenceBoxes && matched == actualBoxes
+                              && worstConfidenceDelta <= maxConfidenceDelta;
+    return comparison;
+}
+
+static QString fileSha1(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QString();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays recorded videos through the detection pipeline and reports its performance.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("videos", "Video files; roads take them in turn.", "video...");
+    QCommandLineOption roadsOption("roads", "Number of roads (default: one per video).", "n");
+    QCommandLineOption framesOption("frames", "Frames per road, 0 for the whole video (default 0).", "n", "0");
+    QCommandLineOption fpsOption("fps", "Frames per second per road, 0 for as fast as possible (default 0).", "rate", "0");
+    QCommandLineOption warmupOption("warmup", "Frames per road excluded from the results (default 10).", "n", "10");
+    QCommandLineOption intervalOption("detector-interval", "Run YOLO on every Nth frame, tracker in between (default 1).", "n", "1");
+    QCommandLineOption batchOption("batch", "Process all roads of a tick in one batch, as the pool does.");
+    QCommandLineOption loopOption("loop", "Rewind videos that end before --frames is reached.");
+    QCommandLineOption noPreviewOption("no-preview", "Skip rendering the 640x360 preview.");
+    QCommandLineOption noGateOption("no-motion-gate", "Run the detector on every detector frame, even on a static scene.");
+    QCommandLineOption backendOption("backend", "Inference backend: opencv, onnxruntime or openvino (default opencv).", "name", "opencv");
+    QCommandLineOption threadsOption("threads", "Inference threads (default: the backend's choice).", "n", "0");
+    QCommandLineOption inputSizesOption("input-sizes", "Network input sizes, e.g. 320,416,640 (default); the largest is the model's own.", "sizes");
+    QCommandLineOption maxTilesOption("max-tiles", "Most tiles per large region, 1 to never tile (default 6).", "n");
+    QCommandLineOption modelOption("model", "YOLO ONNX model (default yolov8n.onnx).", "path", "yolov8n.onnx");
+    QCommandLineOption classesOption("classes", "Class names file (default coco.names).", "path", "coco.names");
+    QCommandLineOption labelOption("label", "Free text stored with the results.", "text");
+    QCommandLineOption outputOption({"o", "output"}, "Write the results as JSON to <file>.", "file");
+    QCommandLineOption detectionsOption("detections", "Write every frame's detections as JSON to <file>.", "file");
+    QCommandLineOption referenceOption("reference", "Compare the detections with a --detections file; exit code 2 if they differ.", "file");
+    QCommandLineOption iouOption("iou-tolerance", "Minimum IoU of matching boxes (default 0.9).", "iou", "0.9");
+    QCommandLineOption confidenceOption("confidence-tolerance", "Largest confidence difference of matching boxes (default 0.05).", "delta", "0.05");
+    parser.addOptions({roadsOption, framesOption, fpsOption, warmupOption, intervalOption, batchOption, loopOption,
+                       noPreviewOption, noGateOption, backendOption, threadsOption, inputSizesOption, maxTilesOption, modelOption, classesOption, labelOption, outputOption,
+                       detectionsOption, referenceOption, iouOption, confidenceOption});
+    parser.process(app);
+
+    const QStringList videos = parser.positionalArguments();
+    if (videos.isEmpty()) parser.showHelp(1);
+    const int roadCount = parser.isSet(roadsOption) ? qMax(1, parser.value(roadsOption).toInt()) : videos.size();
+    const int maxFrames = qMax(0, parser.value(framesOption).toInt());
+    const double fps = qMax(0.0, parser.value(fpsOption).toDouble());
+    const int warmup = qMax(0, parser.value(warmupOption).toInt());
+    const int detectorInterval = qMax(1, parser.value(intervalOption).toInt());
+    const bool batch = parser.isSet(batchOption);
+    const bool preview = !parser.isSet(noPreviewOption);
+    const int threads = qMax(0, parser.value(threadsOption).toInt());
+    InferenceBackend::Type backendType;
+    if (!InferenceBackend::parseType(parser.value(backendOption), backendType)) {
+        std::fprintf(stderr, "Unknown backend %s\n", qPrintable(parser.value(backendOption)));
+        return 1;
+    }
+    const bool recordDetections = parser.isSet(detectionsOption) || parser.isSet(referenceOption);
+    DetectionLog reference;
+    if (parser.isSet(referenceOption) && !readDetectionLog(parser.value(referenceOption), reference)) {
+        std::fprintf(stderr, "Cannot read detections from %s\n", qPrintable(parser.value(referenceOption)));
+        return 1;
+    }
+
+    std::vector<cv::VideoCapture> captures(roadCount);
+    for (int r = 0; r < roadCount; ++r) {
+        const QString& video = videos[r % videos.size()];
+        if (!captures[r].open(video.toStdString())) {
+            std::fprintf(stderr, "Cannot open %s\n", qPrintable(video));
+            return 1;
+        }
+    }
+
+    // The worker resolves relative paths against its own directory; the harness uses the working directory.
+    const QString modelPath = QFileInfo(parser.value(modelOption)).absoluteFilePath();
+    const QString classesPath = QFileInfo(parser.value(classesOption)).absoluteFilePath();
+    ProcessingWorker worker;
+    QObject::connect(&worker, &ProcessingWorker::logMessage, [](const QString& message, const QString& level) {
+        std::fprintf(stderr, "[%s] %s\n", qPrintable(level), qPrintable(message));
+    });
+    worker.setInferenceBackend(backendType, threads);
+    TilingOptions tiling;
+    if (parser.isSet(inputSizesOption)) {
+        tiling.inputSizes.clear();
+        for (const QString& size : parser.value(inputSizesOption).split(',')) tiling.inputSizes.push_back(size.toInt());
+    }
+    if (parser.isSet(maxTilesOption)) tiling.maxTiles = parser.value(maxTilesOption).toInt();
+    worker.setTilingOptions(tiling);
+    if (!worker.initializeModels(modelPath, classesPath)) return 1;
+    worker.setMotionGateEnabled(!parser.isSet(noGateOption));
+
+    // The worker runs on this thread, so processingFinished arrives inside processBatch().
+    std::vector<Clock::time_point> arrivals(roadCount);
+    bool measuring = false;
+    Distribution latency;
+    QObject::connect(&worker, &ProcessingWorker::processingFinished, [&](int roadIndex, const QImage&, int, const std::vector<int>&) {
+        if (measuring) latency.add(millisecondsBetween(arrivals[roadIndex], Clock::now()));
+    });
+
+    const char* stageNames[] = {"capture", "motionGate", "preprocess", "inference", "decode", "tracking", "render"};
+    Distribution stages[7];
+    auto addStages = [&](const ProcessingWorker::StageTimings& timings) {
+        stages[1].add(timings.motionGateMs);
+        stages[2].add(timings.preprocessMs);
+        stages[3].add(timings.inferenceMs);
+        stages[4].add(timings.decodeMs);
+        stages[5].add(timings.trackingMs);
+        stages[6].add(timings.renderMs);
+    };
+
+    DetectionLog detectionLog;
+    auto collectDetections = [&](int tick) {
+        if (!recordDetections) return;
+        for (const auto& entry : worker.getLastDetections()) detectionLog[{entry.first, tick}] = entry.second;
+    };
+
+    long long measuredFrames = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point measureStart = start;
+    std::vector<FrameJob> jobs;
+    bool finished = false;
+    for (int tick = 0; !finished && (maxFrames == 0 || tick < maxFrames + warmup); ++tick) {
+        if (tick == warmup) {
+            measuring = true;
+            measureStart = Clock::now();
+        }
+        // At a fixed rate a frame "arrives" on schedule; time spent waiting for a busy pipeline counts as latency.
+        Clock::time_point scheduled = Clock::now();
+        if (fps > 0.0) {
+            scheduled = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tick / fps));
+            std::this_thread::sleep_until(scheduled);
+        }
+
+        jobs.clear();
+        for (int r = 0; r < roadCount; ++r) {
+            const Clock::time_point captureStart = Clock::now();
+            cv::Mat frame;
+            if (!captures[r].read(frame) && parser.isSet(loopOption)) {
+                captures[r].set(cv::CAP_PROP_POS_FRAMES, 0);
+                captures[r].read(frame);
+            }
+            if (frame.empty()) {
+                finished = true;
+                break;
+            }
+            if (measuring) stages[0].add(millisecondsBetween(captureStart, Clock::now()));
+            arrivals[r] = fps > 0.0 ? scheduled : Clock::now();
+
+            FrameJob job;
+            job.roadIndex = r;
+            job.frame = std::make_shared<const cv::Mat>(frame);
+            job.currentLight = TrafficLight::RED; // keeps the violation checks in the measured path
+            job.runDetector = tick % detectorInterval == 0;
+            job.refineTracks = detectorInterval > 1;
+            job.renderDisplay = preview;
+            job.displaySize = cv::Size(640, 360);
+            jobs.push_back(job);
+        }
+        if (finished) break;
+
+        if (batch) {
+            worker.processBatch(jobs);
+            if (measuring) addStages(worker.getLastStageTimings());
+            collectDetections(tick);
+        } else {
+            for (const FrameJob& job : jobs) {
+                worker.processBatch({job});
+                if (measuring) addStages(worker.getLastStageTimings());
+                collectDetections(tick);
+            }
+        }
+        if (measuring) measuredFrames += static_cast<long long>(jobs.size());
+    }
+    const double wallSeconds = measuring ? millisecondsBetween(measureStart, Clock::now()) / 1000.0 : 0.0;
+
+    if (measuredFrames == 0) {
+        std::fprintf(stderr, "No frames measured; the videos are shorter than the warm-up.\n");
+        return 1;
+    }
+
+    QJsonObject stageObject;
+    for (int s = 0; s < 7; ++s) stageObject[stageNames[s]] = stages[s].summary();
+
+    QJsonObject results;
+    results["frames"] = static_cast<double>(measuredFrames);
+    results["wallSeconds"] = wallSeconds;
+    results["fps"] = measuredFrames / wallSeconds;
+    results["latencyMs"] = latency.summary();
+    results["stagesMs"] = stageObject; // per road for capture, per processBatch() call otherwise
+    results["peakRssMb"] = peakRssMegabytes();
+
+    QJsonObject config;
+    config["videos"] = QJsonArray::fromStringList(videos);
+    config["roads"] = roadCount;
+    config["framesPerRoad"] = maxFrames;
+    config["fps"] = fps;
+    config["warmup"] = warmup;
+    config["detectorInterval"] = detectorInterval;
+    config["batch"] = batch;
+    config["preview"] = preview;
+    config["motionGate"] = !parser.isSet(noGateOption);
+    config["backend"] = InferenceBackend::typeName(backendType);
+    config["backendDescription"] = worker.describeInferenceBackend();
+    config["inferenceThreads"] = threads;
+    QJsonArray inputSizes;
+    for (int size : tiling.inputSizes) inputSizes.append(size);
+    config["inputSizes"] = inputSizes;
+    config["maxTiles"] = tiling.maxTiles;
+    config["openCvThreads"] = cv::getNumThreads();
+
+    QJsonObject model;
+    model["path"] = modelPath;
+    model["sha1"] = fileSha1(modelPath);
+
+    QJsonObject machine;
+    machine["host"] = QSysInfo::machineHostName();
+    machine["os"] = QSysInfo::prettyProductName();
+    machine["cpuArchitecture"] = QSysInfo::currentCpuArchitecture();
+    machine["logicalCores"] = QThread::idealThreadCount();
+    machine["openCv"] = QString(CV_VERSION);
+
+    QJsonObject report;
+    report["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    report["label"] = parser.value(labelOption);
+    report["machine"] = machine;
+    report["model"] = model;
+    report["config"] = config;
+    report["results"] = results;
+
+    QJsonObject comparison;
+    if (parser.isSet(referenceOption)) {
+        comparison = compareDetections(reference, detectionLog, parser.value(iouOption).toDouble(), parser.value(confidenceOption).toDouble());
+        comparison["reference"] = parser.value(referenceOption);
+        report["comparison"] = comparison;
+    }
+
+    const QJsonObject latencyObject = latency.summary();
+    std::printf("%lld frames in %.2f s: %.1f fps\n", measuredFrames, wallSeconds, measuredFrames / wallSeconds);
+    std::printf("latency ms: p50 %.2f  p95 %.2f  p99 %.2f  max %.2f\n", latencyObject["p50"].toDouble(),
+                latencyObject["p95"].toDouble(), latencyObject["p99"].toDouble(), latencyObject["max"].toDouble());
+    for (int s = 0; s < 7; ++s) {
+        const QJsonObject stage = stageObject[stageNames[s]].toObject();
+        std::printf("  %-11s mean %8.3f  p95 %8.3f ms\n", stageNames[s], stage["mean"].toDouble(), stage["p95"].toDouble());
+    }
+    std::printf("peak RSS: %.1f MB\n", results["peakRssMb"].toDouble());
+    if (!comparison.isEmpty()) {
+        std::printf("detections vs reference: %s, %.0f of %.0f boxes matched (%.0f produced), worst IoU %.3f, worst confidence delta %.3f, %.0f one-sided frames\n",
+                    comparison["identical"].toBool() ? "identical" : "DIFFERENT",
+                    comparison["matchedBoxes"].toDouble(), comparison["referenceBoxes"].toDouble(), comparison["boxes"].toDouble(),
+                    comparison["worstIou"].toDouble(), comparison["worstConfidenceDelta"].toDouble(), comparison["oneSidedFrames"].toDouble());
+    }
+
+    if (parser.isSet(outputOption)) {
+        QFile out(parser.value(outputOption));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(QJsonDocument(report).toJson()) < 0) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(parser.value(outputOption)));
+            return 1;
+        }
+    }
+    if (parser.isSet(detectionsOption)) {
+        QJsonObject detections = detectionLogToJson(detectionLog);
+        detections["backend"] = InferenceBackend::typeName(backendType);
+        detections["model"] = model;
+        QFile out(parser.value(detectionsOption));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(QJsonDocument(detections).toJson(QJsonDocument::Compact)) < 0) {
+            std::fprintf(stderr, "Cannot write %s\n", qPrintable(parser.value(detectionsOption)));
+            return 1;
+        }
+    }
+    return !comparison.isEmpty() && !comparison["identical"].toBool() ? 2 : 0;
+}
@@ -0,0 +1,15 @@
+# Offline replay benchmark: recorded videos through ProcessingWorker, results as JSON
+QT -= widgets
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = replay
+TEMPLATE = app
+
+# Detection pipeline, OpenCV and the inference backends, as built into the controller
+include(../../stmspipeline.pri)
+
+win32: LIBS += -lpsapi
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,125 @@
+#include "signalcontroller.h"
+#include <cstdio>
+
+// Drives SignalController with a ManualClock, so a whole cycle runs in no time.
+// Prints each failed check and exits with the number of failures.
+
+static int failures = 0;
+
+static void check(bool condition, const char* what, qint64 actual = 0, qint64 expected = 0) {
+    if (condition) return;
+    std::printf("FAIL: %s (got %lld, expected %lld)\n", what, static_cast<long long>(actual), static_cast<long long>(expected));
+    ++failures;
+}
+
+static void checkPhase(const SignalController& controller, SignalController::Phase phase, int approach,
+                       qint64 startMs, qint64 endMs, const char* what) {
+    check(controller.getPhase() == phase, what, static_cast<int>(controller.getPhase()), static_cast<int>(phase));
+    check(controller.getServedApproach() == approach, what, controller.getServedApproach(), approach);
+    check(controller.nextDeadlineMs() == endMs, what, controller.nextDeadlineMs(), endMs);
+    check(controller.getPhaseDuration() == endMs - startMs, what, controller.getPhaseDuration(), endMs - startMs);
+}
+
+// AllRed -> Green(0) -> Yellow(0) -> AllRed -> Green(1) -> ..., each phase starting at the
+// previous deadline, with the lights each phase shows.
+static void testSequence() {
+    ManualClock clock;
+    SignalController controller(2, &clock);
+    controller.setGreenDurationSource([](int approach) { return approach == 0 ? qint64(5000) : qint64(7000); });
+    controller.setYellowDuration(3000);
+    controller.setAllRedDuration(1000);
+
+    controller.start(0);
+    checkPhase(controller, SignalController::Phase::AllRed, 0, 0, 1000, "start: all-red");
+    check(controller.getLight(0) == TrafficLight::RED && controller.getLight(1) == TrafficLight::RED, "start: both red");
+    qint64 untilNext = controller.update();
+    check(untilNext == 1000, "start: time to the all-red deadline", untilNext, 1000);
+
+    clock.setMs(999);
+    controller.update();
+    check(controller.getPhase() == SignalController::Phase::AllRed, "no transition before the deadline");
+
+    clock.setMs(1000);
+    untilNext = controller.update();
+    check(untilNext == 5000, "green 0: time to the deadline", untilNext, 5000);
+    checkPhase(controller, SignalController::Phase::Green, 0, 1000, 6000, "green 0");
+    check(controller.getLight(0) == TrafficLight::GREEN && controller.getLight(1) == TrafficLight::RED, "green 0: lights");
+
+    clock.setMs(6000);
+    controller.update();
+    checkPhase(controller, SignalController::Phase::Yellow, 0, 6000, 9000, "yellow 0");
+    check(controller.getLight(0) == TrafficLight::YELLOW && controller.getLight(1) == TrafficLight::RED, "yellow 0: lights");
+
+    clock.setMs(9000);
+    controller.update();
+    checkPhase(controller, SignalController::Phase::AllRed, 1, 9000, 10000, "all-red before 1");
+    check(controller.getLight(0) == TrafficLight::RED && controller.getLight(1) == TrafficLight::RED, "all-red: lights");
+
+    clock.setMs(10000);
+    controller.update();
+    checkPhase(controller, SignalController::Phase::Green, 1, 10000, 17000, "green 1");
+    check(controller.getLight(0) == TrafficLight::RED && controller.getLight(1) == TrafficLight::GREEN, "green 1: lights");
+
+    // Yellow and all-red, each on the previous deadline.
+    for (int k = 0; k < 3; ++k) {
+        clock.setMs(controller.nextDeadlineMs());
+        controller.update();
+    }
+    checkPhase(controller, SignalController::Phase::Green, 0, 21000, 26000, "wraps to approach 0");
+
+    controller.stop(TrafficLight::YELLOW);
+    check(!controller.isRunning() && controller.update() == -1, "stop: not running");
+    check(controller.getLight(0) == TrafficLight::YELLOW && controller.getLight(1) == TrafficLight::YELLOW, "stop: lights");
+}
+
+// A late update within MAX_CATCH_UP_MS keeps the schedule; a later one starts the next phase
+// from now, so it is never cut short, and makes only that one transition.
+static void testCatchUp() {
+    ManualClock clock;
+    SignalController controller(2, &clock);
+    controller.setGreenDurationSource([](int) { return qint64(5000); });
+    controller.setYellowDuration(3000);
+    controller.setAllRedDuration(1000);
+    controller.start(0);
+
+    clock.setMs(1000 + SignalController::MAX_CATCH_UP_MS);
+    controller.update();
+    checkPhase(controller, SignalController::Phase::Green, 0, 1000, 6000, "late by the limit: on schedule");
+
+    clock.setMs(6000 + SignalController::MAX_CATCH_UP_MS + 1);
+    controller.update();
+    const qint64 now = clock.nowMs();
+    checkPhase(controller, SignalController::Phase::Yellow, 0, now, now + 3000, "later: yellow starts now");
+
+    // Far behind, e.g. after a stalled event loop: one all-red from now, not a burst of phases.
+    clock.setMs(now + 60000);
+    controller.update();
+    checkPhase(controller, SignalController::Phase::AllRed, 1, now + 60000, now + 61000, "stalled: one transition");
+}
+
+// Green lasts at least a second whatever the source says; no all-red goes straight to green.
+static void testMinimumGreen() {
+    ManualClock clock;
+    SignalController controller(3, &clock);
+    controller.setGreenDurationSource([](int approach) { return approach == 0 ? qint64(0) : qint64(-5000); });
+    controller.setYellowDuration(2000);
+    controller.setAllRedDuration(0);
+
+    controller.start(0);
+    checkPhase(controller, SignalController::Phase::Green, 0, 0, 1000, "zero green: one second");
+
+    clock.setMs(1000);
+    controller.update();
+    clock.setMs(3000);
+    controller.update();
+    checkPhase(controller, SignalController::Phase::Green, 1, 3000, 4000, "negative green: one second");
+}
+
+int main()
+{
+    testSequence();
+    testCatchUp();
+    testMinimumGreen();
+    std::printf(failures == 0 ? "signaltest: all checks passed\n" : "signaltest: %d checks failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,18 @@
+# SignalController checks on a ManualClock: phase order, deadlines, catch-up and minimum green
+QT += core
+QT -= gui widgets
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = signaltest
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../signalcontroller.cpp
+
+HEADERS += \
+    ../../signalcontroller.h \
+    ../../traffic_types.h
@@ -0,0 +1,148 @@
+#include "vehicletracker.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// Synthetic stop-and-go jam: ten lanes of equally spaced vehicles across a 1080p
+// frame, each lane moving at its own varying speed, seen by a detector that
+// jitters the boxes, misses some vehicles and is unsure of others. Reports the
+// tracker's time per frame and how well it keeps identities as the jam grows.
+//
+//   trackbench [frames]
+
+static const int FRAME_WIDTH = 1920;
+static const int LANE_COUNT = 10;
+static const int LANE_PITCH = 100;
+static const float VEHICLE_HEIGHT = 70.0f;
+static const double MISS_RATE = 0.05;
+static const double LOW_CONFIDENCE_RATE = 0.15;
+// A vehicle is covered by the track overlapping it at least this much.
+static const float COVER_MIN_IOU = 0.5f;
+// Pass criteria at every jam size.
+static const double MAX_SWITCH_RATE = 0.02;
+static const double MIN_COVERAGE = 0.90;
+
+struct Vehicle {
+    int lane = 0;
+    float x = 0.0f;
+    float width = 0.0f;
+    int trackId = -1; // track that covered it last, -1 after entering the frame
+};
+
+struct RunResult {
+    double meanMs = 0.0;
+    double maxMs = 0.0;
+    int tracks = 0;
+    long long switches = 0;
+    long long covered = 0;
+    long long vehicleFrames = 0;
+};
+
+static float iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+    const float overlap = (a & b).area();
+    return overlap > 0.0f ? overlap / (a.area() + b.area() - overlap) : 0.0f;
+}
+
+static cv::Rect2f truthBox(const Vehicle& vehicle) {
+    return cv::Rect2f(vehicle.x, 30.0f + vehicle.lane * LANE_PITCH, vehicle.width, VEHICLE_HEIGHT);
+}
+
+static RunResult run(int vehicleCount, int frames, int detectorInterval, uint64_t seed) {
+    cv::RNG rng(seed);
+    const int perLane = (vehicleCount + LANE_COUNT - 1) / LANE_COUNT;
+    const float pitch = static_cast<float>(FRAME_WIDTH) / perLane;
+    const float loop = pitch * perLane;
+
+    std::vector<Vehicle> vehicles(vehicleCount);
+    for (int v = 0; v < vehicleCount; ++v) {
+        vehicles[v].lane = v % LANE_COUNT;
+        vehicles[v].x = (v / LANE_COUNT) * pitch;
+        vehicles[v].width = std::min(110.0f, 0.75f * pitch);
+    }
+
+    VehicleTracker tracker;
+    std::vector<VehicleDetection> detections;
+    RunResult result;
+    double totalMs = 0.0;
+
+    for (int frame = 0; frame < frames; ++frame) {
+        for (Vehicle& vehicle : vehicles) {
+            const float speed = std::max(0.0f, 2.5f * std::sin(frame * 0.05f + vehicle.lane));
+            vehicle.x += speed;
+            if (vehicle.x >= loop) {
+                // Leaves on the right, a new vehicle enters on the left.
+                vehicle.x -= loop;
+                vehicle.trackId = -1;
+            }
+        }
+
+        const bool detectorFrame = frame % detectorInterval == 0;
+        if (detectorFrame) {
+            detections.clear();
+            for (const Vehicle& vehicle : vehicles) {
+                if (rng.uniform(0.0, 1.0) < MISS_RATE) continue;
+                const cv::Rect2f truth = truthBox(vehicle);
+                VehicleDetection detection;
+                detection.box = cv::Rect(cvRound(truth.x + rng.gaussian(1.5)), cvRound(truth.y + rng.gaussian(1.5)),
+                                         cvRound(truth.width + rng.gaussian(1.5)), cvRound(truth.height + rng.gaussian(1.5)));
+                detection.confidence = rng.uniform(0.0, 1.0) < LOW_CONFIDENCE_RATE ? rng.uniform(0.15f, 0.44f) : rng.uniform(0.5f, 0.95f);
+                detections.push_back(detection);
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (detectorFrame) tracker.update(detections, TrafficLight::RED);
+        else tracker.advance(TrafficLight::RED);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        totalMs += ms;
+        result.maxMs = std::max(result.maxMs, ms);
+
+        // Identity bookkeeping, outside the timed part.
+        for (Vehicle& vehicle : vehicles) {
+            const cv::Rect2f truth = truthBox(vehicle);
+            int bestId = -1;
+            float bestIoU = COVER_MIN_IOU;
+            for (int t = 0; t < tracker.size(); ++t) {
+                const float overlap = iou(truth, cv::Rect2f(tracker.getBox(t)));
+                if (overlap >= bestIoU) {
+                    bestIoU = overlap;
+                    bestId = tracker.getId(t);
+                }
+            }
+            result.vehicleFrames++;
+            if (bestId < 0) continue;
+            result.covered++;
+            if (vehicle.trackId >= 0 && vehicle.trackId != bestId) result.switches++;
+            vehicle.trackId = bestId;
+        }
+    }
+
+    result.meanMs = totalMs / frames;
+    result.tracks = tracker.size();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    const int frames = argc > 1 ? std::max(10, std::atoi(argv[1])) : 600;
+    const int vehicleCounts[] = {25, 50, 100, 200};
+    const int detectorIntervals[] = {1, 3};
+    bool passed = true;
+
+    std::printf("vehicles  interval  mean ms  max ms  us/vehicle  tracks  coverage  id switches\n");
+    for (int interval : detectorIntervals) {
+        for (int count : vehicleCounts) {
+            const RunResult result = run(count, frames, interval, 42);
+            const double coverage = static_cast<double>(result.covered) / result.vehicleFrames;
+            const double switchRate = static_cast<double>(result.switches) / result.vehicleFrames;
+            const bool ok = coverage >= MIN_COVERAGE && switchRate <= MAX_SWITCH_RATE;
+            passed = passed && ok;
+            std::printf("%8d  %8d  %7.3f  %6.3f  %10.2f  %6d  %7.1f%%  %11lld%s\n", count, interval, result.meanMs, result.maxMs,
+                        1000.0 * result.meanMs / count, result.tracks, 100.0 * coverage, result.switches, ok ? "" : "  FAIL");
+        }
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+# Dense-scene benchmark: VehicleTracker on synthetic jams of 25 to 200 vehicles per road
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+TARGET = trackbench
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+# OpenCV 4.11.0 Configuration (same layout as the main project)
+win32 {
+    INCLUDEPATH += "C:/opencv/build/include"
+    CONFIG(release, debug|release): LIBS += -L"C:/opencv/build/x64/vc16/lib" -lopencv_world4110
+    CONFIG(debug, debug|release): LIBS += -L"C:/opencv/build/x64/vc16/lib" -lopencv_world4110d
+}
+unix {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv4
+}
+
+SOURCES += \
+    main.cpp \
+    ../../vehicletracker.cpp
+
+HEADERS += \
+    ../../traffic_types.h \
+    ../../vehicletracker.h
@@ -5,4 +5,8 @@
 enum class TrafficLight { OFF = 0, RED = 1, YELLOW = 2, GREEN = 3 };
 enum class TrafficDensity { OFF = 0, LOW = 1, MEDIUM = 2, HIGH = 3, VERY_HIGH = 4 };
 
+inline TrafficDensity densityFromVehicleCount(int count) {
+    return (count < 3) ? TrafficDensity::OFF : (count <= 4) ? TrafficDensity::LOW : (count <= 6) ? TrafficDensity::MEDIUM : (count <= 9) ? TrafficDensity::HIGH : TrafficDensity::VERY_HIGH;
+}
+
 #endif // TRAFFIC_TYPES_H
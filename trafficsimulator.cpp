@@ -0,0 +1,209 @@
+#include "trafficsimulator.h"
+#include "signalcontroller.h"
+#include <QStringList>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+static const qint64 MS_PER_HOUR = 3600000;
+
+double DemandProfile::rateAt(qint64 timeMs) const {
+    if (vehiclesPerHour.empty()) return 0.0;
+    const qint64 hour = (timeMs / MS_PER_HOUR) % static_cast<qint64>(vehiclesPerHour.size());
+    return qMax(0.0, vehiclesPerHour[static_cast<size_t>(hour)]);
+}
+
+DemandProfile DemandProfile::parse(const QString& text) {
+    DemandProfile profile;
+    for (const QString& value : text.split(',')) {
+        bool ok = false;
+        const double rate = value.trimmed().toDouble(&ok);
+        if (ok) profile.vehiclesPerHour.push_back(rate);
+    }
+    return profile;
+}
+
+double SimulationReport::averageDelaySeconds(int approach) const {
+    double delayMs = 0.0;
+    quint64 vehicles = 0;
+    for (int a = 0; a < static_cast<int>(approaches.size()); ++a) {
+        if (approach >= 0 && a != approach) continue;
+        delayMs += approaches[a].totalDelayMs;
+        vehicles += approaches[a].departures + approaches[a].leftInQueue;
+    }
+    return vehicles > 0 ? delayMs / vehicles / 1000.0 : 0.0;
+}
+
+double SimulationReport::averageQueue(int approach) const {
+    if (durationMs <= 0) return 0.0;
+    double integral = 0.0;
+    for (int a = 0; a < static_cast<int>(approaches.size()); ++a) {
+        if (approach < 0 || a == approach) integral += approaches[a].queueIntegral;
+    }
+    return integral / durationMs;
+}
+
+double SimulationReport::throughputPerHour(int approach) const {
+    if (durationMs <= 0) return 0.0;
+    quint64 departures = 0;
+    for (int a = 0; a < static_cast<int>(approaches.size()); ++a) {
+        if (approach < 0 || a == approach) departures += approaches[a].departures;
+    }
+    return static_cast<double>(departures) * MS_PER_HOUR / durationMs;
+}
+
+int SimulationReport::maxQueue() const {
+    int longest = 0;
+    for (const Approach& approach : approaches) longest = qMax(longest, approach.maxQueue);
+    return longest;
+}
+
+TrafficSimulator::TrafficSimulator(int approachCount, quint32 seed)
+    : queues(qMax(1, approachCount)),
+    stats(queues.size()),
+    random(seed),
+    seed(seed)
+{
+}
+
+void TrafficSimulator::setDemand(int approach, const DemandProfile& demand) {
+    if (isValidApproach(approach)) queues[approach].demand = demand;
+}
+
+void TrafficSimulator::clearApproach(int approach) {
+    if (!isValidApproach(approach)) return;
+    queues[approach].arrivalsMs.clear();
+    queues[approach].discharging = false;
+    queues[approach].nextDischargeMs = 0;
+}
+
+void TrafficSimulator::reset(quint32 seed, qint64 startMs) {
+    this->seed = seed;
+    random.seed(seed);
+    this->startMs = nowMs = qMax<qint64>(0, startMs);
+    for (ApproachState& queue : queues) {
+        queue.arrivalsMs.clear();
+        queue.discharging = false;
+        queue.nextDischargeMs = 0;
+    }
+    stats.assign(queues.size(), SimulationReport::Approach());
+}
+
+void TrafficSimulator::step(qint64 dtMs, const std::vector<TrafficLight>& lights) {
+    if (dtMs <= 0) return;
+    nowMs += dtMs;
+    for (int a = 0; a < getApproachCount(); ++a) {
+        ApproachState& queue = queues[a];
+        SimulationReport::Approach& stat = stats[a];
+
+        // Arrivals during the step, spread evenly over it.
+        const double expected = queue.demand.rateAt(nowMs) * dtMs / MS_PER_HOUR;
+        if (expected > 0.0) {
+            const int arrivals = std::poisson_distribution<int>(expected)(random);
+            for (int k = 0; k < arrivals; ++k) queue.arrivalsMs.push_back(nowMs - dtMs + (k + 1) * dtMs / (arrivals + 1));
+            stat.arrivals += arrivals;
+        }
+
+        const TrafficLight light = a < static_cast<int>(lights.size()) ? lights[a] : TrafficLight::RED;
+        const bool discharging = light == TrafficLight::GREEN || light == TrafficLight::YELLOW;
+        if (discharging && !queue.discharging) queue.nextDischargeMs = nowMs - dtMs + startupLossMs;
+        queue.discharging = discharging;
+        if (discharging) {
+            while (!queue.arrivalsMs.empty() && queue.nextDischargeMs <= nowMs) {
+                const qint64 departureMs = qMax(queue.nextDischargeMs, queue.arrivalsMs.front());
+                stat.totalDelayMs += departureMs - queue.arrivalsMs.front();
+                stat.departures++;
+                queue.arrivalsMs.pop_front();
+                queue.nextDischargeMs = departureMs + headwayMs;
+            }
+            // An empty queue banks no capacity for later arrivals.
+            if (queue.arrivalsMs.empty()) queue.nextDischargeMs = qMax(queue.nextDischargeMs, nowMs);
+        }
+
+        const int length = static_cast<int>(queue.arrivalsMs.size());
+        stat.queueIntegral += static_cast<double>(length) * dtMs;
+        stat.maxQueue = qMax(stat.maxQueue, length);
+    }
+}
+
+int TrafficSimulator::getQueueLength(int approach) const {
+    return isValidApproach(approach) ? static_cast<int>(queues[approach].arrivalsMs.size()) : 0;
+}
+
+SimulationReport TrafficSimulator::getReport() const {
+    SimulationReport report;
+    report.durationMs = nowMs - startMs;
+    report.approaches = stats;
+    for (int a = 0; a < getApproachCount(); ++a) {
+        report.approaches[a].leftInQueue = queues[a].arrivalsMs.size();
+        for (qint64 arrivalMs : queues[a].arrivalsMs) report.approaches[a].totalDelayMs += nowMs - arrivalMs;
+    }
+    return report;
+}
+
+SimulationReport TrafficSimulator::run(const SimulationPolicy& policy, qint64 durationMs, qint64 startMs, qint64 stepMs) {
+    reset(seed, startMs);
+    stepMs = qMax<qint64>(10, stepMs);
+
+    ManualClock clock;
+    clock.setMs(nowMs);
+    SignalController controller(getApproachCount(), &clock);
+    controller.setYellowDuration(policy.yellowSeconds * 1000);
+    controller.setAllRedDuration(policy.allRedMs);
+    controller.setGreenDurationSource([this, &policy](int approach) {
+        return 1000 * static_cast<qint64>(policy.greenSeconds[static_cast<int>(densityFromVehicleCount(getQueueLength(approach)))]);
+    });
+
+    // The same rules as TrafficSystem::processEnergySaving(): dark while every approach is empty.
+    std::vector<TrafficLight> lights(getApproachCount(), TrafficLight::OFF);
+    qint64 darkMs = 0;
+    int servedApproach = 0;
+    while (nowMs - startMs < durationMs) {
+        bool anyWaiting = false;
+        for (int a = 0; a < getApproachCount() && !anyWaiting; ++a) anyWaiting = getQueueLength(a) > 0;
+        if (controller.isRunning() && policy.energySaving && !anyWaiting) {
+            servedApproach = controller.getServedApproach();
+            controller.stop(TrafficLight::OFF);
+        } else if (!controller.isRunning() && (anyWaiting || !policy.energySaving)) {
+            controller.start(servedApproach);
+        }
+        controller.update();
+
+        for (int a = 0; a < getApproachCount(); ++a) lights[a] = controller.getLight(a);
+        if (!controller.isRunning()) darkMs += stepMs;
+        step(stepMs, lights);
+        clock.setMs(nowMs);
+    }
+
+    SimulationReport report = getReport();
+    report.policy = policy.name;
+    report.darkMs = darkMs;
+    return report;
+}
+
+void TrafficSimulator::render(int approach, TrafficLight light, cv::Mat& bgra) const {
+    if (bgra.empty()) return;
+    bgra.setTo(cv::Scalar(60, 60, 60, 255));
+    const int laneTop = bgra.rows / 3, laneBottom = 2 * bgra.rows / 3;
+    cv::rectangle(bgra, cv::Rect(0, laneTop, bgra.cols, laneBottom - laneTop), cv::Scalar(90, 90, 90, 255), cv::FILLED);
+    const int stopLine = bgra.cols - bgra.cols / 8;
+    cv::line(bgra, cv::Point(stopLine, laneTop), cv::Point(stopLine, laneBottom), cv::Scalar(255, 255, 255, 255), 3);
+
+    const cv::Scalar lightColor = light == TrafficLight::GREEN ? cv::Scalar(0, 200, 0, 255)
+                                  : light == TrafficLight::YELLOW ? cv::Scalar(0, 200, 255, 255)
+                                  : light == TrafficLight::RED ? cv::Scalar(0, 0, 220, 255)
+                                  : cv::Scalar(40, 40, 40, 255);
+    const int radius = qMax(4, bgra.rows / 16);
+    cv::circle(bgra, cv::Point(stopLine + bgra.cols / 16, laneTop - radius - 4), radius, lightColor, cv::FILLED);
+
+    // Queued vehicles back from the stop line; the ones that don't fit are only counted.
+    const int queued = getQueueLength(approach);
+    const int carLength = qMax(8, bgra.cols / 20), gap = qMax(2, carLength / 4);
+    const int carHeight = (laneBottom - laneTop) / 2;
+    for (int k = 0; k < queued; ++k) {
+        const int right = stopLine - gap - k * (carLength + gap);
+        if (right - carLength < 0) break;
+        cv::rectangle(bgra, cv::Rect(right - carLength, laneTop + carHeight / 2, carLength, carHeight), cv::Scalar(200, 120, 40, 255), cv::FILLED);
+    }
+    cv::putText(bgra, QString("SIM  %1 queued").arg(queued).toStdString(), cv::Point(10, bgra.rows - 12),
+                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255, 255), 1);
+}
@@ -0,0 +1,108 @@
+#ifndef TRAFFICSIMULATOR_H
+#define TRAFFICSIMULATOR_H
+
+#include <QString>
+#include <opencv2/core.hpp>
+#include "traffic_types.h"
+#include <array>
+#include <deque>
+#include <random>
+#include <vector>
+
+// Arrival rate of one approach in vehicles per hour, for each hour of the day
+// in turn; a single value is a constant demand, an empty profile none.
+struct DemandProfile {
+    std::vector<double> vehiclesPerHour;
+
+    double rateAt(qint64 timeMs) const;
+    // "600" or "120, 80, 60, ..., 300" (one value per hour).
+    static DemandProfile parse(const QString& text);
+};
+
+// The controller settings a simulation runs, as TrafficSystem applies them.
+struct SimulationPolicy {
+    QString name = "default";
+    std::array<int, 5> greenSeconds{{5, 8, 12, 18, 25}}; // by TrafficDensity
+    int yellowSeconds = 3;
+    int allRedMs = 1000;
+    bool energySaving = true;
+};
+
+struct SimulationReport {
+    struct Approach {
+        quint64 arrivals = 0;
+        quint64 departures = 0;
+        quint64 leftInQueue = 0;    // still waiting at the end
+        double totalDelayMs = 0.0;  // includes the wait so far of those left in the queue
+        double queueIntegral = 0.0; // vehicle-milliseconds
+        int maxQueue = 0;
+    };
+
+    QString policy;
+    qint64 durationMs = 0;
+    qint64 darkMs = 0; // lights off for energy saving
+    std::vector<Approach> approaches;
+
+    double averageDelaySeconds(int approach = -1) const;
+    double averageQueue(int approach = -1) const;
+    double throughputPerHour(int approach = -1) const;
+    int maxQueue() const;
+};
+
+// Microscopic queue model of one signalised junction. Vehicles arrive at each
+// approach as a Poisson process following its demand profile and join a
+// queue; while the approach shows green or yellow the queue discharges one
+// vehicle per saturation headway after a start-up loss. A vehicle that meets
+// an empty queue on green passes without delay.
+//
+// step() advances the model under lights decided elsewhere, which is how
+// TrafficSystem runs simulated roads in place of cameras. run() drives it with
+// a SignalController on a ManualClock under a given policy, so a simulated day
+// takes well under a second.
+class TrafficSimulator
+{
+public:
+    explicit TrafficSimulator(int approachCount, quint32 seed = 1);
+
+    int getApproachCount() const { return static_cast<int>(queues.size()); }
+    void setDemand(int approach, const DemandProfile& demand);
+    // Drops the vehicles waiting at one approach, e.g. when its road stops being simulated.
+    void clearApproach(int approach);
+    void setSaturationHeadway(int milliseconds) { headwayMs = qMax(100, milliseconds); }
+    void setStartupLoss(int milliseconds) { startupLossMs = qMax(0, milliseconds); }
+
+    // Empties the queues and statistics and restarts the clock at startMs (time of day).
+    void reset(quint32 seed, qint64 startMs = 0);
+    void step(qint64 dtMs, const std::vector<TrafficLight>& lights);
+    int getQueueLength(int approach) const;
+    qint64 getTimeMs() const { return nowMs; }
+    SimulationReport getReport() const;
+
+    // Resets, then simulates durationMs from startMs under policy. Runs with the
+    // same seed see the same arrivals, so policies are compared on equal traffic.
+    SimulationReport run(const SimulationPolicy& policy, qint64 durationMs, qint64 startMs = 0, qint64 stepMs = 100);
+
+    // Top-down sketch of an approach: the stop line, its light and the queued vehicles. Draws into a BGRA image.
+    void render(int approach, TrafficLight light, cv::Mat& bgra) const;
+
+private:
+    struct ApproachState {
+        DemandProfile demand;
+        std::deque<qint64> arrivalsMs;
+        bool discharging = false;
+        qint64 nextDischargeMs = 0;
+    };
+
+    std::vector<ApproachState> queues;
+    std::vector<SimulationReport::Approach> stats;
+    std::mt19937 random;
+    quint32 seed;
+    qint64 startMs = 0;
+    qint64 nowMs = 0;
+    int headwayMs = 2000;
+    int startupLossMs = 2000;
+
+    bool isValidApproach(int approach) const { return approach >= 0 && approach < getApproachCount(); }
+};
+
+#endif // TRAFFICSIMULATOR_H
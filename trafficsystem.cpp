@@ -4,294 +4,508 @@
 #include <QDateTime>
 #include <QSerialPortInfo>
 #include <QThread>
+#include <QPointer>
+#include <climits>
 
 // Register custom types for signal-slot mechanism
 Q_DECLARE_METATYPE(cv::Mat);
 Q_DECLARE_METATYPE(cv::Rect);
 Q_DECLARE_METATYPE(TrafficLight);
+Q_DECLARE_METATYPE(FrameRef);
 
 TrafficSystem::TrafficSystem(QObject *parent)
     : QObject(parent),
     systemRunning(false),
-    processingThread(nullptr),
-    worker(nullptr),
-    m_workerBusy(false),
-    currentRoadIndex(0),
-    lightTimeRemaining(0),
-    yellowLightActive(false),
+    inferencePool(nullptr),
+    inferenceWorkerCount(qBound(1, QThread::idealThreadCount() / 4, 4)),
+    inferenceBackendType(InferenceBackend::Type::OpenCvDnn),
+    inferenceThreadsPerWorker(0),
+    batchInferenceEnabled(true),
+    yoloModelPath("yolov8n.onnx"),
+    classNamesPath("coco.names"),
+    previewEnabled(true),
+    trackRefinementEnabled(true),
+    motionGateEnabled(true),
     yellowLightFixedDuration(3), // 3s default yellow
-    energySavingMode(false),
+    allRedDurationMs(1000),
     energySavingEnabled(true),
     violationDetectionEnabled(true),
-    arduino(nullptr)
+    logger(nullptr),
+    metrics(nullptr),
+    metricsServer(nullptr),
+    evidenceStore(nullptr),
+    evidenceWriter(nullptr),
+    evidencePreMs(3000),
+    evidencePostMs(2000),
+    frameHistoryBudgetBytes(48ll * 1024 * 1024),
+    mainTimer(nullptr),
+    sensorTimer(nullptr)
 {
     qRegisterMetaType<cv::Mat>();
     qRegisterMetaType<cv::Rect>();
     qRegisterMetaType<TrafficLight>();
+    qRegisterMetaType<FrameRef>("FrameRef");
+
+    // A single four-way junction unless configured otherwise
+    setIntersectionLayout({4});
 
     // Default light durations
-    currentLights.fill(TrafficLight::OFF);
     lightDurations[static_cast<int>(TrafficDensity::OFF)] = 5;
     lightDurations[static_cast<int>(TrafficDensity::LOW)] = 8;
     lightDurations[static_cast<int>(TrafficDensity::MEDIUM)] = 12;
     lightDurations[static_cast<int>(TrafficDensity::HIGH)] = 18;
     lightDurations[static_cast<int>(TrafficDensity::VERY_HIGH)] = 25;
 
-    // Setup violation directory
+    // Setup log and violation directories
     QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
     if (dataPath.isEmpty()) dataPath = QDir::currentPath();
+    // Everything logged from here on, from any thread, goes through the logger.
+    logger = new Logger(QDir(dataPath).absoluteFilePath("stms_logs"), this);
+    logger->start(QThread::LowPriority);
+    connect(this, &TrafficSystem::logMessage, this, [this](const QString& message, const QString& level) {
+        logger->log(level, "system", message);
+    }, Qt::DirectConnection);
+
     violationDir = QDir(dataPath).absoluteFilePath("stms_violations");
     QDir().mkpath(violationDir);
+
+    evidenceStore = new EvidenceStore(QDir(violationDir).filePath("store"));
+    if (!evidenceStore->open()) {
+        emit logMessage("Could not open the evidence store in " + evidenceStore->getDirectory(), "ERROR");
+    }
+
+    // Violation images are encoded and written off this thread.
+    evidenceWriter = new EvidenceWriter(evidenceStore, this);
+    connect(evidenceWriter, &EvidenceWriter::evidenceFailed, this, [this](const QString& name) {
+        emit logMessage("Failed to save violation image: " + name, "ERROR");
+    }, Qt::QueuedConnection);
+    connect(evidenceWriter, &EvidenceWriter::evidenceDropped, this, [this](const QString& name) {
+        emit logMessage("Evidence queue full, dropped violation image: " + name, "WARNING");
+    }, Qt::QueuedConnection);
+    evidenceWriter->start(QThread::LowPriority);
+
+    QTimer* evidenceReportTimer = new QTimer(this);
+    connect(evidenceReportTimer, &QTimer::timeout, this, [this]() {
+        EvidenceWriter::Stats stats = evidenceWriter->takeStats();
+        if (stats.peakQueueDepth == 0 && stats.averageLatencyMs == 0.0) return;
+        emit logMessage(QString("Evidence writer: %1 written, %2 dropped, %3 failed; queue %4 (peak %5); latency %6 ms avg, %7 ms max.")
+                            .arg(stats.written).arg(stats.dropped).arg(stats.failed)
+                            .arg(stats.queueDepth).arg(stats.peakQueueDepth)
+                            .arg(stats.averageLatencyMs, 0, 'f', 1).arg(stats.maxLatencyMs, 0, 'f', 1), "INFO");
+    });
+    evidenceReportTimer->start(60000);
 }
 
 TrafficSystem::~TrafficSystem() {
     stopSystem();
-    if (processingThread) {
-        processingThread->quit();
-        processingThread->wait();
+    evidenceWriter->stop();
+    delete evidenceStore;
+    for (auto& road : roads) {
+        delete road.capture;
+        road.capture = nullptr;
+    }
+    delete simulator;
+    if (inferencePool) {
+        inferencePool->shutdown();
+    }
+    for (Intersection& intersection : intersections) {
+        delete intersection.arduino;
+        intersection.arduino = nullptr;
     }
-    delete arduino;
+    delete metricsServer;
+    delete metrics;
+    logger->stop();
 }
 
 bool TrafficSystem::initializeSystem() {
     emit logMessage("Initializing Traffic System...", "INFO");
-    processingThread = new QThread(this);
-    worker = new ProcessingWorker();
+    inferencePool = new InferencePool(this);
+    connect(inferencePool, &InferencePool::processingFinished, this, &TrafficSystem::handleProcessingFinished);
+    connect(inferencePool, &InferencePool::logMessage, this, [this](const QString& message, const QString& level) {
+        logger->log(level, "inference", message);
+    }, Qt::DirectConnection);
+    inferencePool->setBatchingEnabled(batchInferenceEnabled);
+    inferencePool->setMaxBatchSize(maxBatchSize);
+    inferencePool->setTrackRefinementEnabled(trackRefinementEnabled);
+    inferencePool->addRoads(getRoadCount());
+    if (!metrics) metrics = new Metrics(getRoadCount());
+    inferencePool->setMetrics(metrics);
+    for (int i = 0; i < getRoadCount(); ++i) {
+        inferencePool->setDetectorInterval(i, roads[i].detectorInterval);
+        inferencePool->setDisplaySize(i, roads[i].displaySize);
+        inferencePool->setDisplayMaxFps(i, roads[i].displayMaxFps);
+        inferencePool->setMinimumFrameRate(i, roads[i].minFrameRate);
+    }
+    inferencePool->setRedMinimumFrameRate(redMinFrameRate);
+
+    inferencePool->setDisplayEnabled(previewEnabled);
+    inferencePool->setInferenceBackend(inferenceBackendType, inferenceThreadsPerWorker);
+    inferencePool->setTilingOptions(tilingOptions);
 
-    if(!worker->initializeModels("yolov8n.onnx", "coco.names")){
+    if(!inferencePool->initialize(inferenceWorkerCount, yoloModelPath, classNamesPath)){
         emit logMessage("Failed to initialize ML models. System cannot start.", "ERROR");
-        delete worker; worker = nullptr;
-        delete processingThread; processingThread = nullptr;
+        delete inferencePool; inferencePool = nullptr;
         return false;
     }
+    inferencePool->setMotionGateEnabled(motionGateEnabled);
+    emit logMessage("Processing worker threads started.", "INFO");
 
-    worker->moveToThread(processingThread);
-
-    connect(processingThread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(this, &TrafficSystem::requestFrameProcessing, worker, &ProcessingWorker::processFrame, Qt::QueuedConnection);
-    connect(worker, &ProcessingWorker::processingFinished, this, &TrafficSystem::handleProcessingFinished, Qt::QueuedConnection);
-    connect(worker, &ProcessingWorker::logMessage, this, &TrafficSystem::handleWorkerLog, Qt::QueuedConnection);
-    connect(this, &TrafficSystem::requestYoloThresholdUpdate, worker, &ProcessingWorker::setYoloThresholds, Qt::QueuedConnection);
-
-    processingThread->start();
-    emit logMessage("Processing worker thread started.", "INFO");
+    qualityGovernor = new QualityGovernor(metrics, inferencePool, this);
+    connect(qualityGovernor, &QualityGovernor::logMessage, this, &TrafficSystem::logMessage);
+    for (int i = 0; i < getRoadCount(); ++i) qualityGovernor->setFrameBudget(i, roads[i].frameBudgetMs);
 
     initializeTimers();
     initializeArduino();
     return true;
 }
 
+bool TrafficSystem::setIntersectionLayout(const std::vector<int>& approachCounts) {
+    if (inferencePool) {
+        emit logMessage("The intersection layout cannot be changed once the system is initialized.", "ERROR");
+        return false;
+    }
+    if (approachCounts.empty()) return false;
+    for (int count : approachCounts) {
+        if (count < 1) {
+            emit logMessage(QString("Invalid intersection layout: %1 approaches.").arg(count), "ERROR");
+            return false;
+        }
+    }
+
+    for (RoadData& road : roads) delete road.capture;
+    for (Intersection& intersection : intersections) delete intersection.arduino;
+    roads.clear();
+    intersections.clear();
+    for (int count : approachCounts) {
+        Intersection intersection;
+        intersection.firstRoad = static_cast<int>(roads.size());
+        intersection.roadCount = count;
+        intersection.currentRoadIndex = intersection.firstRoad;
+        intersection.arduinoData.irSensorPreviousStates.assign(count, false);
+        intersections.push_back(intersection);
+        for (int i = 0; i < count; ++i) roads.emplace_back();
+    }
+    currentLights.assign(roads.size(), TrafficLight::OFF);
+    irViolationCooldownActive.assign(roads.size(), false);
+    return true;
+}
+
+int TrafficSystem::getIntersectionOfRoad(int roadIndex) const {
+    for (int i = 0; i < getIntersectionCount(); ++i) {
+        if (roadIndex >= intersections[i].firstRoad && roadIndex < intersections[i].firstRoad + intersections[i].roadCount) return i;
+    }
+    return -1;
+}
+
+int TrafficSystem::getFirstRoad(int intersectionIndex) const {
+    return isValidIntersection(intersectionIndex) ? intersections[intersectionIndex].firstRoad : -1;
+}
+
+int TrafficSystem::getApproachCount(int intersectionIndex) const {
+    return isValidIntersection(intersectionIndex) ? intersections[intersectionIndex].roadCount : 0;
+}
+
 void TrafficSystem::initializeTimers() {
     mainTimer = new QTimer(this);
-    lightTimer = new QTimer(this);
     sensorTimer = new QTimer(this);
     connect(mainTimer, &QTimer::timeout, this, &TrafficSystem::onMainTimerTimeout);
-    connect(lightTimer, &QTimer::timeout, this, &TrafficSystem::onLightTimerTimeout);
     connect(sensorTimer, &QTimer::timeout, this, &TrafficSystem::onSensorTimerTimeout);
+    // Every intersection runs its own light cycle.
+    for (int i = 0; i < getIntersectionCount(); ++i) {
+        Intersection& intersection = intersections[i];
+        intersection.controller = new SignalController(intersection.roadCount, nullptr, this);
+        intersection.controller->setYellowDuration(yellowLightFixedDuration * 1000);
+        intersection.controller->setAllRedDuration(allRedDurationMs);
+        intersection.controller->setGreenDurationSource([this, i](int approach) {
+            return 1000 * static_cast<qint64>(getRedLightDuration(roads[intersections[i].firstRoad + approach].density));
+        });
+        connect(intersection.controller, &SignalController::lightChanged, this, [this, i](int approach, TrafficLight light) {
+            onSignalLightChanged(i, approach, light);
+        });
+        intersection.lightTimer = new QTimer(this);
+        intersection.lightTimer->setSingleShot(true);
+        intersection.lightTimer->setTimerType(Qt::PreciseTimer);
+        connect(intersection.lightTimer, &QTimer::timeout, this, [this, i]() { onLightTimerTimeout(i); });
+    }
 }
 
 void TrafficSystem::startSystem() {
     if (systemRunning) return;
     systemRunning = true;
-    currentRoadIndex = 0;
-    yellowLightActive = false;
-    lightTimeRemaining = 0;
-    mainTimer->start(50);
-    if(arduinoData.connected) sensorTimer->start(250);
-    processTrafficCycle();
-    emit logMessage("Traffic system started.", "INFO");
+    mainTimer->start(33); // ~30 FPS tracking; YOLO runs on every detectorInterval-th frame
+    bool anyArduino = false;
+    for (int i = 0; i < getIntersectionCount(); ++i) {
+        Intersection& intersection = intersections[i];
+        intersection.currentRoadIndex = intersection.firstRoad;
+        anyArduino = anyArduino || intersection.arduinoData.connected;
+        processTrafficCycle(i);
+    }
+    if (anyArduino) sensorTimer->start(250);
+    if (qualityGovernor && qualityGovernorEnabled) qualityGovernor->start();
+    emit logMessage(QString("Traffic system started: %1 intersection(s), %2 road(s).").arg(getIntersectionCount()).arg(getRoadCount()), "INFO");
 }
 
 void TrafficSystem::stopSystem() {
     if (!systemRunning) return;
     systemRunning = false;
     mainTimer->stop();
-    lightTimer->stop();
+    for (Intersection& intersection : intersections) {
+        intersection.lightTimer->stop();
+        intersection.controller->stop(energySavingEnabled ? TrafficLight::OFF : TrafficLight::RED);
+    }
     sensorTimer->stop();
-    setAllTrafficLights(energySavingEnabled ? TrafficLight::OFF : TrafficLight::RED);
+    if (qualityGovernor) qualityGovernor->stop();
     emit logMessage("Traffic system stopped.", "INFO");
 }
 
 void TrafficSystem::onSensorTimerTimeout() {
-    if (arduinoData.connected) {
-        sendArduinoCommand("GET_SENSORS");
+    for (int i = 0; i < getIntersectionCount(); ++i) {
+        if (intersections[i].arduinoData.connected) sendArduinoCommand(i, "GET_SENSORS");
     }
 }
 
 void TrafficSystem::onMainTimerTimeout() {
-    if (!systemRunning || m_workerBusy) return;
-
-    static int roadToProcess = 0;
-    roadToProcess = (roadToProcess + 1) % 4;
-
-    if (roads[roadToProcess].cameraConnected && roads[roadToProcess].camera.isOpened()) {
-        cv::Mat frame;
-        if (roads[roadToProcess].camera.read(frame) && !frame.empty()) {
-            m_workerBusy = true;
+    if (!systemRunning || !inferencePool) return;
+
+    // Capture threads keep each road's slot fresh, so this never blocks on a camera.
+    // The pool queues the frames and hands them to whichever worker is free.
+    for (int i = 0; i < getRoadCount(); ++i) {
+        RoadData& road = roads[i];
+        if (!road.cameraConnected || !road.capture) continue;
+
+        // Both the road and the job reference the captured buffer; nothing is copied.
+        FrameRef frame;
+        qint64 capturedAtMs = 0;
+        if (!road.capture->takeLatestFrame(frame, &capturedAtMs)) {
+            metrics->increment(Metrics::Counter::RoadSkipped, i);
+        } else if (frame && !frame->empty()) {
             {
-                QMutexLocker locker(&roads[roadToProcess].frameMutex);
-                roads[roadToProcess].currentFrame = frame.clone();
+                QMutexLocker locker(&road.frameMutex);
+                road.currentFrame = frame;
             }
-            emit requestFrameProcessing(roadToProcess, frame.clone(), roads[roadToProcess].roi, currentLights[roadToProcess]);
+            FrameJob job;
+            job.roadIndex = i;
+            job.frame = frame;
+            job.capturedAtMs = capturedAtMs;
+            job.roi = road.roi;
+            job.currentLight = currentLights[i];
+            inferencePool->updateRoadSchedule(i, currentLights[i], getCurrentLightTimeRemaining(getIntersectionOfRoad(i)), road.vehicleCount);
+            inferencePool->submitFrame(job);
         }
     }
 }
 
-void TrafficSystem::handleProcessingFinished(int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs)
+void TrafficSystem::handleProcessingFinished(int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs,
+                                             const FrameRef& frame, qint64 capturedAtMs)
 {
-    m_workerBusy = false;
-    if (roadIndex < 0 || roadIndex >= 4) return;
+    // A frame still in flight when its camera was disconnected.
+    if (!isValidRoad(roadIndex) || !roads[roadIndex].cameraConnected || roads[roadIndex].simulated) return;
 
-    if(roads[roadIndex].vehicleCount != vehicleCount) {
-        roads[roadIndex].vehicleCount = vehicleCount;
-        emit vehicleCountChanged(roadIndex, vehicleCount);
-        TrafficDensity newDensity = (vehicleCount < 3) ? TrafficDensity::OFF : (vehicleCount <= 4) ? TrafficDensity::LOW : (vehicleCount <= 6) ? TrafficDensity::MEDIUM : (vehicleCount <= 9) ? TrafficDensity::HIGH : TrafficDensity::VERY_HIGH;
-        if(roads[roadIndex].density != newDensity){
-            roads[roadIndex].density = newDensity;
-            emit densityChanged(roadIndex, newDensity);
-        }
-    }
+    updateVehicleCount(roadIndex, vehicleCount);
 
-    emit frameUpdated(roadIndex, displayFrame);
+    if (!displayFrame.isNull()) emit frameUpdated(roadIndex, displayFrame);
 
     if (violationDetectionEnabled) {
         for(int id : violatingVehicleIDs) {
             if(roads[roadIndex].violatedIDs.find(id) == roads[roadIndex].violatedIDs.end()){
-                QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss-zzz");
-                cv::Mat frameCopy;
-                {
-                    QMutexLocker locker(&roads[roadIndex].frameMutex);
-                    if(!roads[roadIndex].currentFrame.empty()) frameCopy = roads[roadIndex].currentFrame.clone();
+                // The frame the violation was detected on, which may be several frames behind currentFrame.
+                const qint64 eventMs = capturedAtMs > 0 ? capturedAtMs : QDateTime::currentMSecsSinceEpoch();
+                QString timestamp = QDateTime::fromMSecsSinceEpoch(eventMs).toString("yyyy-MM-dd_hh-mm-ss-zzz");
+                QString reason = QString("Vehicle ID %1 ran red light").arg(id);
+                if (frame) {
+                    EvidenceRecord record;
+                    record.timestampMs = record.eventMs = eventMs;
+                    record.roadIndex = roadIndex;
+                    record.reason = reason;
+                    record.name = QString("VIO_%1_R%2.jpg").arg(timestamp).arg(roadIndex + 1);
+                    evidenceWriter->enqueue(frame, record, EvidenceWriter::Priority::Primary);
                 }
-                emit violationDetected(roadIndex, timestamp, QString("Vehicle ID %1 ran red light").arg(id), frameCopy);
+                saveViolationClip(roadIndex, eventMs, QString("VIO_%1_R%2").arg(timestamp).arg(roadIndex + 1), reason);
+                emit violationDetected(roadIndex, eventMs, reason, frame);
                 roads[roadIndex].violatedIDs.insert(id);
             }
         }
     }
-    updateTrafficLights();
+    updateTrafficLights(getIntersectionOfRoad(roadIndex));
 }
 
-void TrafficSystem::onLightTimerTimeout() {
-    if (!systemRunning || energySavingMode) {
-        lightTimer->stop();
-        return;
-    }
-    if (lightTimeRemaining > 0) {
-        lightTimeRemaining--;
-    }
-    if (lightTimeRemaining <= 0) {
-        lightTimer->stop();
-        switchToNextRoad();
+void TrafficSystem::updateVehicleCount(int roadIndex, int vehicleCount) {
+    if(roads[roadIndex].vehicleCount != vehicleCount) {
+        roads[roadIndex].vehicleCount = vehicleCount;
+        emit vehicleCountChanged(roadIndex, vehicleCount);
+        TrafficDensity newDensity = densityFromVehicleCount(vehicleCount);
+        if(roads[roadIndex].density != newDensity){
+            roads[roadIndex].density = newDensity;
+            emit densityChanged(roadIndex, newDensity);
+        }
     }
 }
 
-void TrafficSystem::updateTrafficLights() {
+void TrafficSystem::onSimulationTimerTimeout() {
+    // Simulated time follows the wall clock, also across a late timer.
+    const qint64 elapsedMs = simulationClock.restart();
     if (!systemRunning) return;
-    processEnergySaving();
-    if (energySavingMode) return;
-    if(currentLights[currentRoadIndex] == TrafficLight::OFF && roads[currentRoadIndex].vehicleCount > 0){
-        processTrafficCycle();
+    simulator->step(elapsedMs, currentLights);
+    for (int i = 0; i < getRoadCount(); ++i) {
+        if (!roads[i].simulated) continue;
+        updateVehicleCount(i, simulator->getQueueLength(i));
+        if (!previewEnabled) continue;
+        const cv::Size size = roads[i].displaySize.area() > 0 ? roads[i].displaySize : cv::Size(480, 270);
+        QImage image(size.width, size.height, QImage::Format_RGB32);
+        cv::Mat bgra(image.height(), image.width(), CV_8UC4, image.bits(), static_cast<size_t>(image.bytesPerLine()));
+        simulator->render(i, currentLights[i], bgra);
+        emit frameUpdated(i, image);
     }
+    for (int i = 0; i < getIntersectionCount(); ++i) updateTrafficLights(i);
 }
 
-void TrafficSystem::processTrafficCycle() {
-    if (!systemRunning || energySavingMode || yellowLightActive || lightTimer->isActive()) return;
-
-    for (int i = 0; i < 4; ++i) {
-        setTrafficLight(i, (i == currentRoadIndex) ? TrafficLight::GREEN : TrafficLight::RED);
-    }
-    lightTimeRemaining = getRedLightDuration(roads[currentRoadIndex].density);
-    lightTimer->start(1000);
+void TrafficSystem::onLightTimerTimeout(int intersectionIndex) {
+    Intersection& intersection = intersections[intersectionIndex];
+    if (!systemRunning || intersection.energySavingMode) return;
+    // The controller makes whatever transitions are due; the timer waits for the next one.
+    const qint64 waitMs = intersection.controller->update();
+    if (waitMs >= 0) intersection.lightTimer->start(static_cast<int>(qMin<qint64>(waitMs, INT_MAX)));
 }
 
-void TrafficSystem::switchToNextRoad() {
-    if (energySavingMode) return;
+void TrafficSystem::onSignalLightChanged(int intersectionIndex, int approach, TrafficLight light) {
+    Intersection& intersection = intersections[intersectionIndex];
+    const int roadIndex = intersection.firstRoad + approach;
+    if (light == TrafficLight::GREEN) intersection.currentRoadIndex = roadIndex;
+    // A new red or green starts a new count of violators.
+    if (light == TrafficLight::RED || light == TrafficLight::GREEN) roads[roadIndex].violatedIDs.clear();
+    setTrafficLight(roadIndex, light);
+}
 
-    if (!yellowLightActive) {
-        setTrafficLight(currentRoadIndex, TrafficLight::YELLOW);
-        yellowLightActive = true;
-        lightTimeRemaining = yellowLightFixedDuration;
-        lightTimer->start(1000);
-    } else {
-        yellowLightActive = false;
-        setTrafficLight(currentRoadIndex, TrafficLight::RED);
-        roads[currentRoadIndex].violatedIDs.clear();
-        currentRoadIndex = (currentRoadIndex + 1) % 4;
-        roads[currentRoadIndex].violatedIDs.clear();
-        processTrafficCycle();
+void TrafficSystem::updateTrafficLights(int intersectionIndex) {
+    if (!systemRunning || !isValidIntersection(intersectionIndex)) return;
+    processEnergySaving(intersectionIndex);
+    const Intersection& intersection = intersections[intersectionIndex];
+    if (intersection.energySavingMode) return;
+    if(currentLights[intersection.currentRoadIndex] == TrafficLight::OFF && roads[intersection.currentRoadIndex].vehicleCount > 0){
+        processTrafficCycle(intersectionIndex);
     }
 }
 
-void TrafficSystem::setAllTrafficLights(TrafficLight light) {
-    for (int i = 0; i < 4; ++i) {
-        setTrafficLight(i, light);
-    }
+void TrafficSystem::processTrafficCycle(int intersectionIndex) {
+    Intersection& intersection = intersections[intersectionIndex];
+    if (!systemRunning || intersection.energySavingMode || intersection.controller->isRunning()) return;
+
+    intersection.controller->start(intersection.currentRoadIndex - intersection.firstRoad);
+    onLightTimerTimeout(intersectionIndex);
 }
 
+// The controller board addresses lights by the approach number within its intersection.
 void TrafficSystem::setTrafficLight(int roadIndex, TrafficLight light) {
-    if (roadIndex < 0 || roadIndex >= 4 || currentLights[roadIndex] == light) return;
+    if (!isValidRoad(roadIndex) || currentLights[roadIndex] == light) return;
     currentLights[roadIndex] = light;
     emit trafficLightChanged(roadIndex, light);
     char l_char = 'F';
     if (light == TrafficLight::RED) l_char = 'R';
     else if (light == TrafficLight::YELLOW) l_char = 'Y';
     else if (light == TrafficLight::GREEN) l_char = 'G';
-    sendArduinoCommand(QString("L_%1_%2").arg(roadIndex).arg(l_char));
+    const int intersectionIndex = getIntersectionOfRoad(roadIndex);
+    sendArduinoCommand(intersectionIndex, QString("L_%1_%2").arg(roadIndex - intersections[intersectionIndex].firstRoad).arg(l_char));
 }
 
-void TrafficSystem::processEnergySaving() {
+void TrafficSystem::processEnergySaving(int intersectionIndex) {
+    Intersection& intersection = intersections[intersectionIndex];
     if (!energySavingEnabled) {
-        if (energySavingMode) {
-            energySavingMode = false;
-            emit energySavingStatusChanged(false);
-            processTrafficCycle();
+        if (intersection.energySavingMode) {
+            intersection.energySavingMode = false;
+            emit energySavingStatusChanged(intersectionIndex, false);
+            processTrafficCycle(intersectionIndex);
         }
         return;
     }
     bool allRoadsEmpty = true;
-    for (int i = 0; i < 4; ++i) {
+    for (int i = intersection.firstRoad; i < intersection.firstRoad + intersection.roadCount; ++i) {
         if (roads[i].cameraConnected && roads[i].vehicleCount > 0) {
             allRoadsEmpty = false;
             break;
         }
     }
-    if (allRoadsEmpty && !energySavingMode) {
-        energySavingMode = true;
-        lightTimer->stop();
-        setAllTrafficLights(TrafficLight::OFF);
-        emit energySavingStatusChanged(true);
-    } else if (!allRoadsEmpty && energySavingMode) {
-        energySavingMode = false;
-        emit energySavingStatusChanged(false);
-        processTrafficCycle();
+    if (allRoadsEmpty && !intersection.energySavingMode) {
+        intersection.energySavingMode = true;
+        intersection.lightTimer->stop();
+        intersection.controller->stop(TrafficLight::OFF);
+        emit energySavingStatusChanged(intersectionIndex, true);
+    } else if (!allRoadsEmpty && intersection.energySavingMode) {
+        intersection.energySavingMode = false;
+        emit energySavingStatusChanged(intersectionIndex, false);
+        processTrafficCycle(intersectionIndex);
     }
 }
 
 bool TrafficSystem::connectCamera(int roadIndex, const QString& source) {
-    if (roadIndex < 0 || roadIndex >= 4) return false;
+    if (!isValidRoad(roadIndex)) return false;
+    if (source.startsWith("sim", Qt::CaseInsensitive)) {
+        DemandProfile demand = DemandProfile::parse(source.mid(4));
+        if (demand.vehiclesPerHour.empty()) demand.vehiclesPerHour.push_back(400);
+        return connectSimulatedRoad(roadIndex, demand);
+    }
     disconnectCamera(roadIndex);
-    cv::VideoCapture cap;
-    bool isNumeric;
-    int camIndex = source.toInt(&isNumeric);
-    if (isNumeric) cap.open(camIndex, cv::CAP_ANY);
-    else cap.open(source.toStdString());
-    if (cap.isOpened()) {
-        roads[roadIndex].camera = std::move(cap);
-        roads[roadIndex].camera.set(cv::CAP_PROP_BUFFERSIZE, 1);
+    CameraCapture* capture = new CameraCapture(this);
+    capture->getHistory().setBudgetBytes(frameHistoryBudgetBytes);
+    capture->setMetrics(metrics, roadIndex);
+    if (capture->open(source)) {
+        connect(capture, &CameraCapture::captureFailed, this, [this, roadIndex](const QString& message) {
+            emit logMessage(QString("Camera %1: %2").arg(roadIndex + 1).arg(message), "WARNING");
+        });
+        capture->start();
+        roads[roadIndex].capture = capture;
         roads[roadIndex].cameraConnected = true;
         roads[roadIndex].cameraSource = source;
         emit cameraStatusChanged(roadIndex, true);
         emit logMessage(QString("Camera %1 connected to source: %2").arg(roadIndex + 1).arg(source), "INFO");
         return true;
     }
+    delete capture;
     emit logMessage("Failed to open camera source: " + source, "ERROR");
     return false;
 }
 
+bool TrafficSystem::connectSimulatedRoad(int roadIndex, const DemandProfile& demand) {
+    if (!isValidRoad(roadIndex)) return false;
+    disconnectCamera(roadIndex);
+    if (!simulator) {
+        simulator = new TrafficSimulator(getRoadCount());
+        // Demand profiles are by hour of day, so simulated time starts at the local time of day.
+        simulator->reset(1, QTime::currentTime().msecsSinceStartOfDay());
+        simulationTimer = new QTimer(this);
+        connect(simulationTimer, &QTimer::timeout, this, &TrafficSystem::onSimulationTimerTimeout);
+    }
+    simulator->setDemand(roadIndex, demand);
+    if (!simulationTimer->isActive()) {
+        simulationClock.start();
+        simulationTimer->start(100);
+    }
+    QStringList rates;
+    for (double rate : demand.vehiclesPerHour) rates << QString::number(rate);
+    roads[roadIndex].simulated = true;
+    roads[roadIndex].cameraConnected = true;
+    roads[roadIndex].cameraSource = "sim:" + rates.join(",");
+    emit cameraStatusChanged(roadIndex, true);
+    emit logMessage(QString("Road %1 simulated at %2 vehicles/h.").arg(roadIndex + 1).arg(rates.join(", ")), "INFO");
+    return true;
+}
+
 void TrafficSystem::disconnectCamera(int roadIndex) {
-    if (roadIndex < 0 || roadIndex >= 4 || !roads[roadIndex].cameraConnected) return;
-    if (roads[roadIndex].camera.isOpened()) {
-        roads[roadIndex].camera.release();
+    if (!isValidRoad(roadIndex) || !roads[roadIndex].cameraConnected) return;
+    if (roads[roadIndex].simulated) {
+        simulator->setDemand(roadIndex, DemandProfile());
+        simulator->clearApproach(roadIndex);
+        roads[roadIndex].simulated = false;
+    }
+    if (roads[roadIndex].capture) {
+        roads[roadIndex].capture->stop();
+        delete roads[roadIndex].capture;
+        roads[roadIndex].capture = nullptr;
+    }
+    // Tracks, track IDs and the motion reference of the old source must not carry over to the next one.
+    if (inferencePool) inferencePool->resetRoad(roadIndex);
+    {
+        QMutexLocker locker(&roads[roadIndex].frameMutex);
+        roads[roadIndex].currentFrame.reset();
     }
     roads[roadIndex].vehicleCount = 0;
     roads[roadIndex].density = TrafficDensity::OFF;
@@ -303,43 +517,59 @@ void TrafficSystem::disconnectCamera(int roadIndex) {
     emit logMessage(QString("Camera %1 disconnected.").arg(roadIndex + 1), "INFO");
 }
 
-bool TrafficSystem::initializeArduino(const QString& portName) {
-    if (arduino && arduino->isOpen()) {
-        arduino->close();
+bool TrafficSystem::initializeArduino(const QString& portName, int intersectionIndex) {
+    if (!isValidIntersection(intersectionIndex)) return false;
+    Intersection& intersection = intersections[intersectionIndex];
+    if (intersection.arduino && intersection.arduino->isOpen()) {
+        intersection.arduino->close();
+        intersection.arduinoData.connected = false;
     }
-    if (!arduino) {
-        arduino = new QSerialPort(this);
-        connect(arduino, &QSerialPort::readyRead, this, &TrafficSystem::onArduinoDataReceived);
-        connect(arduino, &QSerialPort::errorOccurred, this, [this](QSerialPort::SerialPortError error){
-            if (error != QSerialPort::NoError && arduinoData.connected) {
-                emit logMessage("Arduino Error: " + arduino->errorString(), "ERROR");
-                arduinoData.connected = false;
-                emit arduinoStatusChanged(false, "");
+    if (!intersection.arduino) {
+        QSerialPort* arduino = new QSerialPort(this);
+        intersection.arduino = arduino;
+        connect(arduino, &QSerialPort::readyRead, this, [this, intersectionIndex]() { onArduinoDataReceived(intersectionIndex); });
+        connect(arduino, &QSerialPort::errorOccurred, this, [this, intersectionIndex, arduino](QSerialPort::SerialPortError error){
+            ArduinoData& data = intersections[intersectionIndex].arduinoData;
+            if (error != QSerialPort::NoError && data.connected) {
+                emit logMessage(QString("Arduino Error (intersection %1): %2").arg(intersectionIndex + 1).arg(arduino->errorString()), "ERROR");
+                data.connected = false;
+                emit arduinoStatusChanged(intersectionIndex, false, "");
             }
         });
     }
 
+    // Auto-detection skips ports that another intersection already drives.
     QString portToUse = portName;
     if (portToUse.isEmpty()) {
         const auto ports = QSerialPortInfo::availablePorts();
-        if (!ports.isEmpty()) portToUse = ports.first().portName();
+        for (const QSerialPortInfo& info : ports) {
+            bool inUse = false;
+            for (const Intersection& other : intersections) {
+                if (other.arduinoData.connected && other.arduinoData.portName == info.portName()) inUse = true;
+            }
+            if (!inUse) {
+                portToUse = info.portName();
+                break;
+            }
+        }
     }
 
     if (portToUse.isEmpty()) {
-        emit logMessage("No Arduino ports found. Using simulation.", "WARNING");
+        emit logMessage(QString("No Arduino ports found for intersection %1. Using simulation.").arg(intersectionIndex + 1), "WARNING");
         return false;
     }
 
+    QSerialPort* arduino = intersection.arduino;
     arduino->setPortName(portToUse);
     arduino->setBaudRate(QSerialPort::Baud9600);
     if (arduino->open(QIODevice::ReadWrite)) {
         QThread::msleep(2000);
         arduino->write("INIT\n");
 
-        arduinoData.connected = true;
-        arduinoData.portName = portToUse;
-        emit arduinoStatusChanged(true, portToUse);
-        emit logMessage("Arduino connected on port " + portToUse, "INFO");
+        intersection.arduinoData.connected = true;
+        intersection.arduinoData.portName = portToUse;
+        emit arduinoStatusChanged(intersectionIndex, true, portToUse);
+        emit logMessage(QString("Arduino for intersection %1 connected on port %2").arg(intersectionIndex + 1).arg(portToUse), "INFO");
         if(systemRunning) sensorTimer->start(250);
         return true;
     }
@@ -347,90 +577,215 @@ bool TrafficSystem::initializeArduino(const QString& portName) {
     return false;
 }
 
-void TrafficSystem::sendArduinoCommand(const QString& command) {
-    if (!arduinoData.connected || !arduino || !arduino->isOpen()) return;
+void TrafficSystem::sendArduinoCommand(int intersectionIndex, const QString& command) {
+    if (!isValidIntersection(intersectionIndex)) return;
+    Intersection& intersection = intersections[intersectionIndex];
+    if (!intersection.arduinoData.connected || !intersection.arduino || !intersection.arduino->isOpen()) return;
     QMutexLocker locker(&arduinoMutex);
-    arduino->write((command + "\n").toUtf8());
+    intersection.arduino->write((command + "\n").toUtf8());
 }
 
-void TrafficSystem::onArduinoDataReceived() {
-    if (!arduino || !arduino->isOpen()) return;
-    arduinoData.buffer.append(arduino->readAll());
-    while (arduinoData.buffer.contains('\n')) {
-        QByteArray line = arduinoData.buffer.left(arduinoData.buffer.indexOf('\n'));
-        arduinoData.buffer.remove(0, line.length() + 1);
-        parseArduinoData(line);
+void TrafficSystem::onArduinoDataReceived(int intersectionIndex) {
+    Intersection& intersection = intersections[intersectionIndex];
+    if (!intersection.arduino || !intersection.arduino->isOpen()) return;
+    QByteArray& buffer = intersection.arduinoData.buffer;
+    buffer.append(intersection.arduino->readAll());
+    while (buffer.contains('\n')) {
+        QByteArray line = buffer.left(buffer.indexOf('\n'));
+        buffer.remove(0, line.length() + 1);
+        parseArduinoData(intersectionIndex, line);
     }
 }
 
-void TrafficSystem::parseArduinoData(const QByteArray& data) {
+// SENSORS: carries one 0/1 field per approach of the board's intersection.
+void TrafficSystem::parseArduinoData(int intersectionIndex, const QByteArray& data) {
     if (data.startsWith("SENSORS:")) {
+        Intersection& intersection = intersections[intersectionIndex];
         QStringList states = QString::fromUtf8(data.mid(8)).split(',', Qt::SkipEmptyParts);
-        if (states.length() == 4) {
-            std::array<bool, 4> newStates;
-            for (int i = 0; i < 4; ++i) {
-                newStates[i] = (states[i] == "1");
+        if (states.length() == intersection.roadCount) {
+            std::vector<bool> newStates(intersection.roadCount);
+            for (int a = 0; a < intersection.roadCount; ++a) {
+                newStates[a] = (states[a] == "1");
             }
 
-            for (int i = 0; i < 4; ++i) {
-                if (newStates[i] && !arduinoData.irSensorPreviousStates[i] && !irViolationCooldownActive[i]) {
+            for (int a = 0; a < intersection.roadCount; ++a) {
+                const int i = intersection.firstRoad + a;
+                if (newStates[a] && !intersection.arduinoData.irSensorPreviousStates[a] && !irViolationCooldownActive[i]) {
                     if (currentLights[i] == TrafficLight::RED && violationDetectionEnabled) {
-                        QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss-zzz");
+                        const QDateTime now = QDateTime::currentDateTime();
+                        QString timestamp = now.toString("yyyy-MM-dd_hh-mm-ss-zzz");
                         QString reason = QString("IR sensor triggered on red light for Road %1").arg(i + 1);
 
-                        saveViolationScreenshot(i, 1, timestamp);
-                        emit violationDetected(i, timestamp, reason, roads[i].currentFrame);
+                        saveViolationScreenshot(i, now.toMSecsSinceEpoch(), timestamp, reason);
+                        FrameRef frame;
+                        {
+                            QMutexLocker locker(&roads[i].frameMutex);
+                            frame = roads[i].currentFrame;
+                        }
+                        emit violationDetected(i, now.toMSecsSinceEpoch(), reason, frame);
                         logMessage(reason, "VIOLATION");
 
-                        QTimer::singleShot(500, this, [this, i, timestamp]() { saveViolationScreenshot(i, 2, timestamp); });
-                        QTimer::singleShot(1000, this, [this, i, timestamp]() { saveViolationScreenshot(i, 3, timestamp); });
+                        saveViolationClip(i, now.toMSecsSinceEpoch(), QString("VIO_IR_%1_R%2").arg(timestamp).arg(i + 1), reason);
 
                         irViolationCooldownActive[i] = true;
                         QTimer::singleShot(5000, this, [this, i](){ irViolationCooldownActive[i] = false; });
                     }
                 }
             }
-            arduinoData.irSensorPreviousStates = newStates;
+            intersection.arduinoData.irSensorPreviousStates = newStates;
         }
     }
 }
 
-void TrafficSystem::saveViolationScreenshot(int roadIndex, int imageNum, const QString& baseTimestamp) {
-    cv::Mat frameCopy;
+void TrafficSystem::saveViolationScreenshot(int roadIndex, qint64 eventMs, const QString& baseTimestamp, const QString& reason) {
+    FrameRef frame;
     {
         QMutexLocker locker(&roads[roadIndex].frameMutex);
-        if(!roads[roadIndex].currentFrame.empty()) frameCopy = roads[roadIndex].currentFrame.clone();
-    }
-    if (!frameCopy.empty()) {
-        QString filename = QString("VIO_IR_%1_R%2_IMG%3.jpg").arg(baseTimestamp).arg(roadIndex + 1).arg(imageNum);
-        QString fullPath = QDir(violationDir).filePath(filename);
-        if (!cv::imwrite(fullPath.toStdString(), frameCopy)) {
-            logMessage("Failed to save IR violation image: " + fullPath, "ERROR");
-        } else {
-            logMessage("Saved IR violation image: " + filename, "INFO");
-        }
+        frame = roads[roadIndex].currentFrame;
+    }
+    if (frame && !frame->empty()) {
+        EvidenceRecord record;
+        record.timestampMs = QDateTime::currentMSecsSinceEpoch();
+        record.eventMs = eventMs;
+        record.roadIndex = roadIndex;
+        record.reason = reason;
+        record.name = QString("VIO_IR_%1_R%2.jpg").arg(baseTimestamp).arg(roadIndex + 1);
+        evidenceWriter->enqueue(frame, record, EvidenceWriter::Priority::Primary);
     }
 }
 
-const RoadData& TrafficSystem::getRoadData(int idx) const { static RoadData empty; return (idx >= 0 && idx < 4) ? roads[idx] : empty; }
-const ArduinoData& TrafficSystem::getArduinoData() const { return arduinoData; }
-TrafficLight TrafficSystem::getCurrentLight(int idx) const { return (idx >= 0 && idx < 4) ? currentLights[idx] : TrafficLight::OFF; }
+// Dumps the camera history from evidencePreMs before to evidencePostMs after now,
+// once the post-event part has been captured. Capture keeps running throughout.
+void TrafficSystem::saveViolationClip(int roadIndex, qint64 eventMs, const QString& baseName, const QString& reason) {
+    if (!roads[roadIndex].capture || evidencePreMs + evidencePostMs <= 0) return;
+
+    EvidenceRecord event;
+    event.eventMs = eventMs;
+    event.roadIndex = roadIndex;
+    event.reason = reason;
+    event.name = baseName;
+    QPointer<CameraCapture> capture = roads[roadIndex].capture;
+    // The clip is centred on the event, which may already lie a little in the past.
+    const qint64 waitMs = qMax<qint64>(0, eventMs + evidencePostMs - QDateTime::currentMSecsSinceEpoch());
+    QTimer::singleShot(static_cast<int>(waitMs), this, [this, capture, event]() {
+        if (!capture) return; // camera disconnected meanwhile
+        std::vector<FrameHistory::Frame> frames = capture->getHistory().snapshot(event.eventMs - evidencePreMs, event.eventMs + evidencePostMs);
+        if (frames.empty()) return;
+        evidenceWriter->enqueueSequence(frames, event, EvidenceWriter::Priority::FollowUp);
+    });
+}
+
+void TrafficSystem::setEvidenceClipWindow(int preMs, int postMs) {
+    evidencePreMs = qMax(0, preMs);
+    evidencePostMs = qMax(0, postMs);
+}
+
+void TrafficSystem::setFrameHistoryBudget(qint64 bytesPerRoad) {
+    frameHistoryBudgetBytes = qMax<qint64>(0, bytesPerRoad);
+    for (RoadData& road : roads) {
+        if (road.capture) road.capture->getHistory().setBudgetBytes(frameHistoryBudgetBytes);
+    }
+}
+
+const RoadData& TrafficSystem::getRoadData(int idx) const { static RoadData empty; return isValidRoad(idx) ? roads[idx] : empty; }
+const ArduinoData& TrafficSystem::getArduinoData(int intersectionIndex) const { static ArduinoData empty; return isValidIntersection(intersectionIndex) ? intersections[intersectionIndex].arduinoData : empty; }
+TrafficLight TrafficSystem::getCurrentLight(int idx) const { return isValidRoad(idx) ? currentLights[idx] : TrafficLight::OFF; }
+int TrafficSystem::getCurrentLightTimeRemaining(int intersectionIndex) const {
+    const SignalController* controller = getSignalController(intersectionIndex);
+    return controller ? static_cast<int>((controller->getRemainingMs() + 999) / 1000) : 0;
+}
+const SignalController* TrafficSystem::getSignalController(int intersectionIndex) const { return isValidIntersection(intersectionIndex) ? intersections[intersectionIndex].controller : nullptr; }
+int TrafficSystem::getCurrentRoadIndex(int intersectionIndex) const { return isValidIntersection(intersectionIndex) ? intersections[intersectionIndex].currentRoadIndex : -1; }
+bool TrafficSystem::isEnergySavingActive(int intersectionIndex) const { return isValidIntersection(intersectionIndex) && intersections[intersectionIndex].energySavingMode; }
 void TrafficSystem::setLightTiming(TrafficDensity d, int secs) { lightDurations[static_cast<int>(d)] = secs; }
-void TrafficSystem::setYellowLightDuration(int secs) { yellowLightFixedDuration = secs; }
+void TrafficSystem::setYellowLightDuration(int secs) {
+    yellowLightFixedDuration = qMax(0, secs);
+    for (Intersection& intersection : intersections) {
+        if (intersection.controller) intersection.controller->setYellowDuration(yellowLightFixedDuration * 1000);
+    }
+}
+void TrafficSystem::setAllRedDuration(int milliseconds) {
+    allRedDurationMs = qMax(0, milliseconds);
+    for (Intersection& intersection : intersections) {
+        if (intersection.controller) intersection.controller->setAllRedDuration(allRedDurationMs);
+    }
+}
 void TrafficSystem::setEnergySavingEnabled(bool enabled) { energySavingEnabled = enabled; }
 void TrafficSystem::setViolationDetectionEnabled(bool enabled) { violationDetectionEnabled = enabled; }
-void TrafficSystem::setRoadROI(int roadIndex, const cv::Rect& roi) { if (roadIndex >= 0 && roadIndex < 4) roads[roadIndex].roi = roi; }
-void TrafficSystem::setYoloThresholds(float confidence, float nms) { emit requestYoloThresholdUpdate(confidence, nms); }
-void TrafficSystem::handleWorkerLog(const QString& message, const QString& level) { emit logMessage(message, level); }
+void TrafficSystem::setRoadROI(int roadIndex, const cv::Rect& roi) { if (isValidRoad(roadIndex)) roads[roadIndex].roi = roi; }
+void TrafficSystem::setYoloThresholds(float confidence, float nms) { if (inferencePool) inferencePool->setYoloThresholds(confidence, nms); }
+void TrafficSystem::setBatchInferenceEnabled(bool enabled) { batchInferenceEnabled = enabled; if (inferencePool) inferencePool->setBatchingEnabled(enabled); }
+void TrafficSystem::setDetectorInterval(int roadIndex, int interval) {
+    if (!isValidRoad(roadIndex)) return;
+    roads[roadIndex].detectorInterval = qMax(1, interval);
+    if (inferencePool) inferencePool->setDetectorInterval(roadIndex, roads[roadIndex].detectorInterval);
+}
+void TrafficSystem::setFrameBudget(int roadIndex, int milliseconds) {
+    if (!isValidRoad(roadIndex)) return;
+    roads[roadIndex].frameBudgetMs = qMax(0, milliseconds);
+    if (qualityGovernor) qualityGovernor->setFrameBudget(roadIndex, roads[roadIndex].frameBudgetMs);
+}
+void TrafficSystem::setMinimumFrameRate(int roadIndex, double fps) {
+    if (!isValidRoad(roadIndex)) return;
+    roads[roadIndex].minFrameRate = qMax(0.0, fps);
+    if (inferencePool) inferencePool->setMinimumFrameRate(roadIndex, roads[roadIndex].minFrameRate);
+}
+void TrafficSystem::setRedMinimumFrameRate(double fps) {
+    redMinFrameRate = qMax(0.0, fps);
+    if (inferencePool) inferencePool->setRedMinimumFrameRate(redMinFrameRate);
+}
+void TrafficSystem::setQualityGovernorEnabled(bool enabled) {
+    qualityGovernorEnabled = enabled;
+    if (!qualityGovernor) return;
+    if (enabled && systemRunning) {
+        qualityGovernor->start();
+    } else if (!enabled) {
+        // Back to full quality on every road.
+        qualityGovernor->stop();
+        for (int i = 0; i < getRoadCount(); ++i) {
+            qualityGovernor->setFrameBudget(i, 0);
+            qualityGovernor->setFrameBudget(i, roads[i].frameBudgetMs);
+        }
+    }
+}
+void TrafficSystem::setTrackRefinementEnabled(bool enabled) { trackRefinementEnabled = enabled; if (inferencePool) inferencePool->setTrackRefinementEnabled(enabled); }
+void TrafficSystem::setDisplaySize(int roadIndex, const QSize& size) {
+    if (!isValidRoad(roadIndex)) return;
+    roads[roadIndex].displaySize = cv::Size(size.width(), size.height());
+    if (inferencePool) inferencePool->setDisplaySize(roadIndex, roads[roadIndex].displaySize);
+}
+bool TrafficSystem::startMetricsServer(quint16 port) {
+    if (!metrics) return false;
+    if (!metricsServer) metricsServer = new MetricsServer(metrics, this);
+    if (!metricsServer->listen(port)) {
+        emit logMessage(QString("Metrics endpoint could not listen on port %1: %2").arg(port).arg(metricsServer->errorString()), "WARNING");
+        return false;
+    }
+    emit logMessage(QString("Metrics available at http://127.0.0.1:%1/metrics").arg(port), "INFO");
+    return true;
+}
+
+void TrafficSystem::setPreviewEnabled(bool enabled) {
+    previewEnabled = enabled;
+    if (inferencePool) inferencePool->setDisplayEnabled(enabled);
+}
 
-void TrafficSystem::setArduinoSimulationMode(bool simActive) {
-    if(simActive && arduinoData.connected) {
-        if(arduino && arduino->isOpen()) arduino->close();
-        arduinoData.connected = false;
-        sensorTimer->stop();
-        emit arduinoStatusChanged(false, "Simulation");
-    } else if (!simActive && !arduinoData.connected) {
-        initializeArduino();
+void TrafficSystem::setDisplayMaxFps(int roadIndex, int maxFps) {
+    if (!isValidRoad(roadIndex)) return;
+    roads[roadIndex].displayMaxFps = qMax(0, maxFps);
+    if (inferencePool) inferencePool->setDisplayMaxFps(roadIndex, roads[roadIndex].displayMaxFps);
+}
+void TrafficSystem::setMotionGateEnabled(bool enabled) { motionGateEnabled = enabled; if (inferencePool) inferencePool->setMotionGateEnabled(enabled); }
+
+void TrafficSystem::setArduinoSimulationMode(bool simActive, int intersectionIndex) {
+    if (!isValidIntersection(intersectionIndex)) return;
+    Intersection& intersection = intersections[intersectionIndex];
+    if(simActive && intersection.arduinoData.connected) {
+        if(intersection.arduino && intersection.arduino->isOpen()) intersection.arduino->close();
+        intersection.arduinoData.connected = false;
+        emit arduinoStatusChanged(intersectionIndex, false, "Simulation");
+    } else if (!simActive && !intersection.arduinoData.connected) {
+        initializeArduino("", intersectionIndex);
     }
 }
 
@@ -447,6 +802,11 @@ int TrafficSystem::getRedLightDuration(TrafficDensity density) {
     return lightDurations[static_cast<int>(density)];
 }
 
+quint64 TrafficSystem::getDroppedFrameCount(int roadIndex) const {
+    if (!isValidRoad(roadIndex) || !roads[roadIndex].capture) return 0;
+    return roads[roadIndex].capture->getDroppedFrameCount();
+}
+
 QString TrafficSystem::getViolationDirectory() const {
     return violationDir;
 }
@@ -7,25 +7,43 @@
 #include <QThread>
 #include <QMutex>
 #include <QImage>
+#include <QElapsedTimer>
 #include <opencv2/opencv.hpp>
 #include "traffic_types.h"
-#include "processingworker.h"
+#include "inferencepool.h"
+#include "cameracapture.h"
+#include "evidencewriter.h"
+#include "evidencestore.h"
+#include "logger.h"
+#include "metrics.h"
+#include "metricsserver.h"
+#include "qualitygovernor.h"
+#include "signalcontroller.h"
+#include "trafficsimulator.h"
 
 #include <array>
+#include <deque>
 #include <map>
 #include <atomic>
 #include <set>
+#include <vector>
 
 
 struct RoadData {
     int vehicleCount = 0;
     TrafficDensity density = TrafficDensity::OFF;
-    cv::VideoCapture camera;
-    cv::Mat currentFrame;
+    CameraCapture* capture = nullptr;
+    FrameRef currentFrame;
     QMutex frameMutex;
     bool cameraConnected = false;
+    bool simulated = false; // counts come from the TrafficSimulator instead of a camera
     QString cameraSource;
     cv::Rect roi = cv::Rect(0, 0, 0, 0);
+    int detectorInterval = 3; // YOLO on every 3rd frame, tracker prediction in between
+    cv::Size displaySize;
+    int displayMaxFps = 15;
+    int frameBudgetMs = 250; // p95 submit-to-result latency the quality governor holds the road to, 0: ungoverned
+    double minFrameRate = 2.0; // frames per second the scheduler guarantees the road, 0: none
     std::set<int> violatedIDs;
 };
 
@@ -33,8 +51,20 @@ struct ArduinoData {
     bool connected = false;
     QString portName;
     QByteArray buffer;
-    std::array<bool, 4> irSensorStates{false};
-    std::array<bool, 4> irSensorPreviousStates{false};
+    std::vector<bool> irSensorPreviousStates; // one per approach of the intersection
+};
+
+// One signalised junction. Its approaches are the roads firstRoad .. firstRoad + roadCount - 1;
+// road indices are global across all intersections of the system.
+struct Intersection {
+    int firstRoad = 0;
+    int roadCount = 0;
+    int currentRoadIndex = 0; // global index of the approach being served
+    bool energySavingMode = false;
+    SignalController* controller = nullptr;
+    QTimer* lightTimer = nullptr; // single-shot, armed for the controller's next transition
+    QSerialPort* arduino = nullptr;
+    ArduinoData arduinoData;
 };
 
 class TrafficSystem : public QObject
@@ -50,28 +80,85 @@ public:
     void stopSystem();
     bool isSystemRunning() const { return systemRunning; }
 
+    // Number of approaches of each intersection, e.g. {4} (the default) or {3, 5, 4}.
+    // Only before initializeSystem(); the roads are numbered intersection by intersection.
+    bool setIntersectionLayout(const std::vector<int>& approachCounts);
+    int getIntersectionCount() const { return static_cast<int>(intersections.size()); }
+    int getRoadCount() const { return static_cast<int>(roads.size()); }
+    int getIntersectionOfRoad(int roadIndex) const;
+    int getFirstRoad(int intersectionIndex) const;
+    int getApproachCount(int intersectionIndex) const;
+
     void setLightTiming(TrafficDensity density, int durationSeconds);
     void setYellowLightDuration(int seconds);
+    // Every approach of an intersection stays red this long between a yellow and the next green.
+    void setAllRedDuration(int milliseconds);
     void setEnergySavingEnabled(bool enabled);
     void setViolationDetectionEnabled(bool enabled);
     void setRoadROI(int roadIndex, const cv::Rect& roi);
     void setYoloThresholds(float confidence, float nms);
-
+    void setBatchInferenceEnabled(bool enabled);
+    void setDetectorInterval(int roadIndex, int interval);
+    void setTrackRefinementEnabled(bool enabled);
+    void setMotionGateEnabled(bool enabled);
+    void setDisplaySize(int roadIndex, const QSize& size);
+    void setDisplayMaxFps(int roadIndex, int maxFps);
+    void setEvidenceJpegQuality(int quality) { evidenceWriter->setJpegQuality(quality); }
+    void setEvidenceQueueDepth(int depth) { evidenceWriter->setMaxQueueDepth(depth); }
+    // Applied by the writer thread once an hour; 0 disables either limit.
+    void setEvidenceRetention(int days, qint64 maxTotalBytes) { evidenceStore->setRetention(days, maxTotalBytes); }
+    // Seconds around a violation dumped from the camera history, and its RAM budget per road.
+    void setEvidenceClipWindow(int preMs, int postMs);
+    void setFrameHistoryBudget(qint64 bytesPerRoad);
+    void setInferenceWorkerCount(int count) { inferenceWorkerCount = qMax(1, count); }
+    // Takes effect at initializeSystem(); 0 threads gives each worker an even share of the cores.
+    void setInferenceBackend(InferenceBackend::Type type, int threadsPerWorker) { inferenceBackendType = type; inferenceThreadsPerWorker = threadsPerWorker; }
+    // Takes effect at initializeSystem().
+    void setTilingOptions(const TilingOptions& options) { tilingOptions = options; }
+    // The governor trades preview rate, tiles, detector interval and input size for latency per road.
+    void setQualityGovernorEnabled(bool enabled);
+    void setFrameBudget(int roadIndex, int milliseconds);
+    int getQualityLevel(int roadIndex) const { return qualityGovernor ? qualityGovernor->getLevel(roadIndex) : 0; }
+    // Guaranteed inference rates per road, and for every red or yellow approach.
+    void setMinimumFrameRate(int roadIndex, double fps);
+    void setRedMinimumFrameRate(double fps);
+    // Takes effect at initializeSystem().
+    void setMaxBatchSize(int size) { maxBatchSize = qMax(1, size); }
+    // Takes effect at initializeSystem(); relative paths are resolved against the executable's directory.
+    void setModelPaths(const QString& yoloModel, const QString& classNames) { yoloModelPath = yoloModel; classNamesPath = classNames; }
+    // Headless deployments render no previews.
+    void setPreviewEnabled(bool enabled);
+    // Prometheus text on http://127.0.0.1:<port>/metrics; after initializeSystem().
+    bool startMetricsServer(quint16 port);
+
+    // "sim" or "sim:<vehicles per hour>[, <per hour of day>...]" connects a simulated road instead.
     bool connectCamera(int roadIndex, const QString& source);
+    bool connectSimulatedRoad(int roadIndex, const DemandProfile& demand);
     void disconnectCamera(int roadIndex);
-    bool initializeArduino(const QString& portName = "");
-    void setArduinoSimulationMode(bool simActive);
+    // Each intersection drives its own controller board; an empty name picks the first free port.
+    bool initializeArduino(const QString& portName = "", int intersectionIndex = 0);
+    void setArduinoSimulationMode(bool simActive, int intersectionIndex = 0);
     QStringList getAvailableArduinoPorts();
 
     const RoadData& getRoadData(int roadIndex) const;
-    const ArduinoData& getArduinoData() const;
+    const ArduinoData& getArduinoData(int intersectionIndex = 0) const;
     TrafficLight getCurrentLight(int roadIndex) const;
-    int getCurrentLightTimeRemaining() const { return lightTimeRemaining; }
-    int getCurrentRoadIndex() const { return currentRoadIndex; }
+    int getCurrentLightTimeRemaining(int intersectionIndex = 0) const;
+    // Created by initializeSystem(), null before.
+    const SignalController* getSignalController(int intersectionIndex = 0) const;
+    int getCurrentRoadIndex(int intersectionIndex = 0) const;
     int getYellowLightDuration() const { return yellowLightFixedDuration; }
-    bool isEnergySavingActive() const { return energySavingMode; }
+    int getAllRedDuration() const { return allRedDurationMs; }
+    bool isEnergySavingEnabled() const { return energySavingEnabled; }
+    bool isEnergySavingActive(int intersectionIndex = 0) const;
     int getRedLightDuration(TrafficDensity density);
+    quint64 getDroppedFrameCount(int roadIndex) const;
     QString getViolationDirectory() const;
+    EvidenceWriter::Stats getEvidenceStats() const { return evidenceWriter->getStats(); }
+    EvidenceStore* getEvidenceStore() const { return evidenceStore; }
+    Logger* getLogger() const { return logger; }
+    // Created by initializeSystem(), null before.
+    Metrics* getMetrics() const { return metrics; }
 
 
 signals:
@@ -80,62 +167,80 @@ signals:
     void densityChanged(int roadIndex, TrafficDensity density);
     void trafficLightChanged(int roadIndex, TrafficLight light);
     void frameUpdated(int roadIndex, const QImage& frame);
-    void violationDetected(int roadIndex, const QString& timestamp, const QString& reason, const cv::Mat& frame);
+    void violationDetected(int roadIndex, qint64 timestampMs, const QString& reason, const FrameRef& frame);
     void logMessage(const QString& message, const QString& level);
     void cameraStatusChanged(int roadIndex, bool connected);
-    void arduinoStatusChanged(bool connected, const QString& portName);
-    void energySavingStatusChanged(bool active);
-
-
-    void requestFrameProcessing(int roadIndex, cv::Mat frame, cv::Rect roi, TrafficLight currentLight);
-    void requestYoloThresholdUpdate(float confidence, float nms);
+    void arduinoStatusChanged(int intersectionIndex, bool connected, const QString& portName);
+    void energySavingStatusChanged(int intersectionIndex, bool active);
 
 private slots:
     void onMainTimerTimeout();
-    void onLightTimerTimeout();
-    void onArduinoDataReceived();
+    void onLightTimerTimeout(int intersectionIndex);
+    void onSignalLightChanged(int intersectionIndex, int approach, TrafficLight light);
+    void onArduinoDataReceived(int intersectionIndex);
     void onSensorTimerTimeout();
-    void handleProcessingFinished(int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs);
-    void handleWorkerLog(const QString& message, const QString& level);
+    void onSimulationTimerTimeout();
+    void handleProcessingFinished(int roadIndex, const QImage& displayFrame, int vehicleCount, const std::vector<int>& violatingVehicleIDs,
+                                  const FrameRef& frame, qint64 capturedAtMs);
 
 private:
-    std::array<RoadData, 4> roads;
-    std::array<TrafficLight, 4> currentLights;
+    std::deque<RoadData> roads; // RoadData holds a mutex, so it is never moved
+    std::vector<TrafficLight> currentLights;
+    std::vector<Intersection> intersections;
     std::atomic<bool> systemRunning;
 
-    QThread* processingThread;
-    ProcessingWorker* worker;
-    std::atomic<bool> m_workerBusy;
+    InferencePool* inferencePool;
+    int inferenceWorkerCount;
+    InferenceBackend::Type inferenceBackendType;
+    int inferenceThreadsPerWorker;
+    TilingOptions tilingOptions;
+    QualityGovernor* qualityGovernor = nullptr;
+    bool qualityGovernorEnabled = true;
+    double redMinFrameRate = 10.0;
+    int maxBatchSize = 4;
+    bool batchInferenceEnabled;
+    QString yoloModelPath;
+    QString classNamesPath;
+    bool previewEnabled;
+    bool trackRefinementEnabled;
+    bool motionGateEnabled;
 
-    int currentRoadIndex;
-    int lightTimeRemaining;
-    bool yellowLightActive;
     int yellowLightFixedDuration;
-    bool energySavingMode;
+    int allRedDurationMs;
     bool energySavingEnabled;
     std::array<int, 5> lightDurations;
     bool violationDetectionEnabled;
+    Logger* logger;
+    Metrics* metrics;
+    MetricsServer* metricsServer;
     QString violationDir;
-    std::array<bool, 4> irViolationCooldownActive{false};
+    EvidenceStore* evidenceStore;
+    EvidenceWriter* evidenceWriter;
+    int evidencePreMs;
+    int evidencePostMs;
+    qint64 frameHistoryBudgetBytes;
+    std::vector<bool> irViolationCooldownActive;
 
     QTimer *mainTimer;
-    QTimer *lightTimer;
     QTimer *sensorTimer;
-    QSerialPort *arduino;
-    ArduinoData arduinoData;
+    TrafficSimulator* simulator = nullptr;
+    QTimer* simulationTimer = nullptr;
+    QElapsedTimer simulationClock;
     QMutex arduinoMutex;
 
     // Helper Methods
+    bool isValidRoad(int roadIndex) const { return roadIndex >= 0 && roadIndex < getRoadCount(); }
+    bool isValidIntersection(int index) const { return index >= 0 && index < getIntersectionCount(); }
     void initializeTimers();
-    void updateTrafficLights();
-    void processTrafficCycle();
-    void switchToNextRoad();
-    void setAllTrafficLights(TrafficLight light);
+    void updateTrafficLights(int intersectionIndex);
+    void processTrafficCycle(int intersectionIndex);
     void setTrafficLight(int roadIndex, TrafficLight light);
-    void processEnergySaving();
-    void sendArduinoCommand(const QString& command);
-    void parseArduinoData(const QByteArray& data);
-    void saveViolationScreenshot(int roadIndex, int imageNum, const QString& baseTimestamp);
+    void processEnergySaving(int intersectionIndex);
+    void updateVehicleCount(int roadIndex, int vehicleCount);
+    void sendArduinoCommand(int intersectionIndex, const QString& command);
+    void parseArduinoData(int intersectionIndex, const QByteArray& data);
+    void saveViolationScreenshot(int roadIndex, qint64 eventMs, const QString& baseTimestamp, const QString& reason);
+    void saveViolationClip(int roadIndex, qint64 eventMs, const QString& baseName, const QString& reason);
 };
 
 #endif // TRAFFICSYSTEM_H
@@ -0,0 +1,374 @@
+#include "vehicletracker.h"
+#include <algorithm>
+#include <limits>
+
+// Confident detections must overlap a track this much to continue it; weak ones more.
+static const float HIGH_CONFIDENCE_MIN_IOU = 0.3f;
+static const float LOW_CONFIDENCE_MIN_IOU = 0.5f;
+// A track is dropped once it has gone this many frames, detector or predicted, without a
+// detection, but not before missing two detector passes, so one miss at a long detector
+// interval doesn't end it.
+static const int MAX_FRAMES_DISAPPEARED = 15;
+static const int MIN_MISSED_DETECTIONS = 2;
+
+// Kalman layout and noise, scaled by box height like SORT/ByteTrack.
+static const int STATE_SIZE = 8;
+static const int COVARIANCE_SIZE = 12;
+static const float POSITION_NOISE = 1.0f / 20.0f;
+static const float VELOCITY_NOISE = 1.0f / 160.0f;
+
+// Template refinement: centre patch size cap and minimum normalised correlation.
+static const int TEMPLATE_MAX_SIDE = 48;
+static const double TEMPLATE_MIN_SCORE = 0.6;
+
+static inline float squared(float v) { return v * v; }
+
+VehicleTracker::VehicleTracker() {
+}
+
+cv::Rect VehicleTracker::getBox(int track) const {
+    return cv::Rect(cv::Point(cvRound(x1[track]), cvRound(y1[track])), cv::Point(cvRound(x2[track]), cvRound(y2[track])));
+}
+
+void VehicleTracker::clear() {
+    ids.clear();
+    x1.clear(); y1.clear(); x2.clear(); y2.clear();
+    framesWithoutDetection.clear();
+    missedDetections.clear();
+    violationFrames.clear();
+    violationCandidate.clear();
+    kalmanState.clear();
+    kalmanCovariance.clear();
+    templates.clear();
+}
+
+void VehicleTracker::update(const std::vector<VehicleDetection>& detections, TrafficLight currentLight,
+                            const cv::Mat& frame, bool captureTemplates) {
+    // Associate against where the tracks are expected to be now, not where they were last seen.
+    predict();
+
+    const int trackCount = size();
+    for (int t = 0; t < trackCount; ++t) {
+        framesWithoutDetection[t]++;
+        missedDetections[t]++;
+    }
+
+    trackToDetection.assign(trackCount, -1);
+    detectionMatched.assign(detections.size(), 0);
+    highDetections.clear();
+    lowDetections.clear();
+    for (int d = 0; d < static_cast<int>(detections.size()); ++d) {
+        if (detections[d].confidence >= highConfidenceThreshold) highDetections.push_back(d);
+        else lowDetections.push_back(d);
+    }
+
+    // First stage: every track against the confident detections.
+    pendingTracks.resize(trackCount);
+    for (int t = 0; t < trackCount; ++t) pendingTracks[t] = t;
+    matchStage(pendingTracks, highDetections, detections, HIGH_CONFIDENCE_MIN_IOU, currentLight);
+
+    // Second stage: tracks left over (occluded, blurred) may continue on a weak detection.
+    pendingTracks.clear();
+    for (int t = 0; t < trackCount; ++t) {
+        if (trackToDetection[t] < 0) pendingTracks.push_back(t);
+    }
+    matchStage(pendingTracks, lowDetections, detections, LOW_CONFIDENCE_MIN_IOU, currentLight);
+
+    removeLostTracks(MAX_FRAMES_DISAPPEARED);
+
+    for (int d : highDetections) {
+        if (!detectionMatched[d]) addTrack(detections[d].box);
+    }
+
+    if (captureTemplates && !frame.empty()) {
+        for (int t = 0; t < size(); ++t) {
+            if (framesWithoutDetection[t] == 0) captureTemplate(t, frame);
+        }
+    }
+}
+
+void VehicleTracker::advance(TrafficLight currentLight, const cv::Mat& frame, bool refineWithTemplates) {
+    predict();
+
+    for (int t = 0; t < size(); ++t) {
+        framesWithoutDetection[t]++;
+        if (refineWithTemplates && !frame.empty()) refineTrack(t, frame);
+        // Tracks confirmed by the last detector pass keep accumulating violation frames.
+        if (missedDetections[t] == 0) applyLightState(t, currentLight);
+    }
+    removeLostTracks(MAX_FRAMES_DISAPPEARED);
+}
+
+void VehicleTracker::matchStage(const std::vector<int>& trackSet, const std::vector<int>& detectionSet,
+                                const std::vector<VehicleDetection>& detections, float minIoU, TrafficLight currentLight) {
+    const int nt = static_cast<int>(trackSet.size());
+    const int nd = static_cast<int>(detectionSet.size());
+    if (nt == 0 || nd == 0) return;
+
+    detX1.resize(nd); detY1.resize(nd); detX2.resize(nd); detY2.resize(nd); detArea.resize(nd);
+    for (int j = 0; j < nd; ++j) {
+        const cv::Rect& box = detections[detectionSet[j]].box;
+        detX1[j] = static_cast<float>(box.x);
+        detY1[j] = static_cast<float>(box.y);
+        detX2[j] = static_cast<float>(box.x + box.width);
+        detY2[j] = static_cast<float>(box.y + box.height);
+        detArea[j] = static_cast<float>(box.width) * static_cast<float>(box.height);
+    }
+
+    // Full IoU matrix in one pass over the flat arrays.
+    iouMatrix.resize(static_cast<size_t>(nt) * nd);
+    for (int i = 0; i < nt; ++i) {
+        const int t = trackSet[i];
+        const float tx1 = x1[t], ty1 = y1[t], tx2 = x2[t], ty2 = y2[t];
+        const float trackArea = (tx2 - tx1) * (ty2 - ty1);
+        float* row = &iouMatrix[static_cast<size_t>(i) * nd];
+        for (int j = 0; j < nd; ++j) {
+            float iw = std::min(tx2, detX2[j]) - std::max(tx1, detX1[j]);
+            float ih = std::min(ty2, detY2[j]) - std::max(ty1, detY1[j]);
+            float inter = (iw > 0.0f && ih > 0.0f) ? iw * ih : 0.0f;
+            float unionArea = trackArea + detArea[j] - inter;
+            row[j] = unionArea > 0.0f ? inter / unionArea : 0.0f;
+        }
+    }
+
+    // The solver wants rows <= columns, so transpose when there are more tracks than detections.
+    const bool transposed = nt > nd;
+    const int rows = transposed ? nd : nt;
+    const int cols = transposed ? nt : nd;
+    costMatrix.resize(static_cast<size_t>(rows) * cols);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            float iou = transposed ? iouMatrix[static_cast<size_t>(c) * nd + r] : iouMatrix[static_cast<size_t>(r) * nd + c];
+            costMatrix[static_cast<size_t>(r) * cols + c] = iou >= minIoU ? 1.0f - iou : 1.0f;
+        }
+    }
+
+    solveAssignment(rows, cols, rowAssignment);
+
+    for (int r = 0; r < rows; ++r) {
+        const int c = rowAssignment[r];
+        if (c < 0) continue;
+        const int i = transposed ? c : r;
+        const int j = transposed ? r : c;
+        if (iouMatrix[static_cast<size_t>(i) * nd + j] < minIoU) continue;
+
+        const int t = trackSet[i];
+        const int d = detectionSet[j];
+        trackToDetection[t] = d;
+        detectionMatched[d] = 1;
+        assignDetection(t, detections[d].box, currentLight);
+    }
+}
+
+// Minimum-cost assignment (Hungarian method with potentials, O(rows^2 * cols)).
+void VehicleTracker::solveAssignment(int rows, int cols, std::vector<int>& rowToColumn) {
+    const double INF = std::numeric_limits<double>::max();
+    potentialU.assign(rows + 1, 0.0);
+    potentialV.assign(cols + 1, 0.0);
+    matchOfColumn.assign(cols + 1, 0);
+    way.assign(cols + 1, 0);
+
+    for (int i = 1; i <= rows; ++i) {
+        matchOfColumn[0] = i;
+        int j0 = 0;
+        minSlack.assign(cols + 1, INF);
+        columnUsed.assign(cols + 1, 0);
+        do {
+            columnUsed[j0] = 1;
+            const int i0 = matchOfColumn[j0];
+            const float* costRow = &costMatrix[static_cast<size_t>(i0 - 1) * cols];
+            double delta = INF;
+            int j1 = 0;
+            for (int j = 1; j <= cols; ++j) {
+                if (columnUsed[j]) continue;
+                double cur = costRow[j - 1] - potentialU[i0] - potentialV[j];
+                if (cur < minSlack[j]) {
+                    minSlack[j] = cur;
+                    way[j] = j0;
+                }
+                if (minSlack[j] < delta) {
+                    delta = minSlack[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= cols; ++j) {
+                if (columnUsed[j]) {
+                    potentialU[matchOfColumn[j]] += delta;
+                    potentialV[j] -= delta;
+                } else {
+                    minSlack[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (matchOfColumn[j0] != 0);
+        do {
+            const int j1 = way[j0];
+            matchOfColumn[j0] = matchOfColumn[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    rowToColumn.assign(rows, -1);
+    for (int j = 1; j <= cols; ++j) {
+        if (matchOfColumn[j] != 0) rowToColumn[matchOfColumn[j] - 1] = j - 1;
+    }
+}
+
+void VehicleTracker::assignDetection(int track, const cv::Rect& box, TrafficLight currentLight) {
+    const float measurement[4] = {box.x + 0.5f * box.width, box.y + 0.5f * box.height,
+                                  static_cast<float>(box.width), static_cast<float>(box.height)};
+    correct(track, measurement, 0, 4);
+    framesWithoutDetection[track] = 0;
+    missedDetections[track] = 0;
+    applyLightState(track, currentLight);
+}
+
+void VehicleTracker::applyLightState(int track, TrafficLight currentLight) {
+    // Violation logic: If light is red, vehicle is a candidate.
+    if (currentLight == TrafficLight::RED) {
+        violationFrames[track]++;
+        violationCandidate[track] = 1;
+    } else { // Reset if light is not red
+        violationFrames[track] = 0;
+        violationCandidate[track] = 0;
+    }
+}
+
+void VehicleTracker::addTrack(const cv::Rect& box) {
+    ids.push_back(nextVehicleID++);
+    x1.push_back(static_cast<float>(box.x));
+    y1.push_back(static_cast<float>(box.y));
+    x2.push_back(static_cast<float>(box.x + box.width));
+    y2.push_back(static_cast<float>(box.y + box.height));
+    framesWithoutDetection.push_back(0);
+    missedDetections.push_back(0);
+    violationFrames.push_back(0);
+    violationCandidate.push_back(0);
+    templates.push_back(cv::Mat());
+
+    const float h = static_cast<float>(std::max(box.height, 1));
+    const float state[STATE_SIZE] = {box.x + 0.5f * box.width, box.y + 0.5f * box.height,
+                                     static_cast<float>(box.width), static_cast<float>(box.height), 0.0f, 0.0f, 0.0f, 0.0f};
+    kalmanState.insert(kalmanState.end(), state, state + STATE_SIZE);
+    for (int k = 0; k < 4; ++k) {
+        kalmanCovariance.push_back(squared(2.0f * POSITION_NOISE * h));
+        kalmanCovariance.push_back(0.0f);
+        kalmanCovariance.push_back(squared(10.0f * VELOCITY_NOISE * h));
+    }
+}
+
+// Constant-velocity step; the four axes are independent two-state filters.
+void VehicleTracker::predict() {
+    for (int t = 0; t < size(); ++t) {
+        float* state = &kalmanState[static_cast<size_t>(t) * STATE_SIZE];
+        float* covariance = &kalmanCovariance[static_cast<size_t>(t) * COVARIANCE_SIZE];
+        const float h = std::max(state[3], 1.0f);
+        const float positionNoise = squared(POSITION_NOISE * h);
+        const float velocityNoise = squared(VELOCITY_NOISE * h);
+
+        for (int k = 0; k < 4; ++k) {
+            float* p = covariance + 3 * k;
+            state[k] += state[4 + k];
+            p[0] += 2.0f * p[1] + p[2] + positionNoise;
+            p[1] += p[2];
+            p[2] += velocityNoise;
+        }
+        state[2] = std::max(state[2], 1.0f);
+        state[3] = std::max(state[3], 1.0f);
+        syncBox(t);
+    }
+}
+
+void VehicleTracker::correct(int track, const float* measurement, int firstAxis, int axisCount) {
+    float* state = &kalmanState[static_cast<size_t>(track) * STATE_SIZE];
+    float* covariance = &kalmanCovariance[static_cast<size_t>(track) * COVARIANCE_SIZE];
+    const float measurementNoise = squared(POSITION_NOISE * std::max(state[3], 1.0f));
+
+    for (int a = 0; a < axisCount; ++a) {
+        const int k = firstAxis + a;
+        float* p = covariance + 3 * k;
+        const float innovationVariance = p[0] + measurementNoise;
+        const float gainPosition = p[0] / innovationVariance;
+        const float gainVelocity = p[1] / innovationVariance;
+        const float innovation = measurement[a] - state[k];
+
+        state[k] += gainPosition * innovation;
+        state[4 + k] += gainVelocity * innovation;
+        p[2] -= gainVelocity * p[1];
+        p[0] *= 1.0f - gainPosition;
+        p[1] *= 1.0f - gainPosition;
+    }
+    syncBox(track);
+}
+
+void VehicleTracker::syncBox(int track) {
+    const float* state = &kalmanState[static_cast<size_t>(track) * STATE_SIZE];
+    x1[track] = state[0] - 0.5f * state[2];
+    y1[track] = state[1] - 0.5f * state[3];
+    x2[track] = state[0] + 0.5f * state[2];
+    y2[track] = state[1] + 0.5f * state[3];
+}
+
+void VehicleTracker::captureTemplate(int track, const cv::Mat& frame) {
+    const float* state = &kalmanState[static_cast<size_t>(track) * STATE_SIZE];
+    const int w = std::min(TEMPLATE_MAX_SIDE, cvRound(state[2] * 0.5f));
+    const int h = std::min(TEMPLATE_MAX_SIDE, cvRound(state[3] * 0.5f));
+    cv::Rect patch(cvRound(state[0]) - w / 2, cvRound(state[1]) - h / 2, w, h);
+    if (w < 8 || h < 8 || (patch & cv::Rect(0, 0, frame.cols, frame.rows)) != patch) {
+        templates[track].release();
+        return;
+    }
+    frame(patch).copyTo(templates[track]);
+}
+
+// Looks for the track's centre patch around the predicted position and uses the hit as a centre measurement.
+void VehicleTracker::refineTrack(int track, const cv::Mat& frame) {
+    const cv::Mat& patch = templates[track];
+    if (patch.empty()) return;
+
+    const float* state = &kalmanState[static_cast<size_t>(track) * STATE_SIZE];
+    const int marginX = std::max(4, patch.cols / 2);
+    const int marginY = std::max(4, patch.rows / 2);
+    cv::Rect window(cvRound(state[0]) - patch.cols / 2 - marginX, cvRound(state[1]) - patch.rows / 2 - marginY,
+                    patch.cols + 2 * marginX, patch.rows + 2 * marginY);
+    window &= cv::Rect(0, 0, frame.cols, frame.rows);
+    if (window.width < patch.cols || window.height < patch.rows) return;
+
+    cv::matchTemplate(frame(window), patch, matchScores, cv::TM_CCOEFF_NORMED);
+    double bestScore = 0.0;
+    cv::Point bestLocation;
+    cv::minMaxLoc(matchScores, nullptr, &bestScore, nullptr, &bestLocation);
+    if (bestScore < TEMPLATE_MIN_SCORE) return;
+
+    const float centre[2] = {window.x + bestLocation.x + 0.5f * patch.cols, window.y + bestLocation.y + 0.5f * patch.rows};
+    correct(track, centre, 0, 2);
+}
+
+// Deregister tracks that have been lost for too long, compacting the arrays in place.
+void VehicleTracker::removeLostTracks(int maxFramesDisappeared) {
+    int kept = 0;
+    for (int t = 0; t < size(); ++t) {
+        if (framesWithoutDetection[t] > maxFramesDisappeared && missedDetections[t] >= MIN_MISSED_DETECTIONS) continue;
+        if (kept != t) {
+            ids[kept] = ids[t];
+            x1[kept] = x1[t]; y1[kept] = y1[t]; x2[kept] = x2[t]; y2[kept] = y2[t];
+            framesWithoutDetection[kept] = framesWithoutDetection[t];
+            missedDetections[kept] = missedDetections[t];
+            violationFrames[kept] = violationFrames[t];
+            violationCandidate[kept] = violationCandidate[t];
+            std::copy_n(&kalmanState[static_cast<size_t>(t) * STATE_SIZE], STATE_SIZE, &kalmanState[static_cast<size_t>(kept) * STATE_SIZE]);
+            std::copy_n(&kalmanCovariance[static_cast<size_t>(t) * COVARIANCE_SIZE], COVARIANCE_SIZE, &kalmanCovariance[static_cast<size_t>(kept) * COVARIANCE_SIZE]);
+            templates[kept] = templates[t];
+        }
+        kept++;
+    }
+    ids.resize(kept);
+    x1.resize(kept); y1.resize(kept); x2.resize(kept); y2.resize(kept);
+    framesWithoutDetection.resize(kept);
+    missedDetections.resize(kept);
+    violationFrames.resize(kept);
+    violationCandidate.resize(kept);
+    kalmanState.resize(static_cast<size_t>(kept) * STATE_SIZE);
+    kalmanCovariance.resize(static_cast<size_t>(kept) * COVARIANCE_SIZE);
+    templates.resize(kept);
+}
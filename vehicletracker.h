@@ -0,0 +1,80 @@
+#ifndef VEHICLETRACKER_H
+#define VEHICLETRACKER_H
+
+#include <opencv2/opencv.hpp>
+#include "traffic_types.h"
+#include <vector>
+
+struct VehicleDetection {
+    cv::Rect box;
+    float confidence = 0.0f;
+};
+
+// Multi-object tracker for one road. Tracks live in flat struct-of-arrays
+// storage; every update builds the full track x detection IoU matrix in one
+// pass and solves it with the Hungarian method, ByteTrack style: confident
+// detections are matched first, weak ones only extend the tracks that are
+// still unmatched and never start new tracks.
+//
+// Each track also carries a constant-velocity Kalman state (centre, size and
+// their velocities), so frames without a detector pass can be served by
+// prediction, optionally refined by template matching around the prediction.
+class VehicleTracker
+{
+public:
+    VehicleTracker();
+
+    void setHighConfidenceThreshold(float threshold) { highConfidenceThreshold = threshold; }
+    // Detector frame: predict, associate, start and retire tracks.
+    void update(const std::vector<VehicleDetection>& detections, TrafficLight currentLight,
+                const cv::Mat& frame = cv::Mat(), bool captureTemplates = false);
+    // Frame without detections: advance every track by its motion model.
+    void advance(TrafficLight currentLight, const cv::Mat& frame = cv::Mat(), bool refineWithTemplates = false);
+    void clear();
+
+    int size() const { return static_cast<int>(ids.size()); }
+    int getId(int track) const { return ids[track]; }
+    cv::Rect getBox(int track) const;
+    bool isViolationCandidate(int track) const { return violationCandidate[track] != 0; }
+    int getViolationFrameCount(int track) const { return violationFrames[track]; }
+
+private:
+    float highConfidenceThreshold = 0.45f;
+    int nextVehicleID = 0;
+
+    // Track storage, one entry per track in every array.
+    std::vector<int> ids;
+    std::vector<float> x1, y1, x2, y2;
+    std::vector<int> framesWithoutDetection; // detector and predicted frames
+    std::vector<int> missedDetections;       // detector passes
+    std::vector<int> violationFrames;
+    std::vector<unsigned char> violationCandidate;
+    std::vector<float> kalmanState;       // cx, cy, w, h, vcx, vcy, vw, vh per track
+    std::vector<float> kalmanCovariance;  // p00, p01, p11 for each of the four axes per track
+    std::vector<cv::Mat> templates;       // appearance patch around the box centre
+
+    // Scratch buffers reused across updates.
+    std::vector<int> highDetections, lowDetections;
+    std::vector<float> detX1, detY1, detX2, detY2, detArea;
+    std::vector<float> iouMatrix, costMatrix;
+    std::vector<int> trackToDetection, detectionMatched, pendingTracks, rowAssignment;
+    std::vector<double> potentialU, potentialV, minSlack;
+    std::vector<int> matchOfColumn, way;
+    std::vector<unsigned char> columnUsed;
+    cv::Mat matchScores;
+
+    void matchStage(const std::vector<int>& trackSet, const std::vector<int>& detectionSet,
+                    const std::vector<VehicleDetection>& detections, float minIoU, TrafficLight currentLight);
+    void solveAssignment(int rows, int cols, std::vector<int>& rowToColumn);
+    void assignDetection(int track, const cv::Rect& box, TrafficLight currentLight);
+    void applyLightState(int track, TrafficLight currentLight);
+    void addTrack(const cv::Rect& box);
+    void predict();
+    void correct(int track, const float* measurement, int firstAxis, int axisCount);
+    void syncBox(int track);
+    void captureTemplate(int track, const cv::Mat& frame);
+    void refineTrack(int track, const cv::Mat& frame);
+    void removeLostTracks(int maxFramesDisappeared);
+};
+
+#endif // VEHICLETRACKER_H
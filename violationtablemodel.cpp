@@ -0,0 +1,198 @@
+#include "violationtablemodel.h"
+#include <QDateTime>
+#include <limits>
+
+static const int FLUSH_INTERVAL_MS = 250;
+static const int HISTORY_PAGE_SIZE = 500;
+
+ViolationTableModel::ViolationTableModel(QObject *parent)
+    : QAbstractTableModel(parent),
+    flushTimer(new QTimer(this))
+{
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(FLUSH_INTERVAL_MS);
+    connect(flushTimer, &QTimer::timeout, this, &ViolationTableModel::flushPending);
+}
+
+void ViolationTableModel::appendViolation(qint64 timestampMs, int roadIndex, const QString& reason) {
+    Row row;
+    row.timestampMs = timestampMs;
+    row.roadIndex = roadIndex;
+    row.reason = reason;
+    pendingRows.push_back(row);
+    if (!flushTimer->isActive()) flushTimer->start();
+}
+
+// One insert notification per batch instead of one per violation.
+void ViolationTableModel::flushPending() {
+    if (pendingRows.empty()) return;
+
+    if (historyMode) {
+        sessionRows.insert(sessionRows.end(), pendingRows.begin(), pendingRows.end());
+        pendingRows.clear();
+        return;
+    }
+
+    const int firstIndex = static_cast<int>(sessionRows.size());
+    int added = 0;
+    for (const Row& row : pendingRows) {
+        if (!filterActive || matchesFilter(row)) added++;
+    }
+    if (added > 0) beginInsertRows(QModelIndex(), rowCount(), rowCount() + added - 1);
+    sessionRows.insert(sessionRows.end(), pendingRows.begin(), pendingRows.end());
+    if (filterActive) {
+        for (int i = firstIndex; i < static_cast<int>(sessionRows.size()); ++i) {
+            if (matchesFilter(sessionRows[i])) visibleRows.push_back(i);
+        }
+    }
+    pendingRows.clear();
+    if (added > 0) endInsertRows();
+}
+
+void ViolationTableModel::clearSession() {
+    flushTimer->stop();
+    pendingRows.clear();
+    if (historyMode) {
+        sessionRows.clear();
+        visibleRows.clear();
+        return;
+    }
+    beginResetModel();
+    sessionRows.clear();
+    visibleRows.clear();
+    endResetModel();
+}
+
+void ViolationTableModel::setFilter(int roadIndex, qint64 fromMs, qint64 toMs) {
+    flushPending();
+    beginResetModel();
+    filterActive = true;
+    filterRoad = roadIndex;
+    filterFromMs = fromMs;
+    filterToMs = toMs;
+    rebuildVisibleRows();
+    if (historyMode) restartHistory();
+    endResetModel();
+}
+
+void ViolationTableModel::clearFilter() {
+    flushPending();
+    beginResetModel();
+    filterActive = false;
+    visibleRows.clear();
+    if (historyMode) restartHistory();
+    endResetModel();
+}
+
+void ViolationTableModel::showSession() {
+    if (!historyMode) return;
+    flushPending();
+    beginResetModel();
+    historyMode = false;
+    historyRows.clear();
+    historyExhausted = true;
+    rebuildVisibleRows();
+    endResetModel();
+}
+
+// The view pulls the first page through fetchMore().
+void ViolationTableModel::showHistory() {
+    flushPending();
+    beginResetModel();
+    historyMode = true;
+    restartHistory();
+    endResetModel();
+}
+
+void ViolationTableModel::restartHistory() {
+    historyRows.clear();
+    historyCursorMs = filterActive ? filterFromMs : std::numeric_limits<qint64>::min();
+    historyCursorSkip = 0;
+    historyExhausted = store == nullptr;
+}
+
+bool ViolationTableModel::canFetchMore(const QModelIndex& parent) const {
+    return !parent.isValid() && historyMode && !historyExhausted;
+}
+
+void ViolationTableModel::fetchMore(const QModelIndex& parent) {
+    if (!canFetchMore(parent)) return;
+
+    const int road = filterActive ? filterRoad : -1;
+    const qint64 toMs = filterActive ? filterToMs : std::numeric_limits<qint64>::max();
+    const int limit = HISTORY_PAGE_SIZE + historyCursorSkip;
+    std::vector<EvidenceRecord> page = store->query(historyCursorMs, toMs, road, QString(), limit, true);
+    historyExhausted = static_cast<int>(page.size()) < limit;
+    if (static_cast<int>(page.size()) <= historyCursorSkip) {
+        historyExhausted = true;
+        return;
+    }
+
+    const int first = static_cast<int>(historyRows.size());
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(page.size()) - historyCursorSkip - 1);
+    for (size_t i = historyCursorSkip; i < page.size(); ++i) {
+        Row row;
+        row.timestampMs = page[i].timestampMs;
+        row.roadIndex = page[i].roadIndex;
+        row.reason = page[i].reason;
+        historyRows.push_back(row);
+    }
+    endInsertRows();
+
+    // Resume after the last row; several records can share its millisecond.
+    const qint64 lastMs = historyRows.back().timestampMs;
+    int sameMs = 0;
+    for (auto it = historyRows.rbegin(); it != historyRows.rend() && it->timestampMs == lastMs; ++it) sameMs++;
+    historyCursorMs = lastMs;
+    historyCursorSkip = sameMs;
+}
+
+int ViolationTableModel::rowCount(const QModelIndex& parent) const {
+    if (parent.isValid()) return 0;
+    if (historyMode) return static_cast<int>(historyRows.size());
+    return static_cast<int>(filterActive ? visibleRows.size() : sessionRows.size());
+}
+
+int ViolationTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : 3;
+}
+
+QVariant ViolationTableModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || role != Qt::DisplayRole || index.row() >= rowCount()) return QVariant();
+
+    const Row& row = rowAt(index.row());
+    switch (index.column()) {
+    case 0: return QDateTime::fromMSecsSinceEpoch(row.timestampMs).toString("yyyy-MM-dd hh:mm:ss");
+    case 1: return QString("Road %1").arg(row.roadIndex + 1);
+    case 2: return row.reason;
+    }
+    return QVariant();
+}
+
+QVariant ViolationTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) return QVariant();
+    switch (section) {
+    case 0: return QString("Timestamp");
+    case 1: return QString("Road");
+    case 2: return QString("Reason");
+    }
+    return QVariant();
+}
+
+bool ViolationTableModel::matchesFilter(const Row& row) const {
+    if (filterRoad >= 0 && row.roadIndex != filterRoad) return false;
+    return row.timestampMs >= filterFromMs && row.timestampMs <= filterToMs;
+}
+
+void ViolationTableModel::rebuildVisibleRows() {
+    visibleRows.clear();
+    if (!filterActive) return;
+    for (int i = 0; i < static_cast<int>(sessionRows.size()); ++i) {
+        if (matchesFilter(sessionRows[i])) visibleRows.push_back(i);
+    }
+}
+
+const ViolationTableModel::Row& ViolationTableModel::rowAt(int row) const {
+    if (historyMode) return historyRows[row];
+    return filterActive ? sessionRows[visibleRows[row]] : sessionRows[row];
+}
@@ -0,0 +1,73 @@
+#ifndef VIOLATIONTABLEMODEL_H
+#define VIOLATIONTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QTimer>
+#include <vector>
+#include "evidencestore.h"
+
+// Rows of the violations tab. Live violations are queued and inserted in
+// batches; the view only asks for the rows on screen and timestamps are
+// formatted there. A filter keeps an index into the session rows instead of
+// copying them. History mode pages stored violations in from the evidence
+// store as the view scrolls.
+class ViolationTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit ViolationTableModel(QObject *parent = nullptr);
+
+    void setStore(const EvidenceStore* store) { this->store = store; }
+
+    void appendViolation(qint64 timestampMs, int roadIndex, const QString& reason);
+    void clearSession();
+    int getSessionCount() const { return static_cast<int>(sessionRows.size() + pendingRows.size()); }
+
+    // roadIndex < 0 means all roads. Applies to the session rows and to the history query.
+    void setFilter(int roadIndex, qint64 fromMs, qint64 toMs);
+    void clearFilter();
+
+    void showSession();
+    void showHistory();
+    bool isShowingHistory() const { return historyMode; }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+private:
+    struct Row {
+        qint64 timestampMs = 0;
+        int roadIndex = 0;
+        QString reason;
+    };
+
+    const EvidenceStore* store = nullptr;
+    std::vector<Row> sessionRows;
+    std::vector<Row> pendingRows;
+    std::vector<int> visibleRows;   // indices into sessionRows while a filter is set
+    QTimer* flushTimer;
+
+    bool filterActive = false;
+    int filterRoad = -1;
+    qint64 filterFromMs = 0;
+    qint64 filterToMs = 0;
+
+    bool historyMode = false;
+    std::vector<Row> historyRows;
+    qint64 historyCursorMs = 0;
+    int historyCursorSkip = 0;      // rows already loaded at historyCursorMs
+    bool historyExhausted = true;
+
+    void flushPending();
+    bool matchesFilter(const Row& row) const;
+    void rebuildVisibleRows();
+    void restartHistory();
+    const Row& rowAt(int row) const;
+};
+
+#endif // VIOLATIONTABLEMODEL_H
@@ -0,0 +1,83 @@
+#include "yolodecoder.h"
+#include <opencv2/core/hal/intrin.hpp>
+
+// COCO class IDs for vehicles: car, motorcycle, bus, truck (ascending, like the argmax tie-break)
+static const int VEHICLE_CLASS_IDS[4] = {2, 3, 5, 7};
+
+static inline bool isVehicleClass(int classId) {
+    return classId == 2 || classId == 3 || classId == 5 || classId == 7;
+}
+
+// Full check of one anchor: best vehicle score, then make sure no other class beats it.
+static inline void decodeAnchor(const float* data, int numClasses, int numAnchors, int anchor,
+                                float confidenceThreshold, float xFactor, float yFactor, float xOffset, float yOffset,
+                                std::vector<cv::Rect>& boxes, std::vector<float>& confidences) {
+    const float* scores = data + 4 * numAnchors + anchor;
+
+    int bestClass = VEHICLE_CLASS_IDS[0];
+    float bestScore = scores[bestClass * numAnchors];
+    for (int k = 1; k < 4; ++k) {
+        float score = scores[VEHICLE_CLASS_IDS[k] * numAnchors];
+        if (score > bestScore) {
+            bestScore = score;
+            bestClass = VEHICLE_CLASS_IDS[k];
+        }
+    }
+    if (!(bestScore > confidenceThreshold)) return;
+
+    for (int c = 0; c < numClasses; ++c) {
+        if (isVehicleClass(c)) continue;
+        float score = scores[c * numAnchors];
+        if (score > bestScore || (score == bestScore && c < bestClass)) return;
+    }
+
+    float cx = data[anchor];
+    float cy = data[numAnchors + anchor];
+    float w = data[2 * numAnchors + anchor];
+    float h = data[3 * numAnchors + anchor];
+
+    int left = static_cast<int>((cx - 0.5 * w - xOffset) * xFactor);
+    int top = static_cast<int>((cy - 0.5 * h - yOffset) * yFactor);
+    int width = static_cast<int>(w * xFactor);
+    int height = static_cast<int>(h * yFactor);
+    boxes.push_back(cv::Rect(left, top, width, height));
+    confidences.push_back(bestScore);
+}
+
+void YoloDecoder::decodeVehicles(const cv::Mat& output, float confidenceThreshold, float xFactor, float yFactor,
+                                 float xOffset, float yOffset,
+                                 std::vector<cv::Rect>& boxes, std::vector<float>& confidences) {
+    boxes.clear();
+    confidences.clear();
+
+    CV_Assert(output.dims == 2 && output.type() == CV_32F && output.isContinuous());
+    const int numClasses = output.rows - 4;
+    const int numAnchors = output.cols;
+    if (numClasses <= VEHICLE_CLASS_IDS[3]) return;
+
+    const float* data = output.ptr<float>();
+    const float* vehicleRows[4];
+    for (int k = 0; k < 4; ++k) {
+        vehicleRows[k] = data + (4 + VEHICLE_CLASS_IDS[k]) * numAnchors;
+    }
+
+    int anchor = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    // Reject whole vectors of anchors whose best vehicle score is below the threshold.
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    const cv::v_float32 threshold = cv::vx_setall_f32(confidenceThreshold);
+    for (; anchor <= numAnchors - lanes; anchor += lanes) {
+        cv::v_float32 best = cv::v_max(cv::v_max(cv::vx_load(vehicleRows[0] + anchor), cv::vx_load(vehicleRows[1] + anchor)),
+                                       cv::v_max(cv::vx_load(vehicleRows[2] + anchor), cv::vx_load(vehicleRows[3] + anchor)));
+        if (!cv::v_check_any(cv::v_gt(best, threshold))) continue;
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            decodeAnchor(data, numClasses, numAnchors, anchor + lane, confidenceThreshold, xFactor, yFactor, xOffset, yOffset, boxes, confidences);
+        }
+    }
+    cv::vx_cleanup();
+#endif
+    for (; anchor < numAnchors; ++anchor) {
+        decodeAnchor(data, numClasses, numAnchors, anchor, confidenceThreshold, xFactor, yFactor, xOffset, yOffset, boxes, confidences);
+    }
+}
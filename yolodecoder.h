@@ -0,0 +1,21 @@
+#ifndef YOLODECODER_H
+#define YOLODECODER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Decodes a raw YOLOv8 output plane ([4 + classes] x anchors, one row per
+// channel) into vehicle candidates without transposing it. Only the four COCO
+// vehicle rows are scanned in the hot loop; the remaining classes are read
+// just for anchors that already beat the threshold, so the result matches the
+// argmax-over-all-classes rule of the original decoder. Box coordinates are
+// mapped back as (network - offset) * factor.
+class YoloDecoder
+{
+public:
+    static void decodeVehicles(const cv::Mat& output, float confidenceThreshold, float xFactor, float yFactor,
+                               float xOffset, float yOffset,
+                               std::vector<cv::Rect>& boxes, std::vector<float>& confidences);
+};
+
+#endif // YOLODECODER_H